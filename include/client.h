@@ -226,6 +226,11 @@ typedef struct
 // frag scoreboard
 	scoreboard_t	*scores;		// [cl.maxclients]
 
+// svc_deltaentities, once the server has sent one
+	qboolean	deltaentities;
+	int			deltaack;		// acked in each move, -1 = need a full frame
+	deltaframe_t	deltaframes[DELTA_BACKUP];
+
 #ifdef QUAKE2
 // light level at player's position including dlights
 // this is sent back to the server each frame
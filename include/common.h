@@ -163,6 +163,7 @@ char	*va(char *format, ...);
 //============================================================================
 
 extern int com_filesize;
+extern byte *com_filemap;
 struct cache_user_s;
 
 extern	char	com_gamedir[MAX_OSPATH];
@@ -173,10 +174,18 @@ int COM_FOpenFile (char *filename, FILE **file);
 void COM_CloseFile (int h);
 
 byte *COM_LoadStackFile (char *path, void *buffer, int bufsize);
+byte *COM_LoadMappedFile (char *path, void *buffer, int bufsize);
 byte *COM_LoadTempFile (char *path);
 byte *COM_LoadHunkFile (char *path);
 void COM_LoadCacheFile (char *path, struct cache_user_s *cu);
 
+void COM_PrefetchFiles (char **names, int count);
+void COM_FreePrefetched (void);
+int COM_PrefetchThreads (void);
+
+// inflate.c
+int Inflate (byte *out, int outlen, byte *in, int inlen);
+
 
 extern	struct cvar_s	registered;
 
@@ -192,6 +192,16 @@ typedef struct mleaf_s
 	byte		ambient_sound_level[NUM_AMBIENTS];
 } mleaf_t;
 
+// a clipnode with its plane copied in, so a hull trace touches one cache
+// line per node.  numbered the same as the hull's clipnodes
+typedef struct
+{
+	vec3_t		normal;
+	float		dist;
+	short		type;			// PLANE_X etc
+	short		children[2];	// negative numbers are contents
+} mclipnode_t;
+
 // !!! if this is changed, it must be changed in asm_i386.h too !!!
 typedef struct
 {
@@ -201,6 +211,7 @@ typedef struct
 	int			lastclipnode;
 	vec3_t		clip_mins;
 	vec3_t		clip_maxs;
+	mclipnode_t	*packednodes;	// not used by the asm
 } hull_t;
 
 /*
@@ -406,6 +417,7 @@ typedef struct model_s
 	texture_t	**textures;
 
 	byte		*visdata;
+	byte		*visrows;		// decompressed vis, numleafs rows, or NULL
 	byte		*lightdata;
 	char		*entities;
 
@@ -423,8 +435,11 @@ void	Mod_ClearAll (void);
 model_t *Mod_ForName (char *name, qboolean crash);
 void	*Mod_Extradata (model_t *mod);	// handles caching
 void	Mod_TouchModel (char *name);
+qboolean Mod_WillLoad (char *name, qboolean clearing);
 
 mleaf_t *Mod_PointInLeaf (float *p, model_t *model);
 byte	*Mod_LeafPVS (mleaf_t *leaf, model_t *model);
+void	Mod_OrLeafPVS (mleaf_t *leaf, model_t *model, byte *out);
+mclipnode_t *Mod_PackClipnodes (dclipnode_t *in, mplane_t *planes, int count);
 
 #endif	// __MODEL__
@@ -67,10 +67,68 @@ void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
 void PR_LoadProgs (void);
+void PR_Predecode (void);
+int PR_RunFunction (dfunction_t *f, int runaway);
+int PR_EnterFunction (dfunction_t *f);
+int PR_LeaveFunction (void);
+
+// pr_jit.c
+typedef void (*prjitfunc_t) (void);
+
+extern	cvar_t	pr_jit;
+extern	cvar_t	pr_jittest;
+extern	qboolean	pr_jitsuspended;
+
+void PR_JitReset (void);
+prjitfunc_t PR_JitFunction (dfunction_t *f);
+int PR_JitRun (prjitfunc_t code, int runaway);
+void PR_JitTest (dfunction_t *f);
+
+// pr_prof.c
+extern	cvar_t	pr_callprofile;
+extern	qboolean	pr_profiling;
+
+void PR_ProfileReset (void);
+void PR_ProfileBegin (void);
+void PR_ProfileEnter (dfunction_t *f);
+void PR_ProfileLeave (void);
+void PR_ProfileBuiltin (dfunction_t *f, int num);
+void PR_ProfileReport (void);
+void PR_ProfileDump_f (void);
+void PR_ProfileReset_f (void);
+
+// pr_find.c
+extern	cvar_t	pr_findindex;
+
+void ED_FindReset (void);
+void ED_FindUpdate (edict_t *ed);
+void ED_StringStored (int ofs);
+edict_t *ED_FindString (int start, int field, char *s);
+
+// pr_string.c
+void PR_InitTempStrings (void);
+char *PR_TempString (char *s);
+void PR_FreeTempStrings (void);
+
+// pr_save.c
+extern	cvar_t	pr_savebinary;
+
+void ED_WriteSnapshot (FILE *f, qboolean globals, int first, int skipflags);
+int ED_ReadSnapshot (FILE *f, qboolean link);
+
+// pr_entcache.c
+typedef struct entlump_s entlump_t;
+
+extern	cvar_t	pr_entcache;
+
+entlump_t *ED_CompileLump (char *data);
+int ED_LumpEntities (entlump_t *lump);
+void ED_ParseCompiled (entlump_t *lump, int num, edict_t *ent);
 
 void PR_Profile_f (void);
 
 edict_t *ED_Alloc (void);
+void ED_Reindex (void);
 void ED_Free (edict_t *ed);
 
 char	*ED_NewString (char *string);
@@ -81,6 +139,9 @@ pr_int_t PR_SetString (const char *str);
 
 void ED_Print (edict_t *ed);
 void ED_Write (FILE *f, edict_t *ed);
+qboolean ED_ParseKey (char **data, char *keyname);
+qboolean ED_ParseEpair (void *base, ddef_t *key, char *s);
+void ED_Parsed (edict_t *ent, qboolean init);
 char *ED_ParseEdict (char *data, edict_t *ent);
 
 void ED_WriteGlobals (FILE *f);
@@ -122,6 +183,8 @@ extern int pr_numbuiltins;
 
 extern int		pr_argc;
 
+extern	cvar_t	pr_predecode;
+
 extern	qboolean	pr_trace;
 extern	dfunction_t	*pr_xfunction;
 extern	int			pr_xstatement;
@@ -135,3 +198,16 @@ void ED_PrintNum (int ent);
 
 eval_t *GetEdictFieldValue(edict_t *ed, char *field);
 
+// offsets of optional fields, resolved once per progs load
+extern	int		eval_gravity;
+extern	int		eval_items2;
+extern	int		eval_ammo_shells1;
+extern	int		eval_ammo_nails1;
+extern	int		eval_ammo_lava_nails;
+extern	int		eval_ammo_rockets1;
+extern	int		eval_ammo_multi_rockets;
+extern	int		eval_ammo_cells1;
+extern	int		eval_ammo_plasma;
+
+#define	GETEDICTFIELDVALUE(ed, fieldoffset) ((fieldoffset) ? (eval_t *)((char *)&(ed)->v + (fieldoffset)) : NULL)
+
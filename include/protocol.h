@@ -40,6 +40,38 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	U_EFFECTS	(1<<13)
 #define	U_LONGENTITY	(1<<14)
 
+// svc_deltaentities reuses the U_ bits, relative to the entity's state in
+// the delta frame (or its baseline if it is new to the client)
+#define	U_REMOVE	(1<<15)		// left the frame, no data follows
+
+// delta entity frames are an extension to PROTOCOL_VERSION.  A client asks
+// for them with the "deltaentities" command at signon, and only acks them
+// (clc_deltaack) once the server has actually sent one.
+#define	DELTA_BACKUP		16		// frames kept on both sides, power of 2
+#define	DELTA_MASK			(DELTA_BACKUP-1)
+#define	MAX_DELTA_ENTITIES	256		// per frame
+
+// an entity as the client last decoded it, fields kept in wire form
+typedef struct
+{
+	unsigned short	number;
+	unsigned short	flags;			// U_NOLERP
+	short			origin[3];		// MSG_WriteCoord units
+	byte			angles[3];		// MSG_WriteAngle units
+	byte			modelindex;
+	byte			frame;
+	byte			colormap;
+	byte			skin;
+	byte			effects;
+} deltaentity_t;
+
+typedef struct
+{
+	int				framenum;		// -1 = slot not valid
+	int				numentities;
+	deltaentity_t	entities[MAX_DELTA_ENTITIES];
+} deltaframe_t;
+
 
 #define	SU_VIEWHEIGHT	(1<<0)
 #define	SU_IDEALPITCH	(1<<1)
@@ -130,6 +162,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define svc_cutscene		34
 
+#define	svc_deltaentities	35	// [long] frame [long] delta frame (-1 = none)
+								// then U_ updates, terminated by a 0 byte
+
 //
 // client to server
 //
@@ -138,6 +173,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	clc_disconnect	2
 #define	clc_move		3			// [usercmd_t]
 #define	clc_stringcmd	4		// [string] message
+#define	clc_deltaack	5		// [long] last svc_deltaentities frame decoded
 
 
 //
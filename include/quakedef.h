@@ -255,7 +255,7 @@ typedef struct
 #include "progs.h"
 #include "server.h"
 
-#ifdef GLQUAKE
+#if defined(GLQUAKE) || defined(SERVERONLY)
 #include "gl_model.h"
 #else
 #include "model.h"
@@ -104,8 +104,14 @@ typedef struct client_s
 // spawn parms are carried from level to level
 	float			spawn_parms[NUM_SPAWN_PARMS];
 
-// client known data for deltas	
+// client known data for deltas
 	int				old_frags;
+
+// svc_deltaentities, only if the client asked for it at signon
+	qboolean		deltaentities;
+	int				deltaframe;			// number of the next frame sent
+	int				deltaack;			// last frame the client decoded, -1 = none
+	deltaframe_t	deltaframes[DELTA_BACKUP];
 } client_t;
 
 
@@ -244,6 +250,7 @@ qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
 void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg);
+void SV_DeltaTest_f (void);
 
 void SV_MoveToGoal (void);
 
@@ -255,3 +262,85 @@ void SV_SpawnServer (char *server, char *startspot);
 #else
 void SV_SpawnServer (char *server);
 #endif
+
+//
+// sv_stats.c
+//
+typedef enum
+{
+	SVP_FRAME,			// Host_ServerFrame outside the phases below
+	SVP_NETPOLL,
+	SVP_NEWCLIENTS,
+	SVP_RUNCLIENTS,
+	SVP_STARTFRAME,
+	SVP_CLIENT,			// player physics, with PlayerPreThink/PostThink
+	SVP_PUSH,
+	SVP_NONE,
+	SVP_NOCLIP,
+	SVP_STEP,
+	SVP_TOSS,			// toss, bounce and fly
+	SVP_THINK,
+	SVP_SEND,
+	SVP_NUMPHASES
+} svphase_t;
+
+extern	cvar_t	sv_profile;
+extern	cvar_t	sv_statslog;
+
+extern	int		sv_stattraces;
+extern	int		sv_statlinks;
+
+void SV_StatsBeginTick (void);
+void SV_StatsEndTick (void);
+void SV_StatsEnter (svphase_t phase);
+void SV_StatsLeave (void);
+void SV_StatsClientBytes (client_t *client, int bytes);
+void SV_Stats_f (void);
+
+//
+// sv_think.c
+//
+extern	cvar_t	sv_thinkqueue;
+
+void SV_ThinkReset (void);
+void SV_ThinkChanged (edict_t *ed);
+void SV_ThinkBeginFrame (void);
+int SV_ThinkNext (int i);
+
+//
+// sv_hot.c
+//
+typedef struct
+{
+	vec3_t	absmin[MAX_EDICTS];			// as SV_LinkEdict set them
+	vec3_t	absmax[MAX_EDICTS];
+	float	solid[MAX_EDICTS];
+	byte	visible[MAX_EDICTS];		// modelindex and model set
+	byte	numleafs[MAX_EDICTS];
+	short	leafnums[MAX_EDICTS][MAX_ENT_LEAFS];
+} svhot_t;
+
+#define	SV_HOTNUM(e)	((int)(((byte *)(e) - (byte *)sv.edicts) / pr_edict_size))
+#define	SV_HOTOUTSIDE(e,mins,maxs)	((mins)[0] > sv_hot.absmax[e][0] \
+	|| (mins)[1] > sv_hot.absmax[e][1] || (mins)[2] > sv_hot.absmax[e][2] \
+	|| (maxs)[0] < sv_hot.absmin[e][0] || (maxs)[1] < sv_hot.absmin[e][1] \
+	|| (maxs)[2] < sv_hot.absmin[e][2])
+
+// entvars fields, in ints, whose writes by the progs sv_think.c and sv_hot.c
+// have to hear about
+#define	SV_WATCHEDFIELDS	((int)(sizeof(entvars_t)/4))
+#define	SV_WATCHEDFIELD(f)	((unsigned)(f) < SV_WATCHEDFIELDS && sv_watchedfields[f])
+
+extern	cvar_t	sv_hotfields;
+extern	svhot_t	sv_hot;
+extern	byte	sv_watchedfields[SV_WATCHEDFIELDS];
+
+void SV_HotInit (void);
+void SV_HotReset (void);
+void SV_HotChanged (edict_t *ed);
+void SV_FieldChanged (edict_t *ed);
+void SV_HotLink (edict_t *ent);
+void SV_HotSync (void);
+qboolean SV_HotVisible (int e, byte *pvs);
+qboolean SV_EntityVisible (edict_t *clent, edict_t *ent, int e, byte *pvs);
+void SV_HotBench_f (void);
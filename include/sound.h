@@ -102,6 +102,7 @@ void S_ExtraUpdate (void);
 
 sfx_t *S_PrecacheSound (char *sample);
 void S_TouchSound (char *sample);
+qboolean S_WillLoad (char *sample);
 void S_ClearPrecache (void);
 void S_BeginPrecaching (void);
 void S_EndPrecaching (void);
@@ -165,6 +166,7 @@ extern int		snd_blocked;
 
 void S_LocalSound (char *s);
 sfxcache_t *S_LoadSound (sfx_t *s);
+void S_DeferResampling (qboolean defer);
 
 wavinfo_t GetWavinfo (char *name, byte *wav, int wavlength);
 
@@ -36,6 +36,10 @@ int Sys_FileWrite (int handle, void *data, int count);
 int	Sys_FileTime (char *path);
 void Sys_mkdir (char *path);
 
+void *Sys_FileMap (int handle, int length);
+// a read-only view of the first length bytes of the file, shared with
+// anything else that maps it, or NULL if it can't be mapped
+
 //
 // memory protection
 //
@@ -65,6 +69,18 @@ void Sys_Sleep (void);
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
+//
+// worker threads
+//
+typedef void (*sys_jobfunc_t) (void *data, int index);
+
+int Sys_NumProcessors (void);
+
+void Sys_RunJobs (sys_jobfunc_t func, void *data, int count, int numthreads);
+// calls func (data, i) for every i in [0, count), spread across up to
+// numthreads threads including the caller.  Returns once all jobs are done.
+// With numthreads <= 1 the jobs run in order on the calling thread.
+
 void Sys_LowFPPrecision (void);
 void Sys_HighFPPrecision (void);
 void Sys_SetFPCW (void);
@@ -44,6 +44,19 @@ typedef struct
 
 void SV_ClearWorld (void);
 // called after the world model has been loaded, before linking any entities
+// picks the area structure from sv_area
+
+void SV_AreaBench_f (void);
+void SV_MoveBench_f (void);
+void SV_TraceTest_f (void);
+
+void SV_BenchSeed (unsigned seed);
+float SV_BenchRandom (float lo, float hi);
+void SV_BenchPoint (vec3_t p);
+int SV_BenchSpawn (edict_t **spawned, int count, vec3_t mins, vec3_t maxs);
+void SV_BenchRemove (edict_t **spawned, int count);
+// the random sequence and stand-in entities shared by the console benches.
+// SV_BenchRemove also takes back the edicts SV_BenchSpawn added at the end
 
 void SV_UnlinkEdict (edict_t *ent);
 // call before removing an entity, and before trying to move one,
@@ -53,9 +66,16 @@ void SV_UnlinkEdict (edict_t *ent);
 void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // Needs to be called any time an entity changes origin, mins, maxs, or solid
 // flags ent->v.modified
+
+void SV_TouchTriggers (edict_t *ent);
+// the touch_triggers part of SV_LinkEdict on its own
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list);
+// fills list (MAX_EDICTS long) with the linked entities whose abs box
+// touches the box, and returns how many there are
+
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
@@ -76,3 +96,23 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 // shouldn't be considered solid objects
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
+
+extern	qboolean	sv_parallelmoves;
+// set while SV_Move is called from worker threads.  nothing may link or
+// unlink entities then, and the world trace memo is bypassed
+
+extern	int			sv_worldchanges;
+// counts the links and unlinks, for whoever wants to know if a trace
+// made earlier could come out differently now
+
+typedef struct
+{
+	vec3_t		start, mins, maxs, end;
+	int			type;
+	edict_t		*passedict;
+	trace_t		trace;			// result
+} batchmove_t;
+
+void SV_MoveBatch (batchmove_t *moves, int nummoves);
+// the same as calling SV_Move for each move, but the area links are only
+// walked once for the whole group.  the moves must not depend on each other
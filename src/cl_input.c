@@ -381,6 +381,15 @@ void CL_SendMove (usercmd_t *cmd)
 	MSG_WriteByte (&buf, cmd->lightlevel);
 #endif
 
+//
+// acknowledge the last delta entity frame decoded
+//
+	if (cl.deltaentities)
+	{
+		MSG_WriteByte (&buf, clc_deltaack);
+		MSG_WriteLong (&buf, cl.deltaack);
+	}
+
 //
 // deliver the message
 //
@@ -30,6 +30,7 @@ cvar_t	cl_color = {"_cl_color", "0", true};
 
 cvar_t	cl_shownet = {"cl_shownet","0"};	// can be 0, 1, or 2
 cvar_t	cl_nolerp = {"cl_nolerp","0"};
+cvar_t	cl_deltaentities = {"cl_deltaentities","1"};	// ask the server for svc_deltaentities
 
 cvar_t	lookspring = {"lookspring","0", true};
 cvar_t	lookstrafe = {"lookstrafe","0", true};
@@ -86,6 +87,10 @@ void CL_ClearState (void)
 	for (i=0 ; i<MAX_EFRAGS-1 ; i++)
 		cl.free_efrags[i].entnext = &cl.free_efrags[i+1];
 	cl.free_efrags[i].entnext = NULL;
+
+	for (i=0 ; i<DELTA_BACKUP ; i++)
+		cl.deltaframes[i].framenum = -1;
+	cl.deltaack = -1;
 }
 
 /*
@@ -100,6 +105,10 @@ void CL_Disconnect (void)
 {
 // stop sounds (especially looping!)
 	S_StopAllSounds (true);
+
+// finish anything a signon that was cut short left behind
+	S_ClearPrecache ();
+	COM_FreePrefetched ();
 	
 // bring the console down and fade the colors back to normal
 //	SCR_BringDownConsole ();
@@ -181,6 +190,12 @@ Con_DPrintf ("CL_SignonReply: %i\n", cls.signon);
 	switch (cls.signon)
 	{
 	case 1:
+		if (cl_deltaentities.value)
+		{
+			MSG_WriteByte (&cls.message, clc_stringcmd);
+			MSG_WriteString (&cls.message, "deltaentities");
+		}
+
 		MSG_WriteByte (&cls.message, clc_stringcmd);
 		MSG_WriteString (&cls.message, "prespawn");
 		break;
@@ -735,6 +750,7 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_anglespeedkey);
 	Cvar_RegisterVariable (&cl_shownet);
 	Cvar_RegisterVariable (&cl_nolerp);
+	Cvar_RegisterVariable (&cl_deltaentities);
 	Cvar_RegisterVariable (&lookspring);
 	Cvar_RegisterVariable (&lookstrafe);
 	Cvar_RegisterVariable (&sensitivity);
@@ -0,0 +1,161 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_null.c -- client, menu and screen stand-ins for the dedicated server
+
+// The shared host, console and net code still refers to client state, but
+// in a SERVERONLY build cls.state is always ca_dedicated so none of these
+// paths do anything.  V_CalcRoll is the exception: sv_user uses it for the
+// player view roll, so it and its cvars are kept.
+
+#include "quakedef.h"
+
+#define		MAXCMDLINE	256
+
+client_static_t	cls;
+client_state_t	cl;
+
+cvar_t	cl_name = {"_cl_name", "player", true};
+cvar_t	cl_color = {"_cl_color", "0", true};
+
+cvar_t	cl_rollspeed = {"cl_rollspeed", "200"};
+cvar_t	cl_rollangle = {"cl_rollangle", "2.0"};
+
+keydest_t	key_dest;
+int			key_count;
+char		key_lines[32][MAXCMDLINE];
+int			key_linepos;
+int			edit_line;
+char		chat_buffer[32];
+qboolean	team_message;
+
+viddef_t	vid;
+int			clearnotify;
+int			scr_copytop;
+qboolean	scr_disabled_for_loading;
+float		scr_centertime_off;
+
+int			m_state;
+int			m_return_state;
+qboolean	m_return_onerror;
+char		m_return_reason[32];
+
+/*
+===============
+V_Init
+===============
+*/
+void V_Init (void)
+{
+	Cvar_RegisterVariable (&cl_rollspeed);
+	Cvar_RegisterVariable (&cl_rollangle);
+}
+
+/*
+===============
+V_CalcRoll
+
+Used by sv_user
+===============
+*/
+float V_CalcRoll (vec3_t angles, vec3_t velocity)
+{
+	vec3_t	forward, right, up;
+	float	sign;
+	float	side;
+	float	value;
+
+	AngleVectors (angles, forward, right, up);
+	side = DotProduct (velocity, right);
+	sign = side < 0 ? -1 : 1;
+	side = fabs(side);
+
+	value = cl_rollangle.value;
+
+	if (side < cl_rollspeed.value)
+		side = side * value / cl_rollspeed.value;
+	else
+		side = value;
+
+	return side*sign;
+}
+
+void CL_Disconnect (void)
+{
+}
+
+void CL_Disconnect_f (void)
+{
+}
+
+void CL_EstablishConnection (char *host)
+{
+}
+
+void CL_NextDemo (void)
+{
+}
+
+void CL_StopPlayback (void)
+{
+}
+
+void M_Menu_Main_f (void)
+{
+}
+
+void M_Menu_Quit_f (void)
+{
+}
+
+void SCR_BeginLoadingPlaque (void)
+{
+}
+
+void SCR_EndLoadingPlaque (void)
+{
+}
+
+void SCR_UpdateScreen (void)
+{
+}
+
+void Draw_Character (int x, int y, int num)
+{
+}
+
+void Draw_String (int x, int y, char *str)
+{
+}
+
+void Draw_ConsoleBackground (int lines)
+{
+}
+
+void Draw_BeginDisc (void)
+{
+}
+
+void Draw_EndDisc (void)
+{
+}
+
+void S_LocalSound (char *sound)
+{
+}
@@ -64,7 +64,8 @@ char *svc_strings[] =
 	"svc_finale",			// [string] music [string] text
 	"svc_cdtrack",			// [byte] track [byte] looptrack
 	"svc_sellscreen",
-	"svc_cutscene"
+	"svc_cutscene",
+	"svc_deltaentities"
 };
 
 //=============================================================================
@@ -205,9 +206,11 @@ void CL_ParseServerInfo (void)
 {
 	char	*str;
 	int		i;
-	int		nummodels, numsounds;
+	int		nummodels, numsounds, numprefetch;
 	char	model_precache[MAX_MODELS][MAX_QPATH];
 	char	sound_precache[MAX_SOUNDS][MAX_QPATH];
+	char	sound_paths[MAX_SOUNDS][MAX_QPATH];
+	char	*prefetch[MAX_MODELS+MAX_SOUNDS];
 	
 	Con_DPrintf ("Serverinfo packet received.\n");
 //
@@ -281,6 +284,23 @@ void CL_ParseServerInfo (void)
 		S_TouchSound (str);
 	}
 
+//
+// read what isn't loaded yet on the worker threads first.  on a listen
+// server the map and its brush models are, and alias models and sounds
+// are often still in the cache
+//
+	numprefetch = 0;
+	for (i=1 ; i<nummodels ; i++)
+		if (Mod_WillLoad (model_precache[i], false))
+			prefetch[numprefetch++] = model_precache[i];
+	for (i=1 ; i<numsounds ; i++)
+		if (S_WillLoad (sound_precache[i]))
+		{
+			sprintf (sound_paths[i], "sound/%.*s", MAX_QPATH-7, sound_precache[i]);
+			prefetch[numprefetch++] = sound_paths[i];
+		}
+	COM_PrefetchFiles (prefetch, numprefetch);
+
 //
 // now we try to load everything else until a cache allocation fails
 //
@@ -291,6 +311,7 @@ void CL_ParseServerInfo (void)
 		if (cl.model_precache[i] == NULL)
 		{
 			Con_Printf("Model %s not found\n", model_precache[i]);
+			COM_FreePrefetched ();
 			return;
 		}
 		CL_KeepaliveMessage ();
@@ -303,6 +324,7 @@ void CL_ParseServerInfo (void)
 		CL_KeepaliveMessage ();
 	}
 	S_EndPrecaching ();
+	COM_FreePrefetched ();
 
 
 // local state
@@ -318,65 +340,30 @@ void CL_ParseServerInfo (void)
 
 /*
 ==================
-CL_ParseUpdate
+CL_UpdateEntity
 
-Parse an entity update message from the server
+Sets entity num to state, as received in the current message.
 If an entities model or origin changes from frame to frame, it must be
 relinked.  Other attributes can change without relinking.
 ==================
 */
-int	bitcounts[16];
-
-void CL_ParseUpdate (int bits)
+static void CL_UpdateEntity (int num, entity_state_t *state, qboolean nolerp)
 {
 	int			i;
 	model_t		*model;
-	int			modnum;
 	qboolean	forcelink;
 	entity_t	*ent;
-	int			num;
-	int			skin;
-
-	if (cls.signon == SIGNONS - 1)
-	{	// first update is the final signon stage
-		cls.signon = SIGNONS;
-		CL_SignonReply ();
-	}
-
-	if (bits & U_MOREBITS)
-	{
-		i = MSG_ReadByte ();
-		bits |= (i<<8);
-	}
-
-	if (bits & U_LONGENTITY)	
-		num = MSG_ReadShort ();
-	else
-		num = MSG_ReadByte ();
 
 	ent = CL_EntityNum (num);
 
-for (i=0 ; i<16 ; i++)
-if (bits&(1<<i))
-	bitcounts[i]++;
-
 	if (ent->msgtime != cl.mtime[1])
 		forcelink = true;	// no previous frame to lerp from
 	else
 		forcelink = false;
 
 	ent->msgtime = cl.mtime[0];
-	
-	if (bits & U_MODEL)
-	{
-		modnum = MSG_ReadByte ();
-		if (modnum >= MAX_MODELS)
-			Host_Error ("CL_ParseModel: bad modnum");
-	}
-	else
-		modnum = ent->baseline.modelindex;
-		
-	model = cl.model_precache[modnum];
+
+	model = cl.model_precache[state->modelindex];
 	if (model != ent->model)
 	{
 		ent->model = model;
@@ -396,16 +383,10 @@ if (bits&(1<<i))
 			R_TranslatePlayerSkin (num - 1);
 #endif
 	}
-	
-	if (bits & U_FRAME)
-		ent->frame = MSG_ReadByte ();
-	else
-		ent->frame = ent->baseline.frame;
 
-	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
-	else
-		i = ent->baseline.colormap;
+	ent->frame = state->frame;
+
+	i = state->colormap;
 	if (!i)
 		ent->colormap = vid.colormap;
 	else
@@ -416,61 +397,25 @@ if (bits&(1<<i))
 	}
 
 #ifdef GLQUAKE
-	if (bits & U_SKIN)
-		skin = MSG_ReadByte();
-	else
-		skin = ent->baseline.skin;
-	if (skin != ent->skinnum) {
-		ent->skinnum = skin;
+	if (state->skin != ent->skinnum) {
+		ent->skinnum = state->skin;
 		if (num > 0 && num <= cl.maxclients)
 			R_TranslatePlayerSkin (num - 1);
 	}
-
 #else
-
-	if (bits & U_SKIN)
-		ent->skinnum = MSG_ReadByte();
-	else
-		ent->skinnum = ent->baseline.skin;
+	ent->skinnum = state->skin;
 #endif
 
-	if (bits & U_EFFECTS)
-		ent->effects = MSG_ReadByte();
-	else
-		ent->effects = ent->baseline.effects;
+	ent->effects = state->effects;
 
 // shift the known values for interpolation
 	VectorCopy (ent->msg_origins[0], ent->msg_origins[1]);
 	VectorCopy (ent->msg_angles[0], ent->msg_angles[1]);
 
-	if (bits & U_ORIGIN1)
-		ent->msg_origins[0][0] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][0] = ent->baseline.origin[0];
-	if (bits & U_ANGLE1)
-		ent->msg_angles[0][0] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][0] = ent->baseline.angles[0];
+	VectorCopy (state->origin, ent->msg_origins[0]);
+	VectorCopy (state->angles, ent->msg_angles[0]);
 
-	if (bits & U_ORIGIN2)
-		ent->msg_origins[0][1] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][1] = ent->baseline.origin[1];
-	if (bits & U_ANGLE2)
-		ent->msg_angles[0][1] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][1] = ent->baseline.angles[1];
-
-	if (bits & U_ORIGIN3)
-		ent->msg_origins[0][2] = MSG_ReadCoord ();
-	else
-		ent->msg_origins[0][2] = ent->baseline.origin[2];
-	if (bits & U_ANGLE3)
-		ent->msg_angles[0][2] = MSG_ReadAngle();
-	else
-		ent->msg_angles[0][2] = ent->baseline.angles[2];
-
-	if ( bits & U_NOLERP )
+	if ( nolerp )
 		ent->forcelink = true;
 
 	if ( forcelink )
@@ -483,6 +428,221 @@ if (bits&(1<<i))
 	}
 }
 
+/*
+==================
+CL_ParseUpdate
+
+Parse an entity update message from the server
+==================
+*/
+int	bitcounts[16];
+
+void CL_ParseUpdate (int bits)
+{
+	int			i;
+	int			num;
+	entity_state_t	state;
+
+	if (cls.signon == SIGNONS - 1)
+	{	// first update is the final signon stage
+		cls.signon = SIGNONS;
+		CL_SignonReply ();
+	}
+
+	if (bits & U_MOREBITS)
+	{
+		i = MSG_ReadByte ();
+		bits |= (i<<8);
+	}
+
+	if (bits & U_LONGENTITY)	
+		num = MSG_ReadShort ();
+	else
+		num = MSG_ReadByte ();
+
+for (i=0 ; i<16 ; i++)
+if (bits&(1<<i))
+	bitcounts[i]++;
+
+	state = CL_EntityNum (num)->baseline;
+
+	if (bits & U_MODEL)
+	{
+		state.modelindex = MSG_ReadByte ();
+		if (state.modelindex >= MAX_MODELS)
+			Host_Error ("CL_ParseModel: bad modnum");
+	}
+	if (bits & U_FRAME)
+		state.frame = MSG_ReadByte ();
+	if (bits & U_COLORMAP)
+		state.colormap = MSG_ReadByte();
+	if (bits & U_SKIN)
+		state.skin = MSG_ReadByte();
+	if (bits & U_EFFECTS)
+		state.effects = MSG_ReadByte();
+
+	if (bits & U_ORIGIN1)
+		state.origin[0] = MSG_ReadCoord ();
+	if (bits & U_ANGLE1)
+		state.angles[0] = MSG_ReadAngle();
+	if (bits & U_ORIGIN2)
+		state.origin[1] = MSG_ReadCoord ();
+	if (bits & U_ANGLE2)
+		state.angles[1] = MSG_ReadAngle();
+	if (bits & U_ORIGIN3)
+		state.origin[2] = MSG_ReadCoord ();
+	if (bits & U_ANGLE3)
+		state.angles[2] = MSG_ReadAngle();
+
+	CL_UpdateEntity (num, &state, (bits & U_NOLERP) != 0);
+}
+
+/*
+==================
+CL_AddDeltaEntity
+
+Must drop entities the same way SV_AddDeltaEntity does
+==================
+*/
+static void CL_AddDeltaEntity (deltaframe_t *frame, deltaentity_t *ent)
+{
+	if (frame->numentities < MAX_DELTA_ENTITIES)
+		frame->entities[frame->numentities++] = *ent;
+}
+
+/*
+==================
+CL_ParseDeltaEntities
+
+svc_deltaentities.  Entities not mentioned keep their state from the delta
+frame.  If that frame is gone the message is read and thrown away, and the
+next ack asks for a full frame.
+==================
+*/
+void CL_ParseDeltaEntities (void)
+{
+	static deltaframe_t	discard;
+	static deltaentity_t	null;
+	deltaframe_t	*from, *to;
+	deltaentity_t	ent;
+	int			framenum, deltanum;
+	int			bits, num, i, oldindex;
+	entity_state_t	state;
+
+	if (cls.signon == SIGNONS - 1)
+	{	// first update is the final signon stage
+		cls.signon = SIGNONS;
+		CL_SignonReply ();
+	}
+
+	cl.deltaentities = true;
+
+	framenum = MSG_ReadLong ();
+	deltanum = MSG_ReadLong ();
+
+	to = &cl.deltaframes[framenum & DELTA_MASK];
+	from = NULL;
+	if (deltanum != -1)
+	{
+		from = &cl.deltaframes[deltanum & DELTA_MASK];
+		if (from->framenum != deltanum || from == to)
+		{
+			Con_DPrintf ("delta from missing frame %i\n", deltanum);
+			to = &discard;
+			from = NULL;
+		}
+	}
+	to->framenum = -1;
+	to->numentities = 0;
+
+	oldindex = 0;
+	while (1)
+	{
+		bits = MSG_ReadByte ();
+		if (msg_badread)
+			Host_Error ("CL_ParseDeltaEntities: end of message");
+		if (!bits)
+			break;
+		if (bits & U_MOREBITS)
+			bits |= MSG_ReadByte () << 8;
+		if (bits & U_LONGENTITY)
+			num = MSG_ReadShort ();
+		else
+			num = MSG_ReadByte ();
+		if (num <= 0 || num >= MAX_EDICTS)
+			Host_Error ("CL_ParseDeltaEntities: bad entity %i", num);
+
+	// entities before this one are unchanged
+		while (from && oldindex < from->numentities && from->entities[oldindex].number < num)
+			CL_AddDeltaEntity (to, &from->entities[oldindex++]);
+
+		if (from && oldindex < from->numentities && from->entities[oldindex].number == num)
+			ent = from->entities[oldindex++];
+		else
+		{
+			ent = null;
+			ent.number = num;
+		}
+
+		if (bits & U_REMOVE)
+			continue;
+
+		ent.flags = bits & U_NOLERP;
+		if (bits & U_MODEL)
+			ent.modelindex = MSG_ReadByte ();
+		if (bits & U_FRAME)
+			ent.frame = MSG_ReadByte ();
+		if (bits & U_COLORMAP)
+			ent.colormap = MSG_ReadByte ();
+		if (bits & U_SKIN)
+			ent.skin = MSG_ReadByte ();
+		if (bits & U_EFFECTS)
+			ent.effects = MSG_ReadByte ();
+		if (bits & U_ORIGIN1)
+			ent.origin[0] = MSG_ReadShort ();
+		if (bits & U_ANGLE1)
+			ent.angles[0] = MSG_ReadByte ();
+		if (bits & U_ORIGIN2)
+			ent.origin[1] = MSG_ReadShort ();
+		if (bits & U_ANGLE2)
+			ent.angles[1] = MSG_ReadByte ();
+		if (bits & U_ORIGIN3)
+			ent.origin[2] = MSG_ReadShort ();
+		if (bits & U_ANGLE3)
+			ent.angles[2] = MSG_ReadByte ();
+
+		CL_AddDeltaEntity (to, &ent);
+	}
+
+	while (from && oldindex < from->numentities)
+		CL_AddDeltaEntity (to, &from->entities[oldindex++]);
+
+	if (to == &discard)
+	{
+		cl.deltaack = -1;
+		return;
+	}
+	to->framenum = framenum;
+	cl.deltaack = framenum;
+
+// every entity in the frame is current, the rest stop being drawn
+	for (num=0 ; num<to->numentities ; num++)
+	{
+		ent = to->entities[num];
+		state.modelindex = ent.modelindex;
+		state.frame = ent.frame;
+		state.colormap = ent.colormap;
+		state.skin = ent.skin;
+		state.effects = ent.effects;
+		for (i=0 ; i<3 ; i++)
+		{
+			state.origin[i] = ent.origin[i] * (1.0/8);
+			state.angles[i] = (signed char)ent.angles[i] * (360.0/256);
+		}
+		CL_UpdateEntity (ent.number, &state, ent.flags & U_NOLERP);
+	}
+}
+
 /*
 ==================
 CL_ParseBaseline
@@ -957,6 +1117,10 @@ void CL_ParseServerMessage (void)
 		case svc_sellscreen:
 			Cmd_ExecuteString ("help", src_command);
 			break;
+
+		case svc_deltaentities:
+			CL_ParseDeltaEntities ();
+			break;
 		}
 	}
 }
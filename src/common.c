@@ -32,6 +32,8 @@ static char     *safeargvs[NUM_SAFE_ARGVS] =
 
 cvar_t  registered = {"registered","0"};
 cvar_t  cmdline = {"cmdline","0", false, true};
+cvar_t  com_findlog = {"com_findlog","0"};
+cvar_t  com_prefetchthreads = {"com_prefetchthreads","4"};
 
 qboolean        com_modified;   // set true if using non-id files
 
@@ -1048,6 +1050,7 @@ void COM_CheckRegistered (void)
 
 
 void COM_Path_f (void);
+void COM_PrefetchBench_f (void);
 
 
 /*
@@ -1151,7 +1154,10 @@ void COM_Init (char *basedir)
 
 	Cvar_RegisterVariable (&registered);
 	Cvar_RegisterVariable (&cmdline);
+	Cvar_RegisterVariable (&com_findlog);
+	Cvar_RegisterVariable (&com_prefetchthreads);
 	Cmd_AddCommand ("path", COM_Path_f);
+	Cmd_AddCommand ("prefetchbench", COM_PrefetchBench_f);
 
 	COM_InitFilesystem ();
 	COM_CheckRegistered ();
@@ -1200,6 +1206,7 @@ QUAKE FILESYSTEM
 */
 
 int     com_filesize;
+byte    *com_filemap;           // the last file found, in its pak's mapping
 
 
 //
@@ -1210,6 +1217,10 @@ typedef struct
 {
 	char    name[MAX_QPATH];
 	int             filepos, filelen;
+	int             complen;        // bytes in the pak, less than filelen if deflated
+	int             method;         // ZIP_STORED or ZIP_DEFLATED
+	unsigned        crc;            // of a deflated file, checked when it is inflated
+	qboolean        local;          // filepos is still at the zip local header
 } packfile_t;
 
 typedef struct pack_s
@@ -1218,6 +1229,8 @@ typedef struct pack_s
 	int             handle;
 	int             numfiles;
 	packfile_t      *files;
+	int             length;
+	byte            *base;          // the whole pak mapped, NULL if it isn't
 } pack_t;
 
 //
@@ -1238,6 +1251,20 @@ typedef struct
 
 #define MAX_FILES_IN_PACK       2048
 
+//
+// zip files, read through the central directory at the end
+//
+#define ZIP_STORED              0
+#define ZIP_DEFLATED            8
+
+#define ZIP_ENDSIG              0x06054b50
+#define ZIP_ENDSIZE             22
+#define ZIP_MAXCOMMENT          65535
+#define ZIP_DIRSIG              0x02014b50
+#define ZIP_DIRSIZE             46
+#define ZIP_LOCALSIG            0x04034b50
+#define ZIP_LOCALSIZE           30
+
 char    com_cachedir[MAX_OSPATH];
 char    com_gamedir[MAX_OSPATH];
 
@@ -1250,6 +1277,690 @@ typedef struct searchpath_s
 
 searchpath_t    *com_searchpaths;
 
+//
+// every file in the pak files, the one found first by the search path
+// taking the name
+//
+typedef struct
+{
+	packfile_t      *file;          // NULL = empty slot
+	searchpath_t    *search;
+} packindex_t;
+
+packindex_t     *com_packindex;
+int             com_packindexsize;      // power of two
+int             com_packindexfiles;
+
+/*
+============
+COM_HashName
+============
+*/
+static unsigned COM_HashName (char *name)
+{
+	unsigned        hash;
+
+	hash = 0;
+	while (*name)
+		hash = hash*33 + *(byte *)name++;
+	return hash;
+}
+
+/*
+============
+COM_IndexPacks
+
+Called whenever the search path changes
+============
+*/
+static void COM_IndexPacks (void)
+{
+	searchpath_t    *search;
+	packfile_t      *file;
+	packindex_t     *slot;
+	int             i, total;
+	unsigned        h;
+
+	total = 0;
+	for (search = com_searchpaths ; search ; search = search->next)
+		if (search->pack)
+			total += search->pack->numfiles;
+
+	free (com_packindex);
+	for (com_packindexsize = 64 ; com_packindexsize < total*2 ; com_packindexsize <<= 1)
+		;
+	com_packindex = calloc (com_packindexsize, sizeof(packindex_t));
+	if (!com_packindex)
+		Sys_Error ("COM_IndexPacks: out of memory");
+	com_packindexfiles = 0;
+
+	for (search = com_searchpaths ; search ; search = search->next)
+	{
+		if (!search->pack)
+			continue;
+		for (i=0, file=search->pack->files ; i<search->pack->numfiles ; i++, file++)
+		{
+			if (!file->name[0])
+				continue;       // dropped by COM_ResolveZipFile
+			h = COM_HashName (file->name);
+			for ( ; ; h++)
+			{
+				slot = &com_packindex[h & (com_packindexsize-1)];
+				if (!slot->file || !strcmp (slot->file->name, file->name))
+					break;
+			}
+			if (slot->file)
+				continue;       // an earlier path has it
+			slot->file = file;
+			slot->search = search;
+			com_packindexfiles++;
+		}
+	}
+}
+
+/*
+============
+COM_IndexedFile
+
+The search path entry whose pak has the name first, NULL if no pak has it
+============
+*/
+static packindex_t *COM_IndexedFile (char *filename)
+{
+	packindex_t     *slot;
+	unsigned        h;
+
+	if (!com_packindex)
+		return NULL;
+	for (h = COM_HashName (filename) ; ; h++)
+	{
+		slot = &com_packindex[h & (com_packindexsize-1)];
+		if (!slot->file)
+			return NULL;
+		if (!strcmp (slot->file->name, filename))
+			return slot;
+	}
+}
+
+/*
+=============================================================================
+
+ZIP FILES
+
+A zip is a pack whose files may be deflated.  Its central directory gives
+the names, sizes and local header offsets; the local headers are only
+read when a file is first opened, to find where its data starts.  Stored
+files are read like any pak file, from the mapping if there is one.
+Deflated files are inflated whole by COM_LoadFile, or into a temporary
+file for COM_FOpenFile.  The CRC-32 of every inflated file is checked,
+and a file that doesn't inflate to its size and CRC is dropped from the
+zip with a warning, as one with a bad local header is.
+
+=============================================================================
+*/
+
+static searchpath_t     *com_foundsearch;       // set by COM_FindFile
+static packfile_t       *com_foundfile;         // and this for a pak hit
+
+static int ZipShort (byte *p)
+{
+	return p[0] | (p[1]<<8);
+}
+
+static int ZipLong (byte *p)
+{
+	return p[0] | (p[1]<<8) | (p[2]<<16) | (p[3]<<24);
+}
+
+/*
+============
+COM_ResolveZipFile
+
+Moves filepos from the local header to the data after it.  A file with a
+bad local header is dropped from the zip, and the packs are indexed again
+so a copy further down the search path is found instead.
+============
+*/
+static qboolean COM_ResolveZipFile (pack_t *pak, packfile_t *file)
+{
+	byte    local[ZIP_LOCALSIZE];
+	int             pos;
+
+	pos = -1;
+	if (file->filepos <= pak->length - ZIP_LOCALSIZE)
+	{
+		if (pak->base)
+			memcpy (local, pak->base + file->filepos, ZIP_LOCALSIZE);
+		else
+		{
+			Sys_FileSeek (pak->handle, file->filepos);
+			Sys_FileRead (pak->handle, local, ZIP_LOCALSIZE);
+		}
+		if (ZipLong (local) == ZIP_LOCALSIG)
+			pos = file->filepos + ZIP_LOCALSIZE + ZipShort (local+26) + ZipShort (local+28);
+	}
+
+	if (pos < 0 || pos > pak->length - file->complen)
+	{
+		Con_Printf ("%s: bad local header for %s\n", pak->filename, file->name);
+		file->name[0] = 0;
+		COM_IndexPacks ();
+		return false;
+	}
+
+	file->filepos = pos;
+	file->local = false;
+	return true;
+}
+
+/*
+============
+COM_ZipData
+
+The compressed bytes of a deflated file, from the mapping or read into
+memory that *freein says to free
+============
+*/
+static byte *COM_ZipData (pack_t *pak, packfile_t *file, qboolean *freein)
+{
+	byte    *in;
+
+	if (pak->base)
+	{
+		*freein = false;
+		return pak->base + file->filepos;
+	}
+
+	in = malloc (file->complen + 1);
+	if (!in)
+		Sys_Error ("COM_ZipData: out of memory for %s", file->name);
+	Draw_BeginDisc ();
+	Sys_FileSeek (pak->handle, file->filepos);
+	Sys_FileRead (pak->handle, in, file->complen);
+	Draw_EndDisc ();
+	*freein = true;
+	return in;
+}
+
+/*
+============
+COM_InflateFile
+
+Fills out with the filelen bytes of a deflated file.  A corrupt file is
+dropped from the zip, and the packs are indexed again so a copy further
+down the search path is found instead.
+============
+*/
+static qboolean COM_InflateFile (pack_t *pak, packfile_t *file, byte *out)
+{
+	byte            *in;
+	qboolean        freein;
+	int                     len;
+
+	in = COM_ZipData (pak, file, &freein);
+	len = Inflate (out, file->filelen, in, file->complen);
+	if (freein)
+		free (in);
+	if (len != file->filelen || CRC_Zip (out, len) != file->crc)
+	{
+		Con_Printf ("%s: %s is corrupt\n", pak->filename, file->name);
+		file->name[0] = 0;
+		COM_IndexPacks ();
+		return false;
+	}
+	return true;
+}
+
+/*
+============
+COM_InflateTempFile
+
+A deflated file for COM_FOpenFile, inflated into a temporary file
+============
+*/
+static FILE *COM_InflateTempFile (pack_t *pak, packfile_t *file)
+{
+	FILE    *f;
+	byte    *buf;
+
+	f = tmpfile ();
+	if (!f)
+		return NULL;
+	buf = malloc (file->filelen + 1);
+	if (!buf)
+		Sys_Error ("COM_InflateTempFile: out of memory for %s", file->name);
+	if (!COM_InflateFile (pak, file, buf))
+	{
+		free (buf);
+		fclose (f);
+		return NULL;
+	}
+	fwrite (buf, 1, file->filelen, f);
+	free (buf);
+	rewind (f);
+	return f;
+}
+
+/*
+=================
+COM_LoadZipFile
+
+Takes an explicit path to a zip (pk3) file, as COM_LoadPackFile does.
+A zip whose central directory is damaged is left out, with a warning.
+=================
+*/
+pack_t *COM_LoadZipFile (char *zipfile)
+{
+	byte            tail[ZIP_ENDSIZE + ZIP_MAXCOMMENT];
+	byte            *dir, *p, *end, *next;
+	packfile_t      *newfiles, *file;
+	pack_t          *pack;
+	int                     ziphandle, ziplen, mark;
+	int                     i, n, numentries, numfiles, dirofs, dirlen, namelen;
+
+	ziplen = Sys_FileOpenRead (zipfile, &ziphandle);
+	if (ziplen == -1)
+		return NULL;
+	mark = Hunk_LowMark ();
+
+// find the end of central directory record, which the comment follows
+	n = ziplen < sizeof(tail) ? ziplen : sizeof(tail);
+	Sys_FileSeek (ziphandle, ziplen - n);
+	Sys_FileRead (ziphandle, tail, n);
+	for (i = n - ZIP_ENDSIZE ; i >= 0 ; i--)
+		if (ZipLong (tail+i) == ZIP_ENDSIG)
+			break;
+	if (i < 0)
+	{
+		Con_Printf ("%s is not a zip file\n", zipfile);
+		Sys_FileClose (ziphandle);
+		return NULL;
+	}
+	numentries = ZipShort (tail+i+10);
+	dirlen = ZipLong (tail+i+12);
+	dirofs = ZipLong (tail+i+16);
+	if (dirlen < 0 || dirofs < 0 || dirofs > ziplen - dirlen)
+		goto baddir;
+
+	dir = malloc (dirlen + 1);
+	if (!dir)
+		Sys_Error ("COM_LoadZipFile: out of memory for %s", zipfile);
+	Sys_FileSeek (ziphandle, dirofs);
+	Sys_FileRead (ziphandle, dir, dirlen);
+
+	newfiles = Hunk_AllocName (numentries * sizeof(packfile_t), "packfile");
+	numfiles = 0;
+	end = dir + dirlen;
+	for (i=0, p=dir ; i<numentries ; i++, p=next)
+	{
+		if (end - p < ZIP_DIRSIZE || ZipLong (p) != ZIP_DIRSIG)
+			break;
+		namelen = ZipShort (p+28);
+		next = p + ZIP_DIRSIZE + namelen + ZipShort (p+30) + ZipShort (p+32);
+		if (next > end)
+			break;
+
+	// skip directories, long names, other methods and zip64 sizes
+		file = &newfiles[numfiles];
+		file->method = ZipShort (p+10);
+		file->crc = (unsigned)ZipLong (p+16);
+		file->complen = ZipLong (p+20);
+		file->filelen = ZipLong (p+24);
+		file->filepos = ZipLong (p+42);
+		if (!namelen || namelen >= MAX_QPATH || p[ZIP_DIRSIZE+namelen-1] == '/')
+			continue;
+		if (file->method != ZIP_STORED && file->method != ZIP_DEFLATED)
+			continue;
+		if (file->complen < 0 || file->filelen < 0 || file->filepos < 0)
+			continue;
+		if (file->method == ZIP_STORED && file->complen != file->filelen)
+			continue;
+
+		memcpy (file->name, p + ZIP_DIRSIZE, namelen);
+		file->name[namelen] = 0;
+		file->local = true;
+		numfiles++;
+	}
+	free (dir);
+	if (i < numentries)
+	{
+		Hunk_FreeToLowMark (mark);
+		goto baddir;
+	}
+
+	com_modified = true;    // not the original file
+
+	pack = Hunk_Alloc (sizeof (pack_t));
+	strcpy (pack->filename, zipfile);
+	pack->handle = ziphandle;
+	pack->numfiles = numfiles;
+	pack->files = newfiles;
+	pack->length = ziplen;
+	if (!COM_CheckParm ("-nomappaks"))
+		pack->base = Sys_FileMap (ziphandle, ziplen);
+
+	Con_Printf ("Added zipfile %s (%i files%s)\n", zipfile, numfiles, pack->base ? ", mapped" : "");
+	return pack;
+
+baddir:
+	Con_Printf ("%s has a bad central directory\n", zipfile);
+	Sys_FileClose (ziphandle);
+	return NULL;
+}
+
+/*
+=============================================================================
+
+PREFETCHING
+
+COM_PrefetchFiles is given every file a map is about to load, and reads
+them on the worker threads before the loads start, so the reads and
+inflates overlap instead of waiting for each other.  Each file is looked
+up on the main thread as COM_FindFile would, and read by a worker through
+a FILE of its own.  COM_LoadFile then copies the file from memory if it
+comes from the same place.  Stored files in mapped paks are only touched
+a page at a time, since their loads use the mapping anyway.
+
+=============================================================================
+*/
+
+typedef struct
+{
+	char            name[MAX_QPATH];
+	char            path[MAX_OSPATH];       // for a file in a directory
+	searchpath_t    *search;        // where COM_FindFile will find it
+	packfile_t      *file;          // NULL for a file in a directory
+	int             len;
+	byte            *data;          // NULL once taken, or if it couldn't be read
+} prefetch_t;
+
+static prefetch_t       *com_prefetch;
+static int              com_numprefetch;
+
+/*
+============
+COM_PrefetchThreads
+
+How many worker threads to spread load time work over
+============
+*/
+int COM_PrefetchThreads (void)
+{
+	int             threads;
+
+	threads = Sys_NumProcessors ();
+	if (threads > com_prefetchthreads.value)
+		threads = com_prefetchthreads.value;
+	if (threads < 1)
+		threads = 1;
+	return threads;
+}
+
+/*
+============
+COM_PrefetchJob
+============
+*/
+static void COM_PrefetchJob (void *data, int index)
+{
+	prefetch_t      *pre;
+	pack_t          *pak;
+	packfile_t      *file;
+	byte            *in;
+	FILE            *f;
+	int             i, pos, inlen;
+	volatile byte   touch;
+
+	pre = (prefetch_t *)data + index;
+	pak = pre->search->pack;
+	file = pre->file;
+
+	if (pak && pak->base && file->method == ZIP_STORED)
+	{       // COM_LoadFile will use the mapping, so only fault it in
+		for (i=0 ; i<file->filelen ; i+=4096)
+			touch = pak->base[file->filepos + i];
+		(void)touch;
+		return;
+	}
+
+	pre->data = malloc (pre->len + 1);
+	if (!pre->data)
+		return;
+	inlen = file ? file->complen : pre->len;
+
+	if (pak && pak->base)
+		in = pak->base + file->filepos;
+	else
+	{
+		in = pre->data;
+		if (file && file->method == ZIP_DEFLATED)
+			in = malloc (inlen + 1);
+		f = fopen (pak ? pak->filename : pre->path, "rb");
+		pos = file ? file->filepos : 0;
+		if (!in || !f || fseek (f, pos, SEEK_SET) || fread (in, 1, inlen, f) != inlen)
+		{       // COM_LoadFile will try again and report it
+			if (f)
+				fclose (f);
+			if (in && in != pre->data)
+				free (in);
+			free (pre->data);
+			pre->data = NULL;
+			return;
+		}
+		fclose (f);
+	}
+
+	if (file && file->method == ZIP_DEFLATED)
+	{
+		if (Inflate (pre->data, pre->len, in, inlen) != pre->len
+		|| CRC_Zip (pre->data, pre->len) != file->crc)
+		{       // COM_LoadFile will try again and report it
+			free (pre->data);
+			pre->data = NULL;
+		}
+		if (!pak->base)
+			free (in);
+	}
+}
+
+/*
+============
+COM_PrefetchFiles
+
+Reads the named files on the worker threads.  Whatever isn't loaded is
+kept until COM_FreePrefetched.
+============
+*/
+void COM_PrefetchFiles (char **names, int count)
+{
+	searchpath_t    *search;
+	packindex_t     *indexed;
+	prefetch_t      *pre;
+	char            netpath[MAX_OSPATH];
+	int             i, threads, bytes, handle;
+	double          start;
+
+	COM_FreePrefetched ();
+	if (!count)
+		return;
+
+	com_prefetch = malloc (count * sizeof(prefetch_t));
+	if (!com_prefetch)
+		return;
+
+	bytes = 0;
+	for (i=0 ; i<count ; i++)
+	{
+		if (strlen (names[i]) >= MAX_QPATH)
+			continue;
+		if (proghack && !strcmp (names[i], "progs.dat"))
+			continue;
+
+	// the same search as COM_FindFile
+		pre = &com_prefetch[com_numprefetch];
+		indexed = COM_IndexedFile (names[i]);
+		for (search = com_searchpaths ; search ; search = search->next)
+		{
+			if (search->pack)
+			{
+				if (indexed && indexed->search == search)
+					break;
+				continue;
+			}
+			if (!static_registered && (strchr (names[i], '/') || strchr (names[i], '\\')))
+				continue;
+			if (snprintf (netpath, sizeof(netpath), "%s/%s", search->filename, names[i]) >= (int)sizeof(netpath))
+				continue;
+			if (Sys_FileTime (netpath) != -1)
+				break;
+		}
+		if (!search)
+			continue;
+
+		if (search->pack)
+		{
+			pre->file = indexed->file;
+			if (pre->file->local && !COM_ResolveZipFile (search->pack, pre->file))
+				continue;
+			pre->len = pre->file->filelen;
+		}
+		else
+		{
+			if (com_cachedir[0])
+				continue;       // COM_FindFile may copy it first
+			pre->file = NULL;
+			strcpy (pre->path, netpath);
+			pre->len = Sys_FileOpenRead (netpath, &handle);
+			if (pre->len < 0)
+				continue;
+			Sys_FileClose (handle);
+		}
+		strcpy (pre->name, names[i]);
+		pre->search = search;
+		pre->data = NULL;
+		bytes += pre->len;
+		com_numprefetch++;
+	}
+	if (!com_numprefetch)
+		return;
+
+	threads = COM_PrefetchThreads ();
+	start = Sys_FloatTime ();
+	Sys_RunJobs (COM_PrefetchJob, com_prefetch, com_numprefetch, threads);
+	Con_DPrintf ("Prefetched %i files, %i bytes on %i threads in %.3f seconds\n",
+		com_numprefetch, bytes, threads, Sys_FloatTime () - start);
+}
+
+/*
+============
+COM_TakePrefetched
+
+Copies a file COM_FindFile just found into buf if it was prefetched from
+the same place
+============
+*/
+static qboolean COM_TakePrefetched (char *path, byte *buf, int len)
+{
+	prefetch_t      *pre;
+	int             i;
+
+	for (i=0, pre=com_prefetch ; i<com_numprefetch ; i++, pre++)
+	{
+		if (!pre->data || pre->search != com_foundsearch || pre->len != len
+		|| strcmp (pre->name, path))
+			continue;
+		memcpy (buf, pre->data, len);
+		free (pre->data);
+		pre->data = NULL;
+		return true;
+	}
+	return false;
+}
+
+/*
+============
+COM_FreePrefetched
+
+Drops whatever COM_PrefetchFiles read that wasn't loaded
+============
+*/
+void COM_FreePrefetched (void)
+{
+	int             i;
+
+	for (i=0 ; i<com_numprefetch ; i++)
+		free (com_prefetch[i].data);
+	free (com_prefetch);
+	com_prefetch = NULL;
+	com_numprefetch = 0;
+}
+
+/*
+============
+COM_PrefetchBench_f
+
+prefetchbench <file> [file ...]
+
+Loads the files one after another as the loaders do, and again after
+prefetching them, and prints the best of three runs of each.  The reads
+come from the page cache after the first run, so it shows what the
+threads save or cost in reading, inflating and copying, not disk time.
+============
+*/
+#define	MAX_PREFETCHBENCH	64
+
+void COM_PrefetchBench_f (void)
+{
+	char	*names[MAX_PREFETCHBENCH];
+	int		i, run, count, mark, bytes;
+	double	start, time, serial, prefetched;
+
+	count = Cmd_Argc () - 1;
+	if (count < 1)
+	{
+		Con_Printf ("prefetchbench <file> [file ...] : time loading files with and without prefetching\n");
+		return;
+	}
+	if (count > MAX_PREFETCHBENCH)
+		count = MAX_PREFETCHBENCH;
+	for (i=0 ; i<count ; i++)
+		names[i] = Cmd_Argv (i+1);
+
+	serial = prefetched = 1000000;
+	bytes = 0;
+	mark = Hunk_LowMark ();
+	for (run=0 ; run<3 ; run++)
+	{
+		start = Sys_FloatTime ();
+		bytes = 0;
+		for (i=0 ; i<count ; i++)
+		{
+			if (COM_LoadHunkFile (names[i]))
+				bytes += com_filesize;
+			Hunk_FreeToLowMark (mark);
+		}
+		time = Sys_FloatTime () - start;
+		if (time < serial)
+			serial = time;
+
+		start = Sys_FloatTime ();
+		COM_PrefetchFiles (names, count);
+		for (i=0 ; i<count ; i++)
+		{
+			COM_LoadHunkFile (names[i]);
+			Hunk_FreeToLowMark (mark);
+		}
+		COM_FreePrefetched ();
+		time = Sys_FloatTime () - start;
+		if (time < prefetched)
+			prefetched = time;
+	}
+
+	Con_Printf ("%i files, %i bytes\n", count, bytes);
+	Con_Printf ("in turn:    %8.3f ms\n", serial * 1000);
+	Con_Printf ("prefetched: %8.3f ms on %i threads\n", prefetched * 1000, COM_PrefetchThreads ());
+}
+
 /*
 ============
 COM_Path_f
@@ -1270,6 +1981,7 @@ void COM_Path_f (void)
 		else
 			Con_Printf ("%s\n", s->filename);
 	}
+	Con_Printf ("%i pak files indexed\n", com_packindexfiles);
 }
 
 /*
@@ -1361,6 +2073,7 @@ COM_FindFile
 
 Finds the file in the search path.
 Sets com_filesize and one of handle or file
+A handle to a deflated file in a zip is left at the deflated data
 ===========
 */
 int COM_FindFile (char *filename, int *handle, FILE **file)
@@ -1369,9 +2082,15 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 	char            netpath[MAX_OSPATH];
 	char            cachepath[MAX_OSPATH];
 	pack_t          *pak;
+	packfile_t      *pakfile;
+	packindex_t     *indexed;
+	qboolean        scan;
 	int                     i;
 	int                     findtime, cachetime;
 
+	com_filemap = NULL;
+	com_foundsearch = NULL;
+	com_foundfile = NULL;
 	if (file && handle)
 		Sys_Error ("COM_FindFile: both handle and file set");
 	if (!file && !handle)
@@ -1381,10 +2100,15 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 // search through the path, one element at a time
 //
 	search = com_searchpaths;
+	indexed = COM_IndexedFile (filename);
+	scan = !com_packindex;
 	if (proghack)
 	{	// gross hack to use quake 1 progs with quake 2 maps
 		if (!strcmp(filename, "progs.dat"))
+		{
 			search = search->next;
+			scan = true;            // the index doesn't know about the skip
+		}
 	}
 
 	for ( ; search ; search = search->next)
@@ -1392,26 +2116,53 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 	// is the element a pak file?
 		if (search->pack)
 		{
-		// look through all the pak file elements
+		// the index says which pak has it first
 			pak = search->pack;
-			for (i=0 ; i<pak->numfiles ; i++)
-				if (!strcmp (pak->files[i].name, filename))
-				{       // found it!
-					Sys_Printf ("PackFile: %s : %s\n",pak->filename, filename);
-					if (handle)
+			pakfile = NULL;
+			if (!scan)
+			{
+				if (indexed && indexed->search == search)
+					pakfile = indexed->file;
+			}
+			else
+			{       // look through all the pak file elements
+				for (i=0 ; i<pak->numfiles ; i++)
+					if (!strcmp (pak->files[i].name, filename))
 					{
-						*handle = pak->handle;
-						Sys_FileSeek (pak->handle, pak->files[i].filepos);
-					}
-					else
-					{       // open a new file on the pakfile
-						*file = fopen (pak->filename, "rb");
-						if (*file)
-							fseek (*file, pak->files[i].filepos, SEEK_SET);
+						pakfile = &pak->files[i];
+						break;
 					}
-					com_filesize = pak->files[i].filelen;
-					return com_filesize;
+			}
+			if (pakfile)
+			{       // found it!
+				if (com_findlog.value)
+					Sys_Printf ("PackFile: %s : %s\n",pak->filename, filename);
+				if (pakfile->local && !COM_ResolveZipFile (pak, pakfile))
+					return COM_FindFile (filename, handle, file);   // look again without it
+				if (handle)
+				{
+					*handle = pak->handle;
+					Sys_FileSeek (pak->handle, pakfile->filepos);
+				}
+				else if (pakfile->method == ZIP_DEFLATED)
+				{
+					*file = COM_InflateTempFile (pak, pakfile);
+					if (!pakfile->name[0])
+						return COM_FindFile (filename, handle, file);   // corrupt, look again without it
 				}
+				else
+				{       // open a new file on the pakfile
+					*file = fopen (pak->filename, "rb");
+					if (*file)
+						fseek (*file, pakfile->filepos, SEEK_SET);
+				}
+				if (pak->base && pakfile->method == ZIP_STORED)
+					com_filemap = pak->base + pakfile->filepos;
+				com_foundsearch = search;
+				com_foundfile = pakfile;
+				com_filesize = pakfile->filelen;
+				return com_filesize;
+			}
 		}
 		else
 		{               
@@ -1449,7 +2200,9 @@ int COM_FindFile (char *filename, int *handle, FILE **file)
 				strcpy (netpath, cachepath);
 			}	
 
-			Sys_Printf ("FindFile: %s\n",netpath);
+			if (com_findlog.value)
+				Sys_Printf ("FindFile: %s\n",netpath);
+			com_foundsearch = search;
 			com_filesize = Sys_FileOpenRead (netpath, &i);
 			if (handle)
 				*handle = i;
@@ -1480,12 +2233,23 @@ COM_OpenFile
 
 filename never has a leading slash, but may contain directory walks
 returns a handle and a length
-it may actually be inside a pak file
+it may actually be inside a pak file, but not deflated in a zip, since the
+handle would read the deflated bytes
 ===========
 */
 int COM_OpenFile (char *filename, int *handle)
 {
-	return COM_FindFile (filename, handle, NULL);
+	int             len;
+
+	len = COM_FindFile (filename, handle, NULL);
+	if (*handle != -1 && com_foundfile && com_foundfile->method == ZIP_DEFLATED)
+	{
+		Con_Printf ("%s is deflated in %s, it can't be opened as a handle\n",
+			filename, com_foundsearch->pack->filename);
+		*handle = -1;
+		return -1;
+	}
+	return len;
 }
 
 /*
@@ -1526,6 +2290,8 @@ COM_LoadFile
 
 Filename are reletive to the quake directory.
 Allways appends a 0 byte.
+Deflated files in zips are inflated into the buffer.  If one turns out
+to be corrupt, the file is looked for again without it.
 ============
 */
 cache_user_t *loadcache;
@@ -1535,19 +2301,36 @@ byte *COM_LoadFile (char *path, int usehunk)
 {
 	int             h;
 	byte    *buf;
+	byte    *map;
+	pack_t  *pak;
+	packfile_t      *pakfile;
 	char    base[32];
-	int             len;
+	int             len, mark;
 
 	buf = NULL;     // quiet compiler warning
 
-// look for it in the filesystem or pack files
-	len = COM_OpenFile (path, &h);
+// look for it in the filesystem or pack files, deflated files included
+	len = COM_FindFile (path, &h, NULL);
 	if (h == -1)
 		return NULL;
+	map = com_filemap;
+	pak = com_foundsearch ? com_foundsearch->pack : NULL;
+	pakfile = com_foundfile;
+
+	if (usehunk == 5)
+	{       // read only, so the mapping will do if there is one
+		if (map)
+		{
+			COM_CloseFile (h);
+			return map;
+		}
+		usehunk = 4;
+	}
 	
 // extract the filename base name for hunk tag
 	COM_FileBase (path, base);
 	
+	mark = Hunk_LowMark ();
 	if (usehunk == 1)
 		buf = Hunk_AllocName (len+1, base);
 	else if (usehunk == 2)
@@ -1571,6 +2354,33 @@ byte *COM_LoadFile (char *path, int usehunk)
 		
 	((byte *)buf)[len] = 0;
 
+	if (map)
+	{       // already in memory, no disc icon
+		memcpy (buf, map, len);
+		COM_CloseFile (h);
+		return buf;
+	}
+
+	if (COM_TakePrefetched (path, buf, len))
+	{       // read ahead of time
+		COM_CloseFile (h);
+		return buf;
+	}
+
+	if (pakfile && pakfile->method == ZIP_DEFLATED)
+	{
+		COM_CloseFile (h);
+		if (COM_InflateFile (pak, pakfile, buf))
+			return buf;
+		if (usehunk == 1)
+			Hunk_FreeToLowMark (mark);
+		else if (usehunk == 0)
+			Z_Free (buf);
+		else if (usehunk == 3)
+			Cache_Free (loadcache);
+		return COM_LoadFile (path, usehunk);    // the next copy, or missing
+	}
+
 	Draw_BeginDisc ();
 	Sys_FileRead (h, buf, len);                     
 	COM_CloseFile (h);
@@ -1607,6 +2417,22 @@ byte *COM_LoadStackFile (char *path, void *buffer, int bufsize)
 	return buf;
 }
 
+/*
+============
+COM_LoadMappedFile
+
+For callers that only read the file.  Returns it where it lies in its
+pak's mapping if the pak is mapped, with no 0 byte appended, otherwise
+loads it as COM_LoadStackFile does.
+============
+*/
+byte *COM_LoadMappedFile (char *path, void *buffer, int bufsize)
+{
+	loadbuf = (byte *)buffer;
+	loadsize = bufsize;
+	return COM_LoadFile (path, 5);
+}
+
 /*
 =================
 COM_LoadPackFile
@@ -1624,11 +2450,13 @@ pack_t *COM_LoadPackFile (char *packfile)
 	packfile_t              *newfiles;
 	int                             numpackfiles;
 	pack_t                  *pack;
-	int                             packhandle;
+	int                             packhandle, packlen;
 	dpackfile_t             info[MAX_FILES_IN_PACK];
 	unsigned short          crc;
+	qboolean                mappable;
 
-	if (Sys_FileOpenRead (packfile, &packhandle) == -1)
+	packlen = Sys_FileOpenRead (packfile, &packhandle);
+	if (packlen == -1)
 	{
 //              Con_Printf ("Couldn't open %s\n", packfile);
 		return NULL;
@@ -1661,11 +2489,16 @@ pack_t *COM_LoadPackFile (char *packfile)
 		com_modified = true;
 
 // parse the directory
+	mappable = !COM_CheckParm ("-nomappaks");
 	for (i=0 ; i<numpackfiles ; i++)
 	{
 		strcpy (newfiles[i].name, info[i].name);
 		newfiles[i].filepos = LittleLong(info[i].filepos);
 		newfiles[i].filelen = LittleLong(info[i].filelen);
+		newfiles[i].complen = newfiles[i].filelen;
+		if (newfiles[i].filepos < 0 || newfiles[i].filelen < 0
+		|| newfiles[i].filepos > packlen - newfiles[i].filelen)
+			mappable = false;       // reads of it come up short, as they always did
 	}
 
 	pack = Hunk_Alloc (sizeof (pack_t));
@@ -1673,8 +2506,11 @@ pack_t *COM_LoadPackFile (char *packfile)
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	pack->length = packlen;
+	if (mappable)
+		pack->base = Sys_FileMap (packhandle, packlen);
 	
-	Con_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
+	Con_Printf ("Added packfile %s (%i files%s)\n", packfile, numpackfiles, pack->base ? ", mapped" : "");
 	return pack;
 }
 
@@ -1684,7 +2520,7 @@ pack_t *COM_LoadPackFile (char *packfile)
 COM_AddGameDirectory
 
 Sets com_gamedir, adds the directory to the head of the path,
-then loads and adds pak1.pak pak2.pak ... 
+then loads and adds pak1.pak pak2.pak ... and then pak0.pk3 pak1.pk3 ...
 ================
 */
 void COM_AddGameDirectory (char *dir)
@@ -1719,6 +2555,25 @@ void COM_AddGameDirectory (char *dir)
 		com_searchpaths = search;               
 	}
 
+//
+// and any zip files named the same way, pak0.pk3 pak1.pk3 ...
+//
+	for (i=0 ; ; i++)
+	{
+		sprintf (pakfile, "%s/pak%i.pk3", dir, i);
+		if (Sys_FileTime (pakfile) == -1)
+			break;
+		pak = COM_LoadZipFile (pakfile);
+		if (!pak)
+			continue;       // damaged, the later ones may be fine
+		search = Hunk_Alloc (sizeof(searchpath_t));
+		search->pack = pak;
+		search->next = com_searchpaths;
+		com_searchpaths = search;
+	}
+
+	COM_IndexPacks ();
+
 //
 // add the contents of the parms.txt file to the end of the command line
 //
@@ -1814,11 +2669,19 @@ void COM_InitFilesystem (void)
 				if (!search->pack)
 					Sys_Error ("Couldn't load packfile: %s", com_argv[i]);
 			}
+			else if ( !strcmp(COM_FileExtension(com_argv[i]), "pk3")
+			|| !strcmp(COM_FileExtension(com_argv[i]), "zip") )
+			{
+				search->pack = COM_LoadZipFile (com_argv[i]);
+				if (!search->pack)
+					Sys_Error ("Couldn't load zipfile: %s", com_argv[i]);
+			}
 			else
 				strcpy (search->filename, com_argv[i]);
 			search->next = com_searchpaths;
 			com_searchpaths = search;
 		}
+		COM_IndexPacks ();
 	}
 
 	if (COM_CheckParm ("-proghack"))
@@ -39,6 +39,7 @@ model_t	mod_known[MAX_MOD_KNOWN];
 int		mod_numknown;
 
 cvar_t gl_subdivide_size = {"gl_subdivide_size", "128", true};
+cvar_t mod_vismemory = {"mod_vismemory", "1024"};	// kb for decompressed world vis, 0 = off
 
 /*
 ===============
@@ -48,6 +49,7 @@ Mod_Init
 void Mod_Init (void)
 {
 	Cvar_RegisterVariable (&gl_subdivide_size);
+	Cvar_RegisterVariable (&mod_vismemory);
 	memset (mod_novis, 0xff, sizeof(mod_novis));
 }
 
@@ -155,11 +157,62 @@ byte *Mod_DecompressVis (byte *in, model_t *model)
 
 byte *Mod_LeafPVS (mleaf_t *leaf, model_t *model)
 {
+	int		leafnum;
+
 	if (leaf == model->leafs)
 		return mod_novis;
+	leafnum = leaf - model->leafs - 1;
+	if (model->visrows && leafnum < model->numleafs)
+		return model->visrows + leafnum*((model->numleafs+7)>>3);
 	return Mod_DecompressVis (leaf->compressed_vis, model);
 }
 
+/*
+===================
+Mod_OrLeafPVS
+
+ORs the leaf's visibility row into out.  Unlike Mod_LeafPVS it does not go
+through the shared decompression buffer, so it is safe from worker threads.
+===================
+*/
+void Mod_OrLeafPVS (mleaf_t *leaf, model_t *model, byte *out)
+{
+	byte	*in, *end;
+	int		c, leafnum;
+
+	end = out + ((model->numleafs+7)>>3);
+	in = leaf->compressed_vis;
+
+	leafnum = leaf - model->leafs - 1;
+	if (model->visrows && leafnum >= 0 && leafnum < model->numleafs)
+	{
+		in = model->visrows + leafnum*(end - out);
+		while (out < end)
+			*out++ |= *in++;
+		return;
+	}
+
+	if (leaf == model->leafs || !in)
+	{	// no vis info, so make all visible
+		while (out < end)
+			*out++ = 0xff;
+		return;
+	}
+
+	while (out < end)
+	{
+		if (*in)
+		{
+			*out++ |= *in++;
+			continue;
+		}
+	
+		c = in[1];
+		in += 2;
+		out += c;
+	}
+}
+
 /*
 ===================
 Mod_ClearAll
@@ -208,6 +261,38 @@ model_t *Mod_FindName (char *name)
 	return mod;
 }
 
+/*
+==================
+Mod_WillLoad
+
+True if Mod_LoadModel would read the model's file, after the Mod_ClearAll
+a new map starts with if clearing is set.  Only alias models are kept
+between maps.
+==================
+*/
+qboolean Mod_WillLoad (char *name, qboolean clearing)
+{
+	int		i;
+	model_t	*mod;
+
+	for (i=0 , mod=mod_known ; i<mod_numknown ; i++, mod++)
+	{
+		if (strcmp (mod->name, name))
+			continue;
+		if (mod->needload)
+			return true;
+		if (mod->type != mod_alias)
+			return clearing;
+#ifndef SERVERONLY
+		return !Cache_Check (&mod->cache);
+#else
+		return false;
+#endif
+	}
+
+	return true;
+}
+
 /*
 ==================
 Mod_TouchModel
@@ -236,12 +321,15 @@ Loads a model into the cache
 */
 model_t *Mod_LoadModel (model_t *mod, qboolean crash)
 {
+#ifndef SERVERONLY
 	void	*d;
+#endif
 	unsigned *buf;
 	byte	stackbuf[1024];		// avoid dirtying the cache heap
 
 	if (!mod->needload)
 	{
+#ifndef SERVERONLY
 		if (mod->type == mod_alias)
 		{
 			d = Cache_Check (&mod->cache);
@@ -249,6 +337,7 @@ model_t *Mod_LoadModel (model_t *mod, qboolean crash)
 				return mod;
 		}
 		else
+#endif
 			return mod;		// not cached at all
 	}
 
@@ -263,7 +352,12 @@ model_t *Mod_LoadModel (model_t *mod, qboolean crash)
 //
 // load the file
 //
-	buf = (unsigned *)COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf));
+	buf = (unsigned *)COM_LoadMappedFile (mod->name, stackbuf, sizeof(stackbuf));
+	if (buf && (byte *)buf == com_filemap
+	&& (LittleLong(*buf) == IDPOLYHEADER || LittleLong(*buf) == IDSPRITEHEADER))
+	{	// these are changed in place as they load, brush models aren't
+		buf = (unsigned *)COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf));
+	}
 	if (!buf)
 	{
 		if (crash)
@@ -331,6 +425,7 @@ model_t *Mod_ForName (char *name, qboolean crash)
 byte	*mod_base;
 
 
+#ifndef SERVERONLY
 /*
 =================
 Mod_LoadTextures
@@ -339,6 +434,7 @@ Mod_LoadTextures
 void Mod_LoadTextures (lump_t *l)
 {
 	int		i, j, pixels, num, max, altmax;
+	int		nummiptex, dataofs, width, height;
 	miptex_t	*mt;
 	texture_t	*tx, *tx2;
 	texture_t	*anims[10];
@@ -352,33 +448,31 @@ void Mod_LoadTextures (lump_t *l)
 	}
 	m = (dmiptexlump_t *)(mod_base + l->fileofs);
 	
-	m->nummiptex = LittleLong (m->nummiptex);
+	nummiptex = LittleLong (m->nummiptex);	// the file may be read only
 	
-	loadmodel->numtextures = m->nummiptex;
-	loadmodel->textures = Hunk_AllocName (m->nummiptex * sizeof(*loadmodel->textures) , loadname);
+	loadmodel->numtextures = nummiptex;
+	loadmodel->textures = Hunk_AllocName (nummiptex * sizeof(*loadmodel->textures) , loadname);
 
-	for (i=0 ; i<m->nummiptex ; i++)
+	for (i=0 ; i<nummiptex ; i++)
 	{
-		m->dataofs[i] = LittleLong(m->dataofs[i]);
-		if (m->dataofs[i] == -1)
+		dataofs = LittleLong(m->dataofs[i]);
+		if (dataofs == -1)
 			continue;
-		mt = (miptex_t *)((byte *)m + m->dataofs[i]);
-		mt->width = LittleLong (mt->width);
-		mt->height = LittleLong (mt->height);
-		for (j=0 ; j<MIPLEVELS ; j++)
-			mt->offsets[j] = LittleLong (mt->offsets[j]);
+		mt = (miptex_t *)((byte *)m + dataofs);
+		width = LittleLong (mt->width);
+		height = LittleLong (mt->height);
 		
-		if ( (mt->width & 15) || (mt->height & 15) )
+		if ( (width & 15) || (height & 15) )
 			Sys_Error ("Texture %s is not 16 aligned", mt->name);
-		pixels = mt->width*mt->height/64*85;
+		pixels = width*height/64*85;
 		tx = Hunk_AllocName (sizeof(texture_t) +pixels, loadname );
 		loadmodel->textures[i] = tx;
 
 		memcpy (tx->name, mt->name, sizeof(tx->name));
-		tx->width = mt->width;
-		tx->height = mt->height;
+		tx->width = width;
+		tx->height = height;
 		for (j=0 ; j<MIPLEVELS ; j++)
-			tx->offsets[j] = mt->offsets[j] + sizeof(texture_t) - sizeof(miptex_t);
+			tx->offsets[j] = LittleLong (mt->offsets[j]) + sizeof(texture_t) - sizeof(miptex_t);
 		// the pixels immediately follow the structures
 		memcpy ( tx+1, mt+1, pixels);
 		
@@ -396,7 +490,7 @@ void Mod_LoadTextures (lump_t *l)
 //
 // sequence the animations
 //
-	for (i=0 ; i<m->nummiptex ; i++)
+	for (i=0 ; i<nummiptex ; i++)
 	{
 		tx = loadmodel->textures[i];
 		if (!tx || tx->name[0] != '+')
@@ -487,6 +581,8 @@ void Mod_LoadTextures (lump_t *l)
 	}
 }
 
+#endif
+
 /*
 =================
 Mod_LoadLighting
@@ -629,6 +725,7 @@ void Mod_LoadEdges (lump_t *l)
 	}
 }
 
+#ifndef SERVERONLY
 /*
 =================
 Mod_LoadTexinfo
@@ -823,6 +920,7 @@ void Mod_LoadFaces (lump_t *l)
 	}
 }
 
+#endif
 
 /*
 =================
@@ -916,9 +1014,11 @@ void Mod_LoadLeafs (lump_t *l)
 		p = LittleLong(in->contents);
 		out->contents = p;
 
+#ifndef SERVERONLY
 		out->firstmarksurface = loadmodel->marksurfaces +
 			LittleShort(in->firstmarksurface);
 		out->nummarksurfaces = LittleShort(in->nummarksurfaces);
+#endif
 		
 		p = LittleLong(in->visofs);
 		if (p == -1)
@@ -930,12 +1030,14 @@ void Mod_LoadLeafs (lump_t *l)
 		for (j=0 ; j<4 ; j++)
 			out->ambient_sound_level[j] = in->ambient_level[j];
 
+#ifndef SERVERONLY
 		// gl underwater warp
 		if (out->contents != CONTENTS_EMPTY)
 		{
 			for (j=0 ; j<out->nummarksurfaces ; j++)
 				out->firstmarksurface[j]->flags |= SURF_UNDERWATER;
 		}
+#endif
 	}	
 }
 
@@ -989,6 +1091,37 @@ void Mod_LoadClipnodes (lump_t *l)
 		out->children[0] = LittleShort(in->children[0]);
 		out->children[1] = LittleShort(in->children[1]);
 	}
+
+	loadmodel->hulls[1].packednodes = loadmodel->hulls[2].packednodes =
+		Mod_PackClipnodes (loadmodel->clipnodes, loadmodel->planes, count);
+}
+
+/*
+=================
+Mod_PackClipnodes
+
+Builds the mclipnode_t copies of count clipnodes for the hull traces
+=================
+*/
+mclipnode_t *Mod_PackClipnodes (dclipnode_t *in, mplane_t *planes, int count)
+{
+	mclipnode_t	*out, *packed;
+	mplane_t	*plane;
+	int			i;
+
+	packed = out = Hunk_AllocName ( count*sizeof(*out), loadname);
+
+	for (i=0 ; i<count ; i++, out++, in++)
+	{
+		plane = planes + in->planenum;
+		VectorCopy (plane->normal, out->normal);
+		out->dist = plane->dist;
+		out->type = plane->type;
+		out->children[0] = in->children[0];
+		out->children[1] = in->children[1];
+	}
+
+	return packed;
 }
 
 /*
@@ -1028,6 +1161,8 @@ void Mod_MakeHull0 (void)
 				out->children[j] = child - loadmodel->nodes;
 		}
 	}
+
+	hull->packednodes = Mod_PackClipnodes (hull->clipnodes, loadmodel->planes, count);
 }
 
 /*
@@ -1139,6 +1274,35 @@ float RadiusFromBounds (vec3_t mins, vec3_t maxs)
 	return Length (corner);
 }
 
+/*
+=================
+Mod_DecompressAllVis
+
+Expands the vis rows of every leaf up front, so that Mod_LeafPVS is a
+lookup.  Skipped if the table would be larger than mod_vismemory.
+=================
+*/
+void Mod_DecompressAllVis (model_t *mod)
+{
+	int		i, row, size;
+
+	mod->visrows = NULL;
+	if (!mod->visdata || mod->numleafs <= 0)
+		return;
+
+	row = (mod->numleafs+7)>>3;
+	size = row * mod->numleafs;
+	if (size > mod_vismemory.value * 1024)
+	{
+		Con_DPrintf ("%s: %ik of vis not decompressed\n", mod->name, size/1024);
+		return;
+	}
+
+	mod->visrows = Hunk_AllocName (size, loadname);
+	for (i=0 ; i<mod->numleafs ; i++)
+		memcpy (mod->visrows + i*row, Mod_DecompressVis (mod->leafs[i+1].compressed_vis, mod), row);
+}
+
 /*
 =================
 Mod_LoadBrushModel
@@ -1147,7 +1311,7 @@ Mod_LoadBrushModel
 void Mod_LoadBrushModel (model_t *mod, void *buffer)
 {
 	int			i, j;
-	dheader_t	*header;
+	dheader_t	*header, swapped;
 	dmodel_t 	*bm;
 	
 	loadmodel->type = mod_brush;
@@ -1158,23 +1322,30 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 	if (i != BSPVERSION)
 		Sys_Error ("Mod_LoadBrushModel: %s has wrong version number (%i should be %i)", mod->name, i, BSPVERSION);
 
-// swap all the lumps
+// swap all the lumps, into a copy as the file may be a read only mapping
 	mod_base = (byte *)header;
 
 	for (i=0 ; i<sizeof(dheader_t)/4 ; i++)
-		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
+		((int *)&swapped)[i] = LittleLong ( ((int *)header)[i]);
+	header = &swapped;
 
 // load into heap
+// the dedicated server only keeps what collision and visibility need:
+// planes, nodes, leafs, clipnodes, vis, entities and submodels
 	
+#ifndef SERVERONLY
 	Mod_LoadVertexes (&header->lumps[LUMP_VERTEXES]);
 	Mod_LoadEdges (&header->lumps[LUMP_EDGES]);
 	Mod_LoadSurfedges (&header->lumps[LUMP_SURFEDGES]);
 	Mod_LoadTextures (&header->lumps[LUMP_TEXTURES]);
 	Mod_LoadLighting (&header->lumps[LUMP_LIGHTING]);
+#endif
 	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
+#ifndef SERVERONLY
 	Mod_LoadTexinfo (&header->lumps[LUMP_TEXINFO]);
 	Mod_LoadFaces (&header->lumps[LUMP_FACES]);
 	Mod_LoadMarksurfaces (&header->lumps[LUMP_MARKSURFACES]);
+#endif
 	Mod_LoadVisibility (&header->lumps[LUMP_VISIBILITY]);
 	Mod_LoadLeafs (&header->lumps[LUMP_LEAFS]);
 	Mod_LoadNodes (&header->lumps[LUMP_NODES]);
@@ -1210,6 +1381,9 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 
 		mod->numleafs = bm->visleafs;
 
+		if (i == 0)
+			Mod_DecompressAllVis (mod);
+
 		if (i < mod->numsubmodels-1)
 		{	// duplicate the basic information
 			char	name[10];
@@ -1217,12 +1391,90 @@ void Mod_LoadBrushModel (model_t *mod, void *buffer)
 			sprintf (name, "*%i", i+1);
 			loadmodel = Mod_FindName (name);
 			*loadmodel = *mod;
+			loadmodel->visrows = NULL;
 			strcpy (loadmodel->name, name);
 			mod = loadmodel;
 		}
 	}
 }
 
+#ifdef SERVERONLY
+
+/*
+==============================================================================
+
+SERVER MODEL STUBS
+
+The dedicated server never draws, so alias and sprite models only carry the
+bounds, frame count and flags that progs and physics look at.
+
+==============================================================================
+*/
+
+/*
+=================
+Mod_LoadAliasModel
+=================
+*/
+void Mod_LoadAliasModel (model_t *mod, void *buffer)
+{
+	mdl_t	*pinmodel;
+	int		version;
+
+	pinmodel = (mdl_t *)buffer;
+
+	version = LittleLong (pinmodel->version);
+	if (version != ALIAS_VERSION)
+		Sys_Error ("%s has wrong version number (%i should be %i)",
+				 mod->name, version, ALIAS_VERSION);
+
+	mod->flags = LittleLong (pinmodel->flags);
+	mod->synctype = LittleLong (pinmodel->synctype);
+	mod->numframes = LittleLong (pinmodel->numframes);
+	if (mod->numframes < 1)
+		Sys_Error ("Mod_LoadAliasModel: Invalid # of frames: %d\n", mod->numframes);
+
+	mod->type = mod_alias;
+
+// FIXME: do this right
+	mod->mins[0] = mod->mins[1] = mod->mins[2] = -16;
+	mod->maxs[0] = mod->maxs[1] = mod->maxs[2] = 16;
+}
+
+/*
+=================
+Mod_LoadSpriteModel
+=================
+*/
+void Mod_LoadSpriteModel (model_t *mod, void *buffer)
+{
+	dsprite_t	*pin;
+	int			version, width, height;
+
+	pin = (dsprite_t *)buffer;
+
+	version = LittleLong (pin->version);
+	if (version != SPRITE_VERSION)
+		Sys_Error ("%s has wrong version number "
+				 "(%i should be %i)", mod->name, version, SPRITE_VERSION);
+
+	mod->synctype = LittleLong (pin->synctype);
+	mod->numframes = LittleLong (pin->numframes);
+	if (mod->numframes < 1)
+		Sys_Error ("Mod_LoadSpriteModel: Invalid # of frames: %d\n", mod->numframes);
+
+	width = LittleLong (pin->width);
+	height = LittleLong (pin->height);
+	mod->mins[0] = mod->mins[1] = -width/2;
+	mod->maxs[0] = mod->maxs[1] = width/2;
+	mod->mins[2] = -height/2;
+	mod->maxs[2] = height/2;
+
+	mod->type = mod_sprite;
+}
+
+#else	// !SERVERONLY
+
 /*
 ==============================================================================
 
@@ -1818,6 +2070,8 @@ void Mod_LoadSpriteModel (model_t *mod, void *buffer)
 	mod->type = mod_sprite;
 }
 
+#endif	// SERVERONLY
+
 //=============================================================================
 
 /*
@@ -20,7 +20,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 // host.c -- coordinates spawning and killing of local servers
 
 #include "quakedef.h"
-#ifndef GLQUAKE
+#if !defined(GLQUAKE) && !defined(SERVERONLY)
 #include "r_local.h"
 #endif
 
@@ -191,10 +191,10 @@ void	Host_FindMaxClients (void)
 	svs.maxclients = 1;
 		
 	i = COM_CheckParm ("-dedicated");
-	if (i)
+	if (i || isDedicated)
 	{
 		cls.state = ca_dedicated;
-		if (i != (com_argc - 1))
+		if (i && i != (com_argc - 1))
 		{
 			svs.maxclients = Q_atoi (com_argv[i+1]);
 		}
@@ -276,6 +276,7 @@ Writes key bindings and archived cvars to config.cfg
 */
 void Host_WriteConfiguration (void)
 {
+#ifndef SERVERONLY
 	FILE	*f;
 
 // dedicated servers initialize the host but don't parse and set the
@@ -294,6 +295,7 @@ void Host_WriteConfiguration (void)
 
 		fclose (f);
 	}
+#endif
 }
 
 
@@ -508,7 +510,9 @@ not reinitialize anything.
 void Host_ClearMemory (void)
 {
 	Con_DPrintf ("Clearing memory\n");
+#ifndef SERVERONLY
 	D_FlushCaches ();
+#endif
 	Mod_ClearAll ();
 	if (host_hunklevel)
 		Hunk_FreeToLowMark (host_hunklevel);
@@ -595,7 +599,9 @@ void _Host_ServerFrame (void)
 	pr_global_struct->frametime = host_frametime;
 
 // read client messages
+	SV_StatsEnter (SVP_RUNCLIENTS);
 	SV_RunClients ();
+	SV_StatsLeave ();
 	
 // move things around and think
 // always pause in single player if in console or menus
@@ -608,6 +614,8 @@ void Host_ServerFrame (void)
 	float	save_host_frametime;
 	float	temp_host_frametime;
 
+	SV_StatsBeginTick ();
+
 // run the world state	
 	pr_global_struct->frametime = host_frametime;
 
@@ -615,7 +623,9 @@ void Host_ServerFrame (void)
 	SV_ClearDatagram ();
 	
 // check for new clients
+	SV_StatsEnter (SVP_NEWCLIENTS);
 	SV_CheckForNewClients ();
+	SV_StatsLeave ();
 
 	temp_host_frametime = save_host_frametime = host_frametime;
 	while(temp_host_frametime > (1.0/72.0))
@@ -629,14 +639,23 @@ void Host_ServerFrame (void)
 	}
 	host_frametime = save_host_frametime;
 
+// reclaim the temporary strings nothing refers to
+	PR_FreeTempStrings ();
+
 // send all messages to the clients
+	SV_StatsEnter (SVP_SEND);
 	SV_SendClientMessages ();
+	SV_StatsLeave ();
+
+	SV_StatsEndTick ();
 }
 
 #else
 
 void Host_ServerFrame (void)
 {
+	SV_StatsBeginTick ();
+
 // run the world state	
 	pr_global_struct->frametime = host_frametime;
 
@@ -644,18 +663,29 @@ void Host_ServerFrame (void)
 	SV_ClearDatagram ();
 	
 // check for new clients
+	SV_StatsEnter (SVP_NEWCLIENTS);
 	SV_CheckForNewClients ();
+	SV_StatsLeave ();
 
 // read client messages
+	SV_StatsEnter (SVP_RUNCLIENTS);
 	SV_RunClients ();
+	SV_StatsLeave ();
 	
 // move things around and think
 // always pause in single player if in console or menus
 	if (!sv.paused && (svs.maxclients > 1 || key_dest == key_game) )
 		SV_Physics ();
 
+// reclaim the temporary strings nothing refers to
+	PR_FreeTempStrings ();
+
 // send all messages to the clients
+	SV_StatsEnter (SVP_SEND);
 	SV_SendClientMessages ();
+	SV_StatsLeave ();
+
+	SV_StatsEndTick ();
 }
 
 #endif
@@ -678,7 +708,13 @@ void _Host_Frame (float time)
 	float		save_frametime;
 
 	if (setjmp (host_abortserver) )
-		return;			// something bad happened, or the server disconnected
+	{	// something bad happened, or the server disconnected
+#ifndef SERVERONLY
+		S_ClearPrecache ();
+#endif
+		COM_FreePrefetched ();
+		return;
+	}
 
 // keep the random time dependent
 	rand ();
@@ -703,16 +739,22 @@ void _Host_Frame (float time)
 // get new key events (every frame)
 	Sys_SendKeyEvents ();
 
+#ifndef SERVERONLY
 // allow mice or other external controllers to add commands (every frame)
 	IN_Commands ();
+#endif
 
 // process console commands (every frame)
 	Cbuf_Execute ();
 
+#ifndef SERVERONLY
 // Update view angles every frame for smooth mouse
 	IN_UpdateViewAngles ();
+#endif
 
+	SV_StatsEnter (SVP_NETPOLL);
 	NET_Poll();
+	SV_StatsLeave ();
 
 //-------------------
 //
@@ -732,8 +774,10 @@ void _Host_Frame (float time)
 		// check for commands typed to the host
 		Host_GetConsoleCommands ();
 
+#ifndef SERVERONLY
 		// Send movement command to server (uses current viewangles)
 		CL_SendCmd ();
+#endif
 
 		// Server operations
 		if (sv.active)
@@ -745,6 +789,7 @@ void _Host_Frame (float time)
 		host_frametime = save_frametime;
 	}
 
+#ifndef SERVERONLY
 // Client update (every frame) - includes CL_RelinkEntities for interpolation
 	if (cls.state == ca_connected)
 		CL_ReadFromServer ();
@@ -768,6 +813,7 @@ void _Host_Frame (float time)
 		S_Update (vec3_origin, vec3_origin, vec3_origin, vec3_origin);
 
 	CDAudio_Update();
+#endif
 
 	if (host_speeds.value)
 	{
@@ -911,14 +957,20 @@ void Host_Init (quakeparms_t *parms)
 	Cbuf_Init ();
 	Cmd_Init ();	
 	V_Init ();
+#ifndef SERVERONLY
 	Chase_Init ();
+#endif
 	Host_InitVCR (parms);
 	COM_Init (parms->basedir);
 	Host_InitLocal ();
+#ifndef SERVERONLY
 	W_LoadWadFile ("gfx.wad");
 	Key_Init ();
+#endif
 	Con_Init ();	
+#ifndef SERVERONLY
 	M_Init ();	
+#endif
 	PR_Init ();
 	Mod_Init ();
 	NET_Init ();
@@ -927,6 +979,12 @@ void Host_Init (quakeparms_t *parms)
 	Con_Printf ("Exe: "__TIME__" "__DATE__"\n");
 	Con_Printf ("%4.1f megabyte heap\n",parms->memsize/ (1024*1024.0));
 	
+#ifdef SERVERONLY
+	Cbuf_InsertText (
+		"exec autoexec.cfg\n"
+		"stuffcmds\n"
+	);
+#else
 	R_InitTextures ();		// needed even for dedicated servers
  
 	if (cls.state != ca_dedicated)
@@ -976,6 +1034,7 @@ void Host_Init (quakeparms_t *parms)
 		"exec autoexec.cfg\n"
 		"stuffcmds\n"
 	);
+#endif
 
 	Hunk_AllocName (0, "-HOST_HUNKLEVEL-");
 	host_hunklevel = Hunk_LowMark ();
@@ -1010,6 +1069,9 @@ void Host_Shutdown(void)
 
 	Host_WriteConfiguration (); 
 
+#ifdef SERVERONLY
+	NET_Shutdown ();
+#else
 	CDAudio_Shutdown ();
 	NET_Shutdown ();
 	S_Shutdown();
@@ -1019,5 +1081,6 @@ void Host_Shutdown(void)
 	{
 		VID_Shutdown();
 	}
+#endif
 }
 
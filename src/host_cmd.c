@@ -431,6 +431,89 @@ LOAD / SAVE GAME
 */
 
 #define	SAVEGAME_VERSION	5
+#define	SAVEGAME_SNAPSHOT	6	// the same header, then an ED_WriteSnapshot
+
+/*
+===============
+Host_WriteEdicts
+
+The globals and edicts as text
+===============
+*/
+static void Host_WriteEdicts (FILE *f)
+{
+	int		i;
+
+	ED_WriteGlobals (f);
+	for (i=0 ; i<sv.num_edicts ; i++)
+	{
+		ED_Write (f, EDICT_NUM(i));
+		fflush (f);
+	}
+}
+
+/*
+===============
+Host_ReadEdicts
+
+Reads what Host_WriteEdicts wrote, linking the edicts as they come if link
+is set.  Returns the number of edicts read.
+===============
+*/
+static int Host_ReadEdicts (FILE *f, qboolean link)
+{
+	char	str[32768], *start;
+	int		i, r;
+	edict_t	*ent;
+	int		entnum;
+
+	entnum = -1;		// -1 is the globals
+	while (!feof(f))
+	{
+		for (i=0 ; i<sizeof(str)-1 ; i++)
+		{
+			r = fgetc (f);
+			if (r == EOF || !r)
+				break;
+			str[i] = r;
+			if (r == '}')
+			{
+				i++;
+				break;
+			}
+		}
+		if (i == sizeof(str)-1)
+			Sys_Error ("Loadgame buffer overflow");
+		str[i] = 0;
+		start = str;
+		start = COM_Parse(str);
+		if (!com_token[0])
+			break;		// end of file
+		if (strcmp(com_token,"{"))
+			Sys_Error ("First token isn't a brace");
+			
+		if (entnum == -1)
+		{	// parse the global vars
+			ED_ParseGlobals (start);
+		}
+		else
+		{	// parse an edict
+
+			ent = EDICT_NUM(entnum);
+			memset (&ent->v, 0, progs->entityfields * 4);
+			ent->free = false;
+			ED_ParseEdict (start, ent);
+	
+		// link it into the bsp tree
+			if (link && !ent->free)
+				SV_LinkEdict (ent, false);
+		}
+
+		entnum++;
+	}
+
+	return entnum;
+}
 
 /*
 ===============
@@ -515,14 +598,14 @@ void Host_Savegame_f (void)
 	COM_DefaultExtension (name, ".sav");
 	
 	Con_Printf ("Saving game to %s...\n", name);
-	f = fopen (name, "w");
+	f = fopen (name, "wb");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
 	
-	fprintf (f, "%i\n", SAVEGAME_VERSION);
+	fprintf (f, "%i\n", pr_savebinary.value ? SAVEGAME_SNAPSHOT : SAVEGAME_VERSION);
 	Host_SavegameComment (comment);
 	fprintf (f, "%s\n", comment);
 	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
@@ -542,12 +625,10 @@ void Host_Savegame_f (void)
 	}
 
 
-	ED_WriteGlobals (f);
-	for (i=0 ; i<sv.num_edicts ; i++)
-	{
-		ED_Write (f, EDICT_NUM(i));
-		fflush (f);
-	}
+	if (pr_savebinary.value)
+		ED_WriteSnapshot (f, true, 0, 0);
+	else
+		Host_WriteEdicts (f);
 	fclose (f);
 	Con_Printf ("done.\n");
 }
@@ -564,9 +645,8 @@ void Host_Loadgame_f (void)
 	FILE	*f;
 	char	mapname[MAX_QPATH];
 	float	time, tfloat;
-	char	str[32768], *start;
-	int		i, r;
-	edict_t	*ent;
+	char	str[32768];
+	int		i;
 	int		entnum;
 	int		version;
 	float			spawn_parms[NUM_SPAWN_PARMS];
@@ -590,7 +670,7 @@ void Host_Loadgame_f (void)
 //	SCR_BeginLoadingPlaque ();
 
 	Con_Printf ("Loading game from %s...\n", name);
-	f = fopen (name, "r");
+	f = fopen (name, "rb");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
@@ -598,10 +678,10 @@ void Host_Loadgame_f (void)
 	}
 
 	fscanf (f, "%i\n", &version);
-	if (version != SAVEGAME_VERSION)
+	if (version != SAVEGAME_VERSION && version != SAVEGAME_SNAPSHOT)
 	{
 		fclose (f);
-		Con_Printf ("Savegame is version %i, not %i\n", version, SAVEGAME_VERSION);
+		Con_Printf ("Savegame is version %i, not %i or %i\n", version, SAVEGAME_VERSION, SAVEGAME_SNAPSHOT);
 		return;
 	}
 	fscanf (f, "%s\n", str);
@@ -646,53 +726,19 @@ void Host_Loadgame_f (void)
 	}
 
 // load the edicts out of the savegame file
-	entnum = -1;		// -1 is the globals
-	while (!feof(f))
+	if (version == SAVEGAME_SNAPSHOT)
+		entnum = ED_ReadSnapshot (f, true);
+	else
+		entnum = Host_ReadEdicts (f, true);
+	if (entnum < 0)
 	{
-		for (i=0 ; i<sizeof(str)-1 ; i++)
-		{
-			r = fgetc (f);
-			if (r == EOF || !r)
-				break;
-			str[i] = r;
-			if (r == '}')
-			{
-				i++;
-				break;
-			}
-		}
-		if (i == sizeof(str)-1)
-			Sys_Error ("Loadgame buffer overflow");
-		str[i] = 0;
-		start = str;
-		start = COM_Parse(str);
-		if (!com_token[0])
-			break;		// end of file
-		if (strcmp(com_token,"{"))
-			Sys_Error ("First token isn't a brace");
-			
-		if (entnum == -1)
-		{	// parse the global vars
-			ED_ParseGlobals (start);
-		}
-		else
-		{	// parse an edict
-
-			ent = EDICT_NUM(entnum);
-			memset (&ent->v, 0, progs->entityfields * 4);
-			ent->free = false;
-			ED_ParseEdict (start, ent);
-	
-		// link it into the bsp tree
-			if (!ent->free)
-				SV_LinkEdict (ent, false);
-		}
-
-		entnum++;
+		fclose (f);
+		Host_Error ("Couldn't load %s", name);
 	}
 	
 	sv.num_edicts = entnum;
 	sv.time = time;
+	ED_Reindex ();
 
 	fclose (f);
 
@@ -706,6 +752,173 @@ void Host_Loadgame_f (void)
 	}
 }
 
+/*
+===============
+Host_SaveBenchCompare
+
+The edicts and saved globals that differ from the copies
+===============
+*/
+static int Host_SaveBenchCompare (byte *edicts, int *globals, int numedicts)
+{
+	int		i, e, type, bad, differ;
+	int		*a, *b;
+	ddef_t	*def;
+	edict_t	*ent, *old;
+
+	differ = 0;
+	for (e=0 ; e<numedicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+		old = (edict_t *)(edicts + e*pr_edict_size);
+		bad = ent->free != old->free;
+		for (i=1, def=pr_fielddefs+1 ; i<progs->numfielddefs && !bad && !ent->free ; i++, def++)
+		{
+			type = def->type & ~DEF_SAVEGLOBAL;
+			a = (int *)&ent->v + def->ofs;
+			b = (int *)&old->v + def->ofs;
+			if (type == ev_string)
+				bad = strcmp (pr_strings + *a, pr_strings + *b) != 0;
+			else
+				bad = memcmp (a, b, type_size[type]*4) != 0;
+		}
+		if (bad)
+			differ++;
+	}
+
+	for (i=0, def=pr_globaldefs ; i<progs->numglobaldefs ; i++, def++)
+	{
+		if ( !(def->type & DEF_SAVEGLOBAL) )
+			continue;
+		type = def->type & ~DEF_SAVEGLOBAL;
+		a = (int *)pr_globals + def->ofs;
+		b = globals + def->ofs;
+		if (type == ev_string)
+			bad = strcmp (pr_strings + *a, pr_strings + *b) != 0;
+		else if (type == ev_float || type == ev_entity)
+			bad = *a != *b;
+		else
+			continue;
+		if (bad)
+			differ++;
+	}
+
+	return differ;
+}
+
+/*
+===============
+Host_SaveBench_f
+
+savebench [runs]
+
+Times writing and reading the globals and edicts of the running level as
+text and as a snapshot, the way save and load do, and checks that the
+snapshot gives back what was saved.  The level is put back afterwards.
+===============
+*/
+void Host_SaveBench_f (void)
+{
+	char	name[MAX_OSPATH];
+	FILE	*f;
+	byte	*edicts;
+	int		*globals;
+	int		i, run, runs, binary, mark, numedicts, size[2], differ;
+	double	start, writetime[2], readtime[2];
+
+	if (!sv.active)
+	{
+		Con_Printf ("savebench: no server running\n");
+		return;
+	}
+	runs = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : 10;
+	if (runs < 1)
+		runs = 1;
+	if (snprintf (name, sizeof(name), "%s/savebench.tmp", com_gamedir) >= (int)sizeof(name))
+	{
+		Con_Printf ("savebench: game directory name is too long\n");
+		return;
+	}
+
+	numedicts = sv.num_edicts;
+	edicts = malloc (numedicts * pr_edict_size);
+	globals = malloc (progs->numglobals * 4);
+	if (!edicts || !globals)
+	{
+		free (edicts);
+		free (globals);
+		Con_Printf ("savebench: out of memory\n");
+		return;
+	}
+	memcpy (edicts, sv.edicts, numedicts * pr_edict_size);
+	memcpy (globals, pr_globals, progs->numglobals * 4);
+	mark = Hunk_LowMark ();
+
+	differ = 0;
+	for (binary=0 ; binary<2 ; binary++)
+	{
+		writetime[binary] = readtime[binary] = 0;
+		size[binary] = 0;
+		for (run=0 ; run<runs ; run++)
+		{
+			f = fopen (name, "wb");
+			if (!f)
+			{
+				Con_Printf ("savebench: couldn't open %s\n", name);
+				goto done;
+			}
+			start = Sys_FloatTime ();
+			if (binary)
+				ED_WriteSnapshot (f, true, 0, 0);
+			else
+				Host_WriteEdicts (f);
+			fflush (f);
+			writetime[binary] += Sys_FloatTime () - start;
+			size[binary] = ftell (f);
+			fclose (f);
+
+			f = fopen (name, "rb");
+			if (!f)
+			{
+				Con_Printf ("savebench: couldn't open %s\n", name);
+				goto done;
+			}
+			start = Sys_FloatTime ();
+			if (binary)
+				i = ED_ReadSnapshot (f, false);
+			else
+				i = Host_ReadEdicts (f, false);
+			readtime[binary] += Sys_FloatTime () - start;
+			fclose (f);
+
+			if (binary && run == 0)
+				differ = i != numedicts ? numedicts : Host_SaveBenchCompare (edicts, globals, numedicts);
+
+			memcpy (sv.edicts, edicts, numedicts * pr_edict_size);
+			memcpy (pr_globals, globals, progs->numglobals * 4);
+			Hunk_FreeToLowMark (mark);
+		}
+	}
+
+	Con_Printf ("%i edicts of %i bytes, %i runs\n", numedicts, pr_edict_size, runs);
+	Con_Printf ("          write ms  read ms    bytes\n");
+	for (binary=0 ; binary<2 ; binary++)
+		Con_Printf ("%-8s %9.2f %8.2f %8i\n", binary ? "snapshot" : "text",
+			writetime[binary] * 1000 / runs, readtime[binary] * 1000 / runs, size[binary]);
+	if (differ)
+		Con_Printf ("%i edicts or globals differ after the snapshot\n", differ);
+
+done:
+	remove (name);
+	memcpy (sv.edicts, edicts, numedicts * pr_edict_size);
+	memcpy (pr_globals, globals, progs->numglobals * 4);
+	Hunk_FreeToLowMark (mark);
+	sv.num_edicts = numedicts;
+	ED_Reindex ();
+	free (edicts);
+	free (globals);
+}
+
 #ifdef QUAKE2
 void SaveGamestate()
 {
@@ -718,14 +931,14 @@ void SaveGamestate()
 	sprintf (name, "%s/%s.gip", com_gamedir, sv.name);
 	
 	Con_Printf ("Saving game to %s...\n", name);
-	f = fopen (name, "w");
+	f = fopen (name, "wb");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
 	
-	fprintf (f, "%i\n", SAVEGAME_VERSION);
+	fprintf (f, "%i\n", pr_savebinary.value ? SAVEGAME_SNAPSHOT : SAVEGAME_VERSION);
 	Host_SavegameComment (comment);
 	fprintf (f, "%s\n", comment);
 //	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
@@ -745,6 +958,14 @@ void SaveGamestate()
 	}
 
 
+	if (pr_savebinary.value)
+	{
+		ED_WriteSnapshot (f, false, svs.maxclients+1, FL_ARCHIVE_OVERRIDE);
+		fclose (f);
+		Con_Printf ("done.\n");
+		return;
+	}
+
 	for (i=svs.maxclients+1 ; i<sv.num_edicts ; i++)
 	{
 		ent = EDICT_NUM(i);
@@ -774,7 +995,7 @@ int LoadGamestate(char *level, char *startspot)
 	sprintf (name, "%s/%s.gip", com_gamedir, level);
 	
 	Con_Printf ("Loading game from %s...\n", name);
-	f = fopen (name, "r");
+	f = fopen (name, "rb");
 	if (!f)
 	{
 		Con_Printf ("ERROR: couldn't open.\n");
@@ -782,10 +1003,10 @@ int LoadGamestate(char *level, char *startspot)
 	}
 
 	fscanf (f, "%i\n", &version);
-	if (version != SAVEGAME_VERSION)
+	if (version != SAVEGAME_VERSION && version != SAVEGAME_SNAPSHOT)
 	{
 		fclose (f);
-		Con_Printf ("Savegame is version %i, not %i\n", version, SAVEGAME_VERSION);
+		Con_Printf ("Savegame is version %i, not %i or %i\n", version, SAVEGAME_VERSION, SAVEGAME_SNAPSHOT);
 		return -1;
 	}
 	fscanf (f, "%s\n", str);
@@ -814,7 +1035,12 @@ int LoadGamestate(char *level, char *startspot)
 	}
 
 // load the edicts out of the savegame file
-	while (!feof(f))
+	if (version == SAVEGAME_SNAPSHOT && ED_ReadSnapshot (f, true) < 0)
+	{
+		fclose (f);
+		Host_Error ("Couldn't load %s", name);
+	}
+	while (version == SAVEGAME_VERSION && !feof(f))
 	{
 		fscanf (f, "%i\n",&entnum);
 		for (i=0 ; i<sizeof(str)-1 ; i++)
@@ -853,6 +1079,7 @@ int LoadGamestate(char *level, char *startspot)
 	
 //	sv.num_edicts = entnum;
 	sv.time = time;
+	ED_Reindex ();
 	fclose (f);
 
 //	for (i=0 ; i<NUM_SPAWN_PARMS ; i++)
@@ -1246,6 +1473,33 @@ void Host_Pause_f (void)
 //===========================================================================
 
 
+/*
+==================
+Host_DeltaEntities_f
+
+Sent by the client at signon if it can decode svc_deltaentities
+==================
+*/
+void Host_DeltaEntities_f (void)
+{
+	extern	cvar_t	sv_deltaentities;
+
+	if (cmd_source == src_command)
+	{
+		Con_Printf ("deltaentities is not valid from the console\n");
+		return;
+	}
+
+	if (host_client->spawned)
+	{
+		Con_Printf ("deltaentities not valid -- allready spawned\n");
+		return;
+	}
+
+	if (sv_deltaentities.value)
+		host_client->deltaentities = true;
+}
+
 /*
 ==================
 Host_PreSpawn_f
@@ -1570,7 +1824,7 @@ void Host_Give_f (void)
     case 's':
 		if (rogue)
 		{
-	        val = GetEdictFieldValue(sv_player, "ammo_shells1");
+	        val = GETEDICTFIELDVALUE(sv_player, eval_ammo_shells1);
 		    if (val)
 			    val->_float = v;
 		}
@@ -1580,7 +1834,7 @@ void Host_Give_f (void)
     case 'n':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_nails1");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_nails1);
 			if (val)
 			{
 				val->_float = v;
@@ -1596,7 +1850,7 @@ void Host_Give_f (void)
     case 'l':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_lava_nails");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_lava_nails);
 			if (val)
 			{
 				val->_float = v;
@@ -1608,7 +1862,7 @@ void Host_Give_f (void)
     case 'r':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_rockets1");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_rockets1);
 			if (val)
 			{
 				val->_float = v;
@@ -1624,7 +1878,7 @@ void Host_Give_f (void)
     case 'm':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_multi_rockets");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_multi_rockets);
 			if (val)
 			{
 				val->_float = v;
@@ -1639,7 +1893,7 @@ void Host_Give_f (void)
     case 'c':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_cells1");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_cells1);
 			if (val)
 			{
 				val->_float = v;
@@ -1655,7 +1909,7 @@ void Host_Give_f (void)
     case 'p':
 		if (rogue)
 		{
-			val = GetEdictFieldValue(sv_player, "ammo_plasma");
+			val = GETEDICTFIELDVALUE(sv_player, eval_ammo_plasma);
 			if (val)
 			{
 				val->_float = v;
@@ -1906,20 +2160,24 @@ void Host_InitCommands (void)
 	Cmd_AddCommand ("spawn", Host_Spawn_f);
 	Cmd_AddCommand ("begin", Host_Begin_f);
 	Cmd_AddCommand ("prespawn", Host_PreSpawn_f);
+	Cmd_AddCommand ("deltaentities", Host_DeltaEntities_f);
 	Cmd_AddCommand ("kick", Host_Kick_f);
 	Cmd_AddCommand ("ping", Host_Ping_f);
 	Cmd_AddCommand ("load", Host_Loadgame_f);
 	Cmd_AddCommand ("save", Host_Savegame_f);
+	Cmd_AddCommand ("savebench", Host_SaveBench_f);
 	Cmd_AddCommand ("give", Host_Give_f);
 
 	Cmd_AddCommand ("startdemos", Host_Startdemos_f);
 	Cmd_AddCommand ("demos", Host_Demos_f);
 	Cmd_AddCommand ("stopdemo", Host_Stopdemo_f);
 
+#ifndef SERVERONLY
 	Cmd_AddCommand ("viewmodel", Host_Viewmodel_f);
 	Cmd_AddCommand ("viewframe", Host_Viewframe_f);
 	Cmd_AddCommand ("viewnext", Host_Viewnext_f);
 	Cmd_AddCommand ("viewprev", Host_Viewprev_f);
+#endif
 
 	Cmd_AddCommand ("mcache", Mod_Print);
 }
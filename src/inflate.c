@@ -0,0 +1,419 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// inflate.c -- raw deflate streams, as zip files store them
+
+/*
+Decodes RFC 1951 deflate data into a buffer whose size is known up front,
+which it is for a file in a zip.  Huffman codes up to INF_FASTBITS long
+are looked up in one step; longer ones are decoded a bit at a time from
+the code counts.  Nothing is shared between calls, so several files can
+be inflated on different threads at once.
+*/
+
+#include "quakedef.h"
+
+#define	INF_MAXBITS		15
+#define	INF_FASTBITS	9
+#define	INF_MAXLCODES	286
+#define	INF_MAXDCODES	30
+#define	INF_FIXLCODES	288
+#define	INF_MAXPAD		8		// zero bytes read past the end before giving up
+
+typedef struct
+{
+	short			count[INF_MAXBITS+1];	// codes of each length
+	short			symbol[INF_FIXLCODES];	// in code order
+	unsigned short	fast[1<<INF_FASTBITS];	// length<<9 | symbol, 0 = look slowly
+} infhuff_t;
+
+typedef struct
+{
+	byte		*in, *inend;
+	unsigned	bits;
+	int			numbits;
+	int			pad;					// zero bytes made up past the end
+
+	byte		*out, *outstart, *outend;
+} infstate_t;
+
+static const short	inf_lenbase[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const short	inf_lenextra[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const short	inf_distbase[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+	8193, 12289, 16385, 24577};
+static const short	inf_distextra[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+/*
+============
+Inf_Need
+
+Makes sure there are n bits, n <= 16, reading zeros past the end
+============
+*/
+static qboolean Inf_Need (infstate_t *s, int n)
+{
+	while (s->numbits < n)
+	{
+		if (s->in < s->inend)
+			s->bits |= (unsigned)*s->in++ << s->numbits;
+		else if (++s->pad > INF_MAXPAD)
+			return false;
+		s->numbits += 8;
+	}
+	return true;
+}
+
+static int Inf_Bits (infstate_t *s, int n)
+{
+	int		v;
+
+	if (!n)
+		return 0;
+	if (!Inf_Need (s, n))
+		return -1;
+	v = s->bits & ((1<<n) - 1);
+	s->bits >>= n;
+	s->numbits -= n;
+	return v;
+}
+
+/*
+============
+Inf_Build
+
+Builds the decoding tables from the code lengths.  Returns false for a
+set of lengths that has too many codes.
+============
+*/
+static qboolean Inf_Build (infhuff_t *h, const byte *lengths, int n)
+{
+	short	offs[INF_MAXBITS+1];
+	int		len, sym, left, code, rev, i;
+
+	memset (h->count, 0, sizeof(h->count));
+	memset (h->fast, 0, sizeof(h->fast));
+	for (sym=0 ; sym<n ; sym++)
+		h->count[lengths[sym]]++;
+	if (h->count[0] == n)
+		return true;			// no codes, anything decoded is an error
+
+	left = 1;
+	for (len=1 ; len<=INF_MAXBITS ; len++)
+	{
+		left <<= 1;
+		left -= h->count[len];
+		if (left < 0)
+			return false;
+	}
+
+	offs[1] = 0;
+	for (len=1 ; len<INF_MAXBITS ; len++)
+		offs[len+1] = offs[len] + h->count[len];
+	for (sym=0 ; sym<n ; sym++)
+		if (lengths[sym])
+			h->symbol[offs[lengths[sym]]++] = sym;
+
+// the short codes, bit reversed as they come out of the stream
+	code = 0;
+	i = 0;
+	for (len=1 ; len<=INF_MAXBITS ; len++)
+	{
+		for (left=0 ; left<h->count[len] ; left++, i++, code++)
+		{
+			if (len > INF_FASTBITS)
+				continue;
+			for (rev=0, sym=0 ; sym<len ; sym++)
+				rev |= ((code >> sym) & 1) << (len-1-sym);
+			for ( ; rev < (1<<INF_FASTBITS) ; rev += 1<<len)
+				h->fast[rev] = (len<<9) | h->symbol[i];
+		}
+		code <<= 1;
+	}
+	return true;
+}
+
+/*
+============
+Inf_Decode
+
+The next symbol, -1 for a bad code
+============
+*/
+static int Inf_Decode (infstate_t *s, infhuff_t *h)
+{
+	int		e, len, code, first, index, count, bit;
+
+	if (s->numbits < INF_FASTBITS)
+		Inf_Need (s, INF_FASTBITS);		// a short code may still fit if this runs out
+	e = h->fast[s->bits & ((1<<INF_FASTBITS)-1)];
+	if (e && (e>>9) <= s->numbits)
+	{
+		s->bits >>= e>>9;
+		s->numbits -= e>>9;
+		return e & 511;
+	}
+
+	code = first = index = 0;
+	for (len=1 ; len<=INF_MAXBITS ; len++)
+	{
+		bit = Inf_Bits (s, 1);
+		if (bit < 0)
+			return -1;
+		code |= bit;
+		count = h->count[len];
+		if (code - count < first)
+			return h->symbol[index + (code - first)];
+		index += count;
+		first += count;
+		first <<= 1;
+		code <<= 1;
+	}
+	return -1;
+}
+
+/*
+============
+Inf_Stored
+============
+*/
+static qboolean Inf_Stored (infstate_t *s)
+{
+	int		len, nlen;
+
+	s->bits >>= s->numbits & 7;		// to a byte boundary
+	s->numbits &= ~7;
+	len = Inf_Bits (s, 16);
+	nlen = Inf_Bits (s, 16);
+	if (len < 0 || nlen < 0 || len != (~nlen & 0xffff))
+		return false;
+	if (len > s->outend - s->out)
+		return false;
+
+	while (len && s->numbits >= 8)
+	{
+		*s->out++ = Inf_Bits (s, 8);
+		len--;
+	}
+	if (len > s->inend - s->in)
+		return false;
+	memcpy (s->out, s->in, len);
+	s->out += len;
+	s->in += len;
+	return true;
+}
+
+/*
+============
+Inf_Codes
+
+Decodes one block with the given codes
+============
+*/
+static qboolean Inf_Codes (infstate_t *s, infhuff_t *lencode, infhuff_t *distcode)
+{
+	int		sym, len, dist, extra;
+	byte	*from;
+
+	while (1)
+	{
+		sym = Inf_Decode (s, lencode);
+		if (sym < 0)
+			return false;
+		if (sym < 256)
+		{
+			if (s->out == s->outend)
+				return false;
+			*s->out++ = sym;
+			continue;
+		}
+		if (sym == 256)
+			return true;
+
+		sym -= 257;
+		if (sym >= 29)
+			return false;
+		extra = Inf_Bits (s, inf_lenextra[sym]);
+		if (extra < 0)
+			return false;
+		len = inf_lenbase[sym] + extra;
+
+		sym = Inf_Decode (s, distcode);
+		if (sym < 0 || sym >= 30)
+			return false;
+		extra = Inf_Bits (s, inf_distextra[sym]);
+		if (extra < 0)
+			return false;
+		dist = inf_distbase[sym] + extra;
+
+		if (dist > s->out - s->outstart || len > s->outend - s->out)
+			return false;
+		from = s->out - dist;
+		while (len--)
+			*s->out++ = *from++;
+	}
+}
+
+/*
+============
+Inf_Fixed
+============
+*/
+static qboolean Inf_Fixed (infstate_t *s)
+{
+	infhuff_t	lencode, distcode;
+	byte		lengths[INF_FIXLCODES];
+	int			sym;
+
+	for (sym=0 ; sym<144 ; sym++)
+		lengths[sym] = 8;
+	for ( ; sym<256 ; sym++)
+		lengths[sym] = 9;
+	for ( ; sym<280 ; sym++)
+		lengths[sym] = 7;
+	for ( ; sym<INF_FIXLCODES ; sym++)
+		lengths[sym] = 8;
+	Inf_Build (&lencode, lengths, INF_FIXLCODES);
+	for (sym=0 ; sym<INF_MAXDCODES ; sym++)
+		lengths[sym] = 5;
+	Inf_Build (&distcode, lengths, INF_MAXDCODES);
+
+	return Inf_Codes (s, &lencode, &distcode);
+}
+
+/*
+============
+Inf_Dynamic
+============
+*/
+static qboolean Inf_Dynamic (infstate_t *s)
+{
+	static const byte	order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+	infhuff_t	lencode, distcode;
+	byte		lengths[INF_MAXLCODES+INF_MAXDCODES];
+	int			nlen, ndist, ncode, index, sym, len, rep;
+
+	nlen = Inf_Bits (s, 5) + 257;
+	ndist = Inf_Bits (s, 5) + 1;
+	ncode = Inf_Bits (s, 4) + 4;
+	if (nlen > INF_MAXLCODES || ndist > INF_MAXDCODES || nlen < 257 || ndist < 1 || ncode < 4)
+		return false;
+
+// the code length code
+	memset (lengths, 0, 19);
+	for (index=0 ; index<ncode ; index++)
+	{
+		len = Inf_Bits (s, 3);
+		if (len < 0)
+			return false;
+		lengths[order[index]] = len;
+	}
+	if (!Inf_Build (&lencode, lengths, 19))
+		return false;
+
+// the literal/length and distance code lengths
+	index = 0;
+	while (index < nlen + ndist)
+	{
+		sym = Inf_Decode (s, &lencode);
+		if (sym < 0)
+			return false;
+		if (sym < 16)
+		{
+			lengths[index++] = sym;
+			continue;
+		}
+		len = 0;
+		if (sym == 16)
+		{
+			if (!index)
+				return false;
+			len = lengths[index-1];
+			rep = Inf_Bits (s, 2);
+			rep = rep < 0 ? -1 : rep + 3;
+		}
+		else if (sym == 17)
+		{
+			rep = Inf_Bits (s, 3);
+			rep = rep < 0 ? -1 : rep + 3;
+		}
+		else
+		{
+			rep = Inf_Bits (s, 7);
+			rep = rep < 0 ? -1 : rep + 11;
+		}
+		if (rep < 0 || index + rep > nlen + ndist)
+			return false;
+		while (rep--)
+			lengths[index++] = len;
+	}
+	if (!lengths[256])
+		return false;			// no end of block code
+
+	if (!Inf_Build (&lencode, lengths, nlen)
+	|| !Inf_Build (&distcode, lengths + nlen, ndist))
+		return false;
+	return Inf_Codes (s, &lencode, &distcode);
+}
+
+/*
+============
+Inflate
+
+Inflates a raw deflate stream of inlen bytes into out.  Returns the
+number of bytes written, or -1 if the stream is bad or doesn't fit.
+============
+*/
+int Inflate (byte *out, int outlen, byte *in, int inlen)
+{
+	infstate_t	s;
+	int			last, type;
+	qboolean	ok;
+
+	memset (&s, 0, sizeof(s));
+	s.in = in;
+	s.inend = in + inlen;
+	s.out = s.outstart = out;
+	s.outend = out + outlen;
+
+	do
+	{
+		last = Inf_Bits (&s, 1);
+		type = Inf_Bits (&s, 2);
+		if (type == 0)
+			ok = Inf_Stored (&s);
+		else if (type == 1)
+			ok = Inf_Fixed (&s);
+		else if (type == 2)
+			ok = Inf_Dynamic (&s);
+		else
+			ok = false;
+		if (!ok || s.numbits < s.pad*8)		// used made up bits
+			return -1;
+	} while (!last);
+
+	return s.out - s.outstart;
+}
@@ -681,11 +681,12 @@ void PF_checkpos (void)
 
 //============================================================================
 
-byte	checkpvs[MAX_MAP_LEAFS/8];
+byte	checkpvsbuf[MAX_MAP_LEAFS/8];
+byte	*checkpvs = checkpvsbuf;
 
 int PF_newcheckclient (int check)
 {
-	int		i;
+	int		i, l;
 	byte	*pvs;
 	edict_t	*ent;
 	mleaf_t	*leaf;
@@ -728,7 +729,14 @@ int PF_newcheckclient (int check)
 	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
 	leaf = Mod_PointInLeaf (org, sv.worldmodel);
 	pvs = Mod_LeafPVS (leaf, sv.worldmodel);
-	memcpy (checkpvs, pvs, (sv.worldmodel->numleafs+7)>>3 );
+	l = leaf - sv.worldmodel->leafs - 1;
+	if (sv.worldmodel->visrows && l >= 0 && l < sv.worldmodel->numleafs)
+		checkpvs = pvs;		// points into the decompressed table
+	else
+	{
+		memcpy (checkpvsbuf, pvs, (sv.worldmodel->numleafs+7)>>3 );
+		checkpvs = checkpvsbuf;
+	}
 
 	return i;
 }
@@ -875,31 +883,83 @@ PF_findradius
 Returns a chain of entities that have origins within a spherical area
 
 findradius (origin, radius)
+
+With pr_findindex, the candidates come from the area structure instead of
+every edict.  The center of an entity is always inside its abs box, so the
+box around the sphere finds every entity that isn't SOLID_NOT, where it was
+last linked, the same as traces and touches see it.  They are taken in edict
+order so the chain comes out the same as from the full scan.
 =================
 */
+static qboolean PF_InRadius (edict_t *ent, float *org, float rad)
+{
+	vec3_t	eorg;
+	int		j;
+
+	if (ent->free)
+		return false;
+	if (ent->v.solid == SOLID_NOT)
+		return false;
+	for (j=0 ; j<3 ; j++)
+		eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j])*0.5);			
+	if (Length(eorg) > rad)
+		return false;
+	return true;
+}
+
+static int PF_EdictCompare (const void *a, const void *b)
+{
+	edict_t	*ea, *eb;
+
+	ea = *(edict_t **)a;
+	eb = *(edict_t **)b;
+	if (ea < eb)
+		return -1;
+	return ea > eb;
+}
+
 void PF_findradius (void)
 {
 	edict_t	*ent, *chain;
 	float	rad;
 	float	*org;
-	vec3_t	eorg;
-	int		i, j;
+	int		i, j, count;
+	vec3_t	mins, maxs;
+	edict_t	*touch[MAX_EDICTS];
 
 	chain = (edict_t *)sv.edicts;
 	
 	org = G_VECTOR(OFS_PARM0);
 	rad = G_FLOAT(OFS_PARM1);
 
+	if (pr_findindex.value && rad >= 0 && rad < 65536
+	&& fabs(org[0]) < 65536 && fabs(org[1]) < 65536 && fabs(org[2]) < 65536)
+	{
+		for (j=0 ; j<3 ; j++)
+		{	// a unit of slack for the float rounding of the test
+			mins[j] = org[j] - rad - 1;
+			maxs[j] = org[j] + rad + 1;
+		}
+		count = SV_AreaEdicts (mins, maxs, touch);
+		qsort (touch, count, sizeof(touch[0]), PF_EdictCompare);
+
+		for (i=0 ; i<count ; i++)
+		{
+			ent = touch[i];
+			if (!PF_InRadius (ent, org, rad))
+				continue;
+			ent->v.chain = EDICT_TO_PROG(chain);
+			chain = ent;
+		}
+
+		RETURN_EDICT(chain);
+		return;
+	}
+
 	ent = NEXT_EDICT(sv.edicts);
 	for (i=1 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
 	{
-		if (ent->free)
-			continue;
-		if (ent->v.solid == SOLID_NOT)
-			continue;
-		for (j=0 ; j<3 ; j++)
-			eorg[j] = org[j] - (ent->v.origin[j] + (ent->v.mins[j] + ent->v.maxs[j])*0.5);			
-		if (Length(eorg) > rad)
+		if (!PF_InRadius (ent, org, rad))
 			continue;
 			
 		ent->v.chain = EDICT_TO_PROG(chain);
@@ -931,7 +991,7 @@ void PF_ftos (void)
 		sprintf (pr_string_temp, "%d",(int)v);
 	else
 		sprintf (pr_string_temp, "%5.1f",v);
-	G_INT(OFS_RETURN) = PR_SetString(ED_NewString(pr_string_temp));
+	G_INT(OFS_RETURN) = PR_SetString(PR_TempString(pr_string_temp));
 }
 
 void PF_fabs (void)
@@ -944,14 +1004,14 @@ void PF_fabs (void)
 void PF_vtos (void)
 {
 	sprintf (pr_string_temp, "'%5.1f %5.1f %5.1f'", G_VECTOR(OFS_PARM0)[0], G_VECTOR(OFS_PARM0)[1], G_VECTOR(OFS_PARM0)[2]);
-	G_INT(OFS_RETURN) = PR_SetString(ED_NewString(pr_string_temp));
+	G_INT(OFS_RETURN) = PR_SetString(PR_TempString(pr_string_temp));
 }
 
 #ifdef QUAKE2
 void PF_etos (void)
 {
 	sprintf (pr_string_temp, "entity %i", G_EDICTNUM(OFS_PARM0));
-	G_INT(OFS_RETURN) = PR_SetString(ED_NewString(pr_string_temp));
+	G_INT(OFS_RETURN) = PR_SetString(PR_TempString(pr_string_temp));
 }
 #endif
 
@@ -1033,6 +1093,12 @@ void PF_Find (void)
 	s = G_STRING(OFS_PARM2);
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
+
+	if (pr_findindex.value && (ed = ED_FindString (e, f, s)))
+	{	// classname, targetname and target are indexed
+		RETURN_EDICT(ed);
+		return;
+	}
 		
 	for (e++ ; e < sv.num_edicts ; e++)
 	{
@@ -50,15 +50,30 @@ cvar_t	saved2 = {"saved2", "0", true};
 cvar_t	saved3 = {"saved3", "0", true};
 cvar_t	saved4 = {"saved4", "0", true};
 
-#define	MAX_FIELD_LEN	64
-#define GEFV_CACHESIZE	2
-
-typedef struct {
-	ddef_t	*pcache;
-	char	field[MAX_FIELD_LEN];
-} gefv_cache;
-
-static gefv_cache	gefvCache[GEFV_CACHESIZE] = {{NULL, ""}, {NULL, ""}};
+// name lookups, built by PR_LoadProgs
+typedef struct
+{
+	int		*slots;			// index+1 of the def, 0 = empty
+	int		mask;
+	byte	*names;			// &defs[0].s_name
+	int		stride;			// sizeof(defs[0])
+} prhash_t;
+
+static prhash_t	pr_fieldhash;
+static prhash_t	pr_globalhash;
+static prhash_t	pr_functionhash;
+
+// byte offsets into entvars of fields that only some progs define, 0 if
+// missing (offset 0 is modelindex, which every progs has)
+int		eval_gravity;
+int		eval_items2;
+int		eval_ammo_shells1;
+int		eval_ammo_nails1;
+int		eval_ammo_lava_nails;
+int		eval_ammo_rockets1;
+int		eval_ammo_multi_rockets;
+int		eval_ammo_cells1;
+int		eval_ammo_plasma;
 
 /*
 =================
@@ -71,6 +86,122 @@ void ED_ClearEdict (edict_t *e)
 {
 	memset (&e->v, 0, progs->entityfields * 4);
 	e->free = false;
+	ED_FindUpdate (e);
+	SV_ThinkChanged (e);
+	SV_HotChanged (e);
+}
+
+/*
+=================
+ED_QueueFree
+
+The free edicts above the clients wait in a queue in the order they were
+freed, which is the order they become reusable in, so ED_Alloc only ever
+has to look at the head.  Edicts that stop being free some other way are
+dropped when they reach the head.
+=================
+*/
+static int		ed_freenext[MAX_EDICTS];	// edict numbers, 0 = none
+static int		ed_freeprev[MAX_EDICTS];
+static qboolean	ed_queued[MAX_EDICTS];
+static int		ed_freehead, ed_freetail;
+static int		ed_numqueued;
+static qboolean	ed_requeue = true;			// rebuild before the next ED_Alloc
+
+static void ED_Unqueue (int e)
+{
+	if (!ed_queued[e])
+		return;
+
+	if (ed_freeprev[e])
+		ed_freenext[ed_freeprev[e]] = ed_freenext[e];
+	else
+		ed_freehead = ed_freenext[e];
+	if (ed_freenext[e])
+		ed_freeprev[ed_freenext[e]] = ed_freeprev[e];
+	else
+		ed_freetail = ed_freeprev[e];
+	ed_queued[e] = false;
+	ed_numqueued--;
+}
+
+static void ED_QueueFree (edict_t *ed)
+{
+	int		e;
+
+	e = NUM_FOR_EDICT(ed);
+	if (e <= svs.maxclients || ed_requeue)
+		return;		// clients are never reallocated
+
+	ED_Unqueue (e);
+	ed_freeprev[e] = ed_freetail;
+	ed_freenext[e] = 0;
+	if (ed_freetail)
+		ed_freenext[ed_freetail] = e;
+	else
+		ed_freehead = e;
+	ed_freetail = e;
+	ed_queued[e] = true;
+	ed_numqueued++;
+}
+
+static int ED_FreetimeCompare (const void *a, const void *b)
+{
+	edict_t	*ea, *eb;
+
+	ea = *(edict_t **)a;
+	eb = *(edict_t **)b;
+	if (ea->freetime != eb->freetime)
+		return ea->freetime < eb->freetime ? -1 : 1;
+	return ea < eb ? -1 : ea > eb;
+}
+
+/*
+=================
+ED_Requeue
+
+Queues the free edicts oldest first, lowest number first for the same time
+=================
+*/
+static void ED_Requeue (void)
+{
+	edict_t	*list[MAX_EDICTS];
+	edict_t	*e;
+	int		i, count;
+
+	memset (ed_queued, 0, sizeof(ed_queued));
+	ed_freehead = ed_freetail = 0;
+	ed_numqueued = 0;
+	ed_requeue = false;
+
+	count = 0;
+	for (i=svs.maxclients+1 ; i<sv.num_edicts ; i++)
+	{
+		e = EDICT_NUM(i);
+		if (e->free)
+			list[count++] = e;
+	}
+	qsort (list, count, sizeof(list[0]), ED_FreetimeCompare);
+
+	for (i=0 ; i<count ; i++)
+		ED_QueueFree (list[i]);
+}
+
+/*
+=================
+ED_Reindex
+
+The edicts have been overwritten wholesale, by a level or savegame load or
+the pr_jittest rollback.  The free queue and the find index are rebuilt
+before they are next used, as are the think schedule and sv_hot.
+=================
+*/
+void ED_Reindex (void)
+{
+	ed_requeue = true;
+	ED_FindReset ();
+	SV_ThinkReset ();
+	SV_HotReset ();
 }
 
 /*
@@ -89,18 +220,30 @@ edict_t *ED_Alloc (void)
 	int			i;
 	edict_t		*e;
 
-	for ( i=svs.maxclients+1 ; i<sv.num_edicts ; i++)
+	if (ed_requeue)
+		ED_Requeue ();
+
+	while (ed_freehead)
 	{
+		i = ed_freehead;
 		e = EDICT_NUM(i);
+		if (!e->free || i >= sv.num_edicts)
+		{
+			ED_Unqueue (i);
+			continue;
+		}
 		// the first couple seconds of server time can involve a lot of
 		// freeing and allocating, so relax the replacement policy
-		if (e->free && ( e->freetime < 2 || sv.time - e->freetime > 0.5 ) )
+		if ( e->freetime < 2 || sv.time - e->freetime > 0.5 )
 		{
+			ED_Unqueue (i);
 			ED_ClearEdict (e);
 			return e;
 		}
+		break;		// the rest were freed later still
 	}
-	
+
+	i = sv.num_edicts;
 	if (i == MAX_EDICTS)
 		Sys_Error ("ED_Alloc: no free edicts");
 		
@@ -136,6 +279,10 @@ void ED_Free (edict_t *ed)
 	ed->v.solid = 0;
 	
 	ed->freetime = sv.time;
+	ED_QueueFree (ed);
+	ED_FindUpdate (ed);
+	SV_ThinkChanged (ed);
+	SV_HotChanged (ed);
 }
 
 //===========================================================================
@@ -180,21 +327,84 @@ ddef_t *ED_FieldAtOfs (int ofs)
 
 /*
 ============
-ED_FindField
+PR_HashName
 ============
 */
-ddef_t *ED_FindField (char *name)
+static unsigned PR_HashName (char *name)
 {
-	ddef_t		*def;
-	int			i;
-	
-	for (i=0 ; i<progs->numfielddefs ; i++)
+	unsigned	hash;
+
+	hash = 0;
+	while (*name)
+		hash = hash*33 + *(byte *)name++;
+	return hash;
+}
+
+/*
+============
+PR_BuildHash
+
+Indexes count defs by name.  Only the first def with a given name goes in,
+so lookups find the same def the old linear scans did.
+============
+*/
+static void PR_BuildHash (prhash_t *hash, void *firstname, int stride, int count)
+{
+	int		i, size, slot;
+	char	*name;
+
+	for (size=16 ; size < count*2 ; size<<=1)
+		;
+	hash->slots = Hunk_AllocName (size*sizeof(int), "prhash");
+	hash->mask = size-1;
+	hash->names = firstname;
+	hash->stride = stride;
+
+	for (i=0 ; i<count ; i++)
 	{
-		def = &pr_fielddefs[i];
-		if (!strcmp(pr_strings + def->s_name,name) )
-			return def;
+		name = pr_strings + *(int *)(hash->names + i*stride);
+		for (slot = PR_HashName (name) & hash->mask ; hash->slots[slot] ; slot = (slot+1) & hash->mask)
+			if (!strcmp (pr_strings + *(int *)(hash->names + (hash->slots[slot]-1)*stride), name))
+				break;
+		if (!hash->slots[slot])
+			hash->slots[slot] = i+1;
 	}
-	return NULL;
+}
+
+/*
+============
+PR_HashFind
+
+Returns the index of the def, or -1
+============
+*/
+static int PR_HashFind (prhash_t *hash, char *name)
+{
+	int		slot, i;
+
+	if (!hash->slots)
+		return -1;
+
+	for (slot = PR_HashName (name) & hash->mask ; hash->slots[slot] ; slot = (slot+1) & hash->mask)
+	{
+		i = hash->slots[slot]-1;
+		if (!strcmp (pr_strings + *(int *)(hash->names + i*hash->stride), name))
+			return i;
+	}
+	return -1;
+}
+
+/*
+============
+ED_FindField
+============
+*/
+ddef_t *ED_FindField (char *name)
+{
+	int		i;
+
+	i = PR_HashFind (&pr_fieldhash, name);
+	return i < 0 ? NULL : &pr_fielddefs[i];
 }
 
 
@@ -205,16 +415,10 @@ ED_FindGlobal
 */
 ddef_t *ED_FindGlobal (char *name)
 {
-	ddef_t		*def;
-	int			i;
-	
-	for (i=0 ; i<progs->numglobaldefs ; i++)
-	{
-		def = &pr_globaldefs[i];
-		if (!strcmp(pr_strings + def->s_name,name) )
-			return def;
-	}
-	return NULL;
+	int		i;
+
+	i = PR_HashFind (&pr_globalhash, name);
+	return i < 0 ? NULL : &pr_globaldefs[i];
 }
 
 
@@ -225,44 +429,61 @@ ED_FindFunction
 */
 dfunction_t *ED_FindFunction (char *name)
 {
-	dfunction_t		*func;
-	int				i;
-	
-	for (i=0 ; i<progs->numfunctions ; i++)
-	{
-		func = &pr_functions[i];
-		if (!strcmp(pr_strings + func->s_name,name) )
-			return func;
-	}
-	return NULL;
+	int		i;
+
+	i = PR_HashFind (&pr_functionhash, name);
+	return i < 0 ? NULL : &pr_functions[i];
 }
 
 
-eval_t *GetEdictFieldValue(edict_t *ed, char *field)
-{
-	ddef_t			*def = NULL;
-	int				i;
-	static int		rep = 0;
+/*
+============
+ED_FindFieldOffset
 
-	for (i=0 ; i<GEFV_CACHESIZE ; i++)
-	{
-		if (!strcmp(field, gefvCache[i].field))
-		{
-			def = gefvCache[i].pcache;
-			goto Done;
-		}
-	}
+Byte offset of a field into entvars, 0 if progs doesn't have it
+============
+*/
+static int ED_FindFieldOffset (char *field)
+{
+	ddef_t	*def;
 
 	def = ED_FindField (field);
+	if (!def)
+		return 0;
+	return def->ofs*4;
+}
 
-	if (strlen(field) < MAX_FIELD_LEN)
-	{
-		gefvCache[rep].pcache = def;
-		strcpy (gefvCache[rep].field, field);
-		rep ^= 1;
-	}
+/*
+============
+ED_FindEdictFieldOffsets
+============
+*/
+static void ED_FindEdictFieldOffsets (void)
+{
+	eval_gravity = ED_FindFieldOffset ("gravity");
+	eval_items2 = ED_FindFieldOffset ("items2");
+	eval_ammo_shells1 = ED_FindFieldOffset ("ammo_shells1");
+	eval_ammo_nails1 = ED_FindFieldOffset ("ammo_nails1");
+	eval_ammo_lava_nails = ED_FindFieldOffset ("ammo_lava_nails");
+	eval_ammo_rockets1 = ED_FindFieldOffset ("ammo_rockets1");
+	eval_ammo_multi_rockets = ED_FindFieldOffset ("ammo_multi_rockets");
+	eval_ammo_cells1 = ED_FindFieldOffset ("ammo_cells1");
+	eval_ammo_plasma = ED_FindFieldOffset ("ammo_plasma");
+}
+
+
+/*
+============
+GetEdictFieldValue
 
-Done:
+For fields that aren't worth an eval_ offset; hot paths use GETEDICTFIELDVALUE
+============
+*/
+eval_t *GetEdictFieldValue(edict_t *ed, char *field)
+{
+	ddef_t	*def;
+
+	def = ED_FindField (field);
 	if (!def)
 		return NULL;
 
@@ -574,7 +795,8 @@ void ED_Count (void)
 {
 	int		i;
 	edict_t	*ent;
-	int		active, models, solid, step;
+	int		active, models, solid, step, reusable;
+	char	gauge[33];
 
 	active = models = solid = step = 0;
 	for (i=0 ; i<sv.num_edicts ; i++)
@@ -591,12 +813,30 @@ void ED_Count (void)
 			step++;
 	}
 
+	reusable = 0;
+	for (i = ed_requeue ? 0 : ed_freehead ; i ; i = ed_freenext[i])
+	{
+		ent = EDICT_NUM(i);
+		if (!ent->free || i >= sv.num_edicts)
+			continue;
+		if (ent->freetime >= 2 && sv.time - ent->freetime <= 0.5)
+			break;
+		reusable++;
+	}
+
 	Con_Printf ("num_edicts:%3i\n", sv.num_edicts);
 	Con_Printf ("active    :%3i\n", active);
 	Con_Printf ("view      :%3i\n", models);
 	Con_Printf ("touch     :%3i\n", solid);
 	Con_Printf ("step      :%3i\n", step);
 
+// how close the level is to running out: # in use, + free, . never used
+	for (i=0 ; i<32 ; i++)
+		gauge[i] = i < active*32/MAX_EDICTS ? '#' : i < sv.num_edicts*32/MAX_EDICTS ? '+' : '.';
+	gauge[32] = 0;
+	Con_Printf ("usage     :[%s] %i%% of %i\n", gauge, active*100/MAX_EDICTS, MAX_EDICTS);
+	Con_Printf ("free      :%3i queued, %i reusable now\n", ed_numqueued, reusable);
+
 }
 
 /*
@@ -808,6 +1048,89 @@ qboolean	ED_ParseEpair (void *base, ddef_t *key, char *s)
 	return true;
 }
 
+/*
+====================
+ED_ParseKey
+
+Reads the next key of an edict into keyname and its value into com_token,
+with the hacks for what QuakeEd writes applied.  Returns false at the
+closing brace.
+====================
+*/
+qboolean ED_ParseKey (char **data, char *keyname)
+{
+	qboolean	anglehack;
+	int			n;
+
+// parse key
+	*data = COM_Parse (*data);
+	if (com_token[0] == '}')
+		return false;
+	if (!*data)
+		Sys_Error ("ED_ParseEntity: EOF without closing brace");
+		
+// anglehack is to allow QuakeEd to write single scalar angles
+// and allow them to be turned into vectors. (FIXME...)
+	if (!strcmp(com_token, "angle"))
+	{
+		strcpy (com_token, "angles");
+		anglehack = true;
+	}
+	else
+		anglehack = false;
+
+// FIXME: change light to _light to get rid of this hack
+	if (!strcmp(com_token, "light"))
+		strcpy (com_token, "light_lev");	// hack for single light def
+
+	strcpy (keyname, com_token);
+
+	// another hack to fix heynames with trailing spaces
+	n = strlen(keyname);
+	while (n && keyname[n-1] == ' ')
+	{
+		keyname[n-1] = 0;
+		n--;
+	}
+
+// parse value	
+	*data = COM_Parse (*data);
+	if (!*data)
+		Sys_Error ("ED_ParseEntity: EOF without closing brace");
+
+	if (com_token[0] == '}')
+		Sys_Error ("ED_ParseEntity: closing brace without data");
+
+	if (anglehack)
+	{
+		char	temp[32];
+		strcpy (temp, com_token);
+		sprintf (com_token, "0 %s 0", temp);
+	}
+
+	return true;
+}
+
+/*
+====================
+ED_Parsed
+
+Called once the fields of a parsed edict are set, init false if there
+were none
+====================
+*/
+void ED_Parsed (edict_t *ent, qboolean init)
+{
+	if (!init)
+	{
+		ent->free = true;
+		ED_QueueFree (ent);
+	}
+	ED_FindUpdate (ent);
+	SV_ThinkChanged (ent);
+	SV_HotChanged (ent);
+}
+
 /*
 ====================
 ED_ParseEdict
@@ -820,10 +1143,8 @@ Used for initial level load and for savegames.
 char *ED_ParseEdict (char *data, edict_t *ent)
 {
 	ddef_t		*key;
-	qboolean	anglehack;
 	qboolean	init;
 	char		keyname[256];
-	int			n;
 
 	init = false;
 
@@ -832,47 +1153,8 @@ char *ED_ParseEdict (char *data, edict_t *ent)
 		memset (&ent->v, 0, progs->entityfields * 4);
 
 // go through all the dictionary pairs
-	while (1)
-	{	
-	// parse key
-		data = COM_Parse (data);
-		if (com_token[0] == '}')
-			break;
-		if (!data)
-			Sys_Error ("ED_ParseEntity: EOF without closing brace");
-		
-// anglehack is to allow QuakeEd to write single scalar angles
-// and allow them to be turned into vectors. (FIXME...)
-if (!strcmp(com_token, "angle"))
-{
-	strcpy (com_token, "angles");
-	anglehack = true;
-}
-else
-	anglehack = false;
-
-// FIXME: change light to _light to get rid of this hack
-if (!strcmp(com_token, "light"))
-	strcpy (com_token, "light_lev");	// hack for single light def
-
-		strcpy (keyname, com_token);
-
-		// another hack to fix heynames with trailing spaces
-		n = strlen(keyname);
-		while (n && keyname[n-1] == ' ')
-		{
-			keyname[n-1] = 0;
-			n--;
-		}
-
-	// parse value	
-		data = COM_Parse (data);
-		if (!data)
-			Sys_Error ("ED_ParseEntity: EOF without closing brace");
-
-		if (com_token[0] == '}')
-			Sys_Error ("ED_ParseEntity: closing brace without data");
-
+	while (ED_ParseKey (&data, keyname))
+	{
 		init = true;	
 
 // keynames with a leading underscore are used for utility comments,
@@ -887,19 +1169,11 @@ if (!strcmp(com_token, "light"))
 			continue;
 		}
 
-if (anglehack)
-{
-char	temp[32];
-strcpy (temp, com_token);
-sprintf (com_token, "0 %s 0", temp);
-}
-
 		if (!ED_ParseEpair ((void *)&ent->v, key, com_token))
 			Host_Error ("ED_ParseEdict: parse error");
 	}
 
-	if (!init)
-		ent->free = true;
+	ED_Parsed (ent, init);
 
 	return data;
 }
@@ -923,28 +1197,42 @@ to call ED_CallSpawnFunctions () to let the objects initialize themselves.
 void ED_LoadFromFile (char *data)
 {
 	edict_t		*ent;
-	int			inhibit;
+	int			inhibit, num;
 	dfunction_t	*func;
+	entlump_t	*lump;
 
 	ent = NULL;
 	inhibit = 0;
 	pr_global_struct->time = sv.time;
 
+	lump = ED_CompileLump (data);	// NULL to parse the text
+
 // parse ents
-	while (1)
+	for (num=0 ; ; num++)
 	{
+		if (lump)
+		{
+			if (num == ED_LumpEntities (lump))
+				break;
+		}
+		else
+		{
 // parse the opening brace
-		data = COM_Parse (data);
-		if (!data)
-			break;
-		if (com_token[0] != '{')
-			Sys_Error ("ED_LoadFromFile: found %s when expecting {",com_token);
+			data = COM_Parse (data);
+			if (!data)
+				break;
+			if (com_token[0] != '{')
+				Sys_Error ("ED_LoadFromFile: found %s when expecting {",com_token);
+		}
 
 		if (!ent)
 			ent = EDICT_NUM(0);
 		else
 			ent = ED_Alloc ();
-		data = ED_ParseEdict (data, ent);
+		if (lump)
+			ED_ParseCompiled (lump, num, ent);
+		else
+			data = ED_ParseEdict (data, ent);
 
 // remove things from different skill levels or deathmatch
 		if (deathmatch.value)
@@ -1004,10 +1292,6 @@ void PR_LoadProgs (void)
 {
 	int		i;
 
-// flush the non-C variable lookup cache
-	for (i=0 ; i<GEFV_CACHESIZE ; i++)
-		gefvCache[i].field[0] = 0;
-
 	CRC_Init (&pr_crc);
 
 	progs = (dprograms_t *)COM_LoadHunkFile ("progs.dat");
@@ -1075,6 +1359,16 @@ void PR_LoadProgs (void)
 
 	for (i=0 ; i<progs->numglobals ; i++)
 		((int *)pr_globals)[i] = LittleLong (((int *)pr_globals)[i]);
+
+	PR_BuildHash (&pr_fieldhash, &pr_fielddefs[0].s_name, sizeof(ddef_t), progs->numfielddefs);
+	PR_BuildHash (&pr_globalhash, &pr_globaldefs[0].s_name, sizeof(ddef_t), progs->numglobaldefs);
+	PR_BuildHash (&pr_functionhash, &pr_functions[0].s_name, sizeof(dfunction_t), progs->numfunctions);
+	ED_FindEdictFieldOffsets ();
+
+	PR_Predecode ();
+	PR_JitReset ();
+	PR_ProfileReset ();
+	PR_InitTempStrings ();
 }
 
 
@@ -1089,6 +1383,8 @@ void PR_Init (void)
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("profile_dump", PR_ProfileDump_f);
+	Cmd_AddCommand ("profile_reset", PR_ProfileReset_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
@@ -1100,6 +1396,13 @@ void PR_Init (void)
 	Cvar_RegisterVariable (&saved2);
 	Cvar_RegisterVariable (&saved3);
 	Cvar_RegisterVariable (&saved4);
+	Cvar_RegisterVariable (&pr_predecode);
+	Cvar_RegisterVariable (&pr_jit);
+	Cvar_RegisterVariable (&pr_jittest);
+	Cvar_RegisterVariable (&pr_callprofile);
+	Cvar_RegisterVariable (&pr_findindex);
+	Cvar_RegisterVariable (&pr_savebinary);
+	Cvar_RegisterVariable (&pr_entcache);
 }
 
 
@@ -0,0 +1,338 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_entcache.c -- entity lumps kept parsed between spawns
+
+/*
+ED_LoadFromFile used to tokenize the entity lump, look up every key and
+convert every value each time a map was spawned.  The first time a map
+is spawned its lump is now compiled into the words each edict gets, with
+the field offsets looked up and the values converted, and the result is
+kept.  Spawning the same map again with the same progs only copies the
+words into the edicts and the strings onto the hunk, then calls the
+spawn functions as before.
+
+Lumps are found by a CRC of the text and the progs CRC, and the text is
+compared to make sure.  pr_entcache is the number of maps kept; the one
+used longest ago is dropped to make room.  Compiling calls the same
+ED_ParseKey and ED_ParseEpair as ED_ParseEdict, so the edicts come out
+the same.  A lump with a value ED_ParseEpair can't take isn't compiled,
+and is parsed as text, which reports it.
+*/
+
+#include "quakedef.h"
+
+cvar_t	pr_entcache = {"pr_entcache", "8"};
+
+ddef_t *ED_FindField (char *name);
+
+typedef struct
+{
+	int		ofs;			// in ints
+	int		value;			// strings: offset in the lump's text
+	int		string;
+} entword_t;
+
+struct entlump_s
+{
+	struct entlump_s	*next;	// used more recently first
+	unsigned short	crc;
+	unsigned short	progscrc;
+	int			length;
+	char		*data;			// what was compiled
+	int			numents;
+	int			*firstword;		// numents+1 of them
+	byte		*init;			// false for an edict with no keys
+	entword_t	*words;
+	int			numwords;
+	char		*text;			// the strings, as ED_NewString made them
+	int			textsize;
+	string_t	textbase;		// where the text is on the hunk this spawn
+};
+
+static entlump_t	*entcache;
+
+/*
+============
+ED_FreeLump
+============
+*/
+static void ED_FreeLump (entlump_t *lump)
+{
+	free (lump->data);
+	free (lump->firstword);
+	free (lump->init);
+	free (lump->words);
+	free (lump->text);
+	free (lump);
+}
+
+/*
+============
+ED_LumpGrow
+
+realloc that gives up the game if it fails
+============
+*/
+static void *ED_LumpGrow (void *p, int size)
+{
+	p = realloc (p, size);
+	if (!p)
+		Sys_Error ("ED_CompileLump: out of memory");
+	return p;
+}
+
+/*
+============
+ED_AddWord
+============
+*/
+static void ED_AddWord (entlump_t *lump, int *maxwords, int ofs, int value, int string)
+{
+	entword_t	*w;
+
+	if (lump->numwords == *maxwords)
+	{
+		*maxwords = *maxwords ? *maxwords*2 : 1024;
+		lump->words = ED_LumpGrow (lump->words, *maxwords * sizeof(entword_t));
+	}
+	w = &lump->words[lump->numwords++];
+	w->ofs = ofs;
+	w->value = value;
+	w->string = string;
+}
+
+/*
+============
+ED_AddText
+============
+*/
+static int ED_AddText (entlump_t *lump, int *maxtext, char *s)
+{
+	int		l, ofs;
+
+	l = strlen (s) + 1;
+	while (lump->textsize + l > *maxtext)
+	{
+		*maxtext = *maxtext ? *maxtext*2 : 4096;
+		lump->text = ED_LumpGrow (lump->text, *maxtext);
+	}
+	ofs = lump->textsize;
+	memcpy (lump->text + ofs, s, l);
+	lump->textsize += l;
+	return ofs;
+}
+
+/*
+============
+ED_Compile
+
+Returns NULL if any value won't parse
+============
+*/
+static entlump_t *ED_Compile (char *data, int *block)
+{
+	entlump_t	*lump;
+	int			maxents, maxwords, maxtext;
+	int			i, size;
+	ddef_t		*key;
+	char		keyname[256];
+
+	lump = ED_LumpGrow (NULL, sizeof(*lump));
+	memset (lump, 0, sizeof(*lump));
+	maxents = maxwords = maxtext = 0;
+
+	while (1)
+	{
+		data = COM_Parse (data);
+		if (!data)
+			break;
+		if (com_token[0] != '{')
+			Sys_Error ("ED_LoadFromFile: found %s when expecting {",com_token);
+
+		if (lump->numents + 1 >= maxents)
+		{
+			maxents = maxents ? maxents*2 : 256;
+			lump->firstword = ED_LumpGrow (lump->firstword, (maxents+1) * sizeof(int));
+			lump->init = ED_LumpGrow (lump->init, maxents);
+		}
+		lump->firstword[lump->numents] = lump->numwords;
+		lump->init[lump->numents] = false;
+
+		while (ED_ParseKey (&data, keyname))
+		{
+			lump->init[lump->numents] = true;
+			if (keyname[0] == '_')
+				continue;
+
+			key = ED_FindField (keyname);
+			if (!key)
+			{
+				Con_Printf ("'%s' is not a field\n", keyname);
+				continue;
+			}
+
+			if (!ED_ParseEpair ((void *)block, key, com_token))
+			{
+				ED_FreeLump (lump);
+				return NULL;
+			}
+
+			if ((key->type & ~DEF_SAVEGLOBAL) == ev_string)
+			{
+				ED_AddWord (lump, &maxwords, key->ofs,
+					ED_AddText (lump, &maxtext, pr_strings + block[key->ofs]), true);
+				continue;
+			}
+			size = type_size[key->type & ~DEF_SAVEGLOBAL];
+			for (i=0 ; i<size ; i++)
+				ED_AddWord (lump, &maxwords, key->ofs + i, block[key->ofs + i], false);
+		}
+
+		lump->numents++;
+		lump->firstword[lump->numents] = lump->numwords;
+	}
+
+	if (!lump->numents)
+	{	// ED_LoadFromFile takes it from here
+		ED_FreeLump (lump);
+		return NULL;
+	}
+	return lump;
+}
+
+/*
+============
+ED_CompileLump
+
+The compiled form of an entity lump, compiling and keeping it if it
+hasn't been seen with these progs.  NULL if the text has to be parsed.
+============
+*/
+entlump_t *ED_CompileLump (char *data)
+{
+	entlump_t	*lump, **prev;
+	unsigned short	crc;
+	int			i, length, count, mark;
+	int			*block;
+
+	if (pr_entcache.value < 1)
+	{
+		while (entcache)
+		{
+			lump = entcache;
+			entcache = lump->next;
+			ED_FreeLump (lump);
+		}
+		return NULL;
+	}
+
+	length = strlen (data);
+	CRC_Init (&crc);
+	for (i=0 ; i<length ; i++)
+		CRC_ProcessByte (&crc, ((byte *)data)[i]);
+
+	for (prev = &entcache ; *prev ; prev = &(*prev)->next)
+	{
+		lump = *prev;
+		if (lump->crc != crc || lump->progscrc != pr_crc || lump->length != length
+		|| memcmp (lump->data, data, length))
+			continue;
+		*prev = lump->next;		// to the front
+		lump->next = entcache;
+		entcache = lump;
+		return lump;
+	}
+
+// the strings ED_ParseEpair puts on the hunk are copied out, so let them go
+	mark = Hunk_LowMark ();
+	block = ED_LumpGrow (NULL, progs->entityfields * 4);
+	lump = ED_Compile (data, block);
+	free (block);
+	Hunk_FreeToLowMark (mark);
+	if (!lump)
+		return NULL;
+
+	lump->crc = crc;
+	lump->progscrc = pr_crc;
+	lump->length = length;
+	lump->data = ED_LumpGrow (NULL, length + 1);
+	memcpy (lump->data, data, length + 1);
+	lump->next = entcache;
+	entcache = lump;
+
+// drop the ones used longest ago
+	for (count=1, prev = &entcache->next ; *prev ; )
+	{
+		if (++count <= pr_entcache.value)
+		{
+			prev = &(*prev)->next;
+			continue;
+		}
+		lump = *prev;
+		*prev = lump->next;
+		ED_FreeLump (lump);
+	}
+
+	Con_DPrintf ("Compiled %i entities, %i words\n", entcache->numents, entcache->numwords);
+	return entcache;
+}
+
+/*
+============
+ED_LumpEntities
+============
+*/
+int ED_LumpEntities (entlump_t *lump)
+{
+	return lump->numents;
+}
+
+/*
+============
+ED_ParseCompiled
+
+What ED_ParseEdict does for entity num of the lump
+============
+*/
+void ED_ParseCompiled (entlump_t *lump, int num, edict_t *ent)
+{
+	entword_t	*w, *end;
+	int			*v;
+	char		*text;
+
+	if (num == 0)
+	{	// one copy of all the strings for this spawn
+		text = Hunk_AllocName (lump->textsize + 1, "entlump");
+		if (lump->textsize)
+			memcpy (text, lump->text, lump->textsize);
+		lump->textbase = PR_SetString (text);
+	}
+
+	v = (int *)&ent->v;
+	if (ent != sv.edicts)	// the same hack as ED_ParseEdict
+		memset (v, 0, progs->entityfields * 4);
+
+	w = lump->words + lump->firstword[num];
+	end = lump->words + lump->firstword[num+1];
+	for ( ; w < end ; w++)
+		v[w->ofs] = w->string ? lump->textbase + w->value : w->value;
+
+	ED_Parsed (ent, lump->init[num]);
+}
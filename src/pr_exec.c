@@ -247,6 +247,8 @@ void PR_Profile_f (void)
 			best->profile = 0;
 		}
 	} while (best);
+
+	PR_ProfileReport ();
 }
 
 
@@ -321,6 +323,8 @@ int PR_EnterFunction (dfunction_t *f)
 	}
 
 	pr_xfunction = f;
+	if (pr_profiling)
+		PR_ProfileEnter (f);
 	return f->first_statement - 1;	// offset the s++
 }
 
@@ -336,6 +340,9 @@ int PR_LeaveFunction (void)
 	if (pr_depth <= 0)
 		Sys_Error ("prog stack underflow");
 
+	if (pr_profiling)
+		PR_ProfileLeave ();
+
 // restore locals from the stack
 	c = pr_xfunction->locals;
 	localstack_used -= c;
@@ -354,38 +361,22 @@ int PR_LeaveFunction (void)
 
 /*
 ====================
-PR_ExecuteProgram
+PR_ExecuteSlow
+
+The statement loop as it always was, run when pr_predecode is off or once
+a builtin has turned tracing on.  Continues after statement s, and returns
+the runaway count left once the stack is back to exitdepth.
 ====================
 */
-void PR_ExecuteProgram (func_t fnum)
+static int PR_ExecuteSlow (int s, int exitdepth, int runaway)
 {
 	eval_t	*a, *b, *c;
-	int			s;
 	dstatement_t	*st;
-	dfunction_t	*f, *newf;
-	int		runaway;
+	dfunction_t	*newf;
 	int		i;
 	edict_t	*ed;
-	int		exitdepth;
 	eval_t	*ptr;
 
-	if (!fnum || fnum >= progs->numfunctions)
-	{
-		if (pr_global_struct->self)
-			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
-		Host_Error ("PR_ExecuteProgram: NULL function");
-	}
-
-	f = &pr_functions[fnum];
-
-	runaway = 100000;
-	pr_trace = false;
-
-// make a stack frame
-	exitdepth = pr_depth;
-
-	s = PR_EnterFunction (f);
-
 while (1)
 {
 	s++;	// next statement
@@ -545,11 +536,15 @@ while (1)
 	case OP_STOREP_F:
 	case OP_STOREP_ENT:
 	case OP_STOREP_FLD:		// integers
-	case OP_STOREP_S:
 	case OP_STOREP_FNC:		// pointers
 		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
 		ptr->_int = a->_int;
 		break;
+	case OP_STOREP_S:
+		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+		ptr->_int = a->_int;
+		ED_StringStored (b->_int);
+		break;
 	case OP_STOREP_V:
 		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
 		ptr->vector[0] = a->vector[0];
@@ -565,6 +560,8 @@ while (1)
 		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
 			PR_RunError ("assignment to world entity");
 		c->_int = (pr_int_t)((byte *)((pr_int_t *)&ed->v + b->_int) - (byte *)sv.edicts);
+		if (SV_WATCHEDFIELD(b->_int))
+			SV_FieldChanged (ed);
 		break;
 		
 	case OP_LOAD_F:
@@ -634,7 +631,10 @@ while (1)
 			i = -newf->first_statement;
 			if (i >= pr_numbuiltins)
 				PR_RunError ("Bad builtin call number");
-			pr_builtins[i] ();
+			if (pr_profiling)
+				PR_ProfileBuiltin (newf, i);
+			else
+				pr_builtins[i] ();
 			break;
 		}
 
@@ -649,7 +649,7 @@ while (1)
 	
 		s = PR_LeaveFunction ();
 		if (pr_depth == exitdepth)
-			return;		// all done
+			return runaway;		// all done
 		break;
 		
 	case OP_STATE:
@@ -664,6 +664,7 @@ while (1)
 			ed->v.frame = a->_float;
 		}
 		ed->v.think = b->function;
+		SV_ThinkChanged (ed);
 		break;
 
 	default:
@@ -671,3 +672,838 @@ while (1)
 	}
 }
 }
+
+/*
+============================================================================
+
+PRE-DECODED EXECUTION
+
+PR_Predecode turns pr_statements into one prinstr_t per statement when the
+progs are loaded.  Operands become pointers into pr_globals, branches become
+pointers to their target, and a comparison feeding an IF/IFNOT or a load
+feeding a store is fused into one instruction in the first statement's
+slot.  The second statement keeps its own slot, so a branch into the middle
+of a pair still works.
+
+Results, runaway counting and the profile counts come out the same as the
+statement loop.  Profile counts are charged on calls and returns rather
+than per statement, and pr_xstatement is only stored where something can
+look at it: calls, returns and errors.
+
+============================================================================
+*/
+
+cvar_t	pr_predecode = {"pr_predecode", "1"};
+
+// fused instructions, after the progs opcodes
+enum
+{
+	PRI_BAD = OP_BITOR + 1,		// bad opcode, or a branch out of the progs
+
+	PRI_EQ_F_IF, PRI_EQ_F_IFNOT,
+	PRI_NE_F_IF, PRI_NE_F_IFNOT,
+	PRI_LE_IF, PRI_LE_IFNOT,
+	PRI_GE_IF, PRI_GE_IFNOT,
+	PRI_LT_IF, PRI_LT_IFNOT,
+	PRI_GT_IF, PRI_GT_IFNOT,
+	PRI_EQ_E_IF, PRI_EQ_E_IFNOT,
+	PRI_NE_E_IF, PRI_NE_E_IFNOT,
+	PRI_NOT_F_IF, PRI_NOT_F_IFNOT,
+	PRI_NOT_ENT_IF, PRI_NOT_ENT_IFNOT,
+	PRI_NOT_FNC_IF, PRI_NOT_FNC_IFNOT,
+
+	PRI_LOAD_STORE,				// LOAD_F/S/ENT/FLD/FNC into c, STORE c to d
+	PRI_LOAD_STORE_V,
+	PRI_ADDRESS_STOREP,			// ADDRESS into c, STOREP d to c
+	PRI_ADDRESS_STOREP_V,
+
+	PRI_NUMOPS
+};
+
+typedef struct prinstr_s
+{
+	int			op;
+	int			s;				// statement number
+	eval_t		*a, *b, *c;
+	eval_t		*d;				// second operand of a fused pair
+	struct prinstr_s	*jump;	// IF, IFNOT, GOTO and fused branches
+} prinstr_t;
+
+static prinstr_t	*pr_code;	// [numstatements + 1], the last is PRI_BAD
+
+/*
+====================
+PR_BranchTarget
+====================
+*/
+static prinstr_t *PR_BranchTarget (int s)
+{
+	if (s < 0 || s >= progs->numstatements)
+		return &pr_code[progs->numstatements];
+	return &pr_code[s];
+}
+
+/*
+====================
+PR_FuseBranch
+
+Comparison op followed by IF or IFNOT, 0 if there is no fused form
+====================
+*/
+static int PR_FuseBranch (int op, int branch)
+{
+	int		fused;
+
+	switch (op)
+	{
+	case OP_EQ_F:	fused = PRI_EQ_F_IF; break;
+	case OP_NE_F:	fused = PRI_NE_F_IF; break;
+	case OP_LE:		fused = PRI_LE_IF; break;
+	case OP_GE:		fused = PRI_GE_IF; break;
+	case OP_LT:		fused = PRI_LT_IF; break;
+	case OP_GT:		fused = PRI_GT_IF; break;
+	case OP_EQ_E:	fused = PRI_EQ_E_IF; break;
+	case OP_NE_E:	fused = PRI_NE_E_IF; break;
+	case OP_NOT_F:	fused = PRI_NOT_F_IF; break;
+	case OP_NOT_ENT:	fused = PRI_NOT_ENT_IF; break;
+	case OP_NOT_FNC:	fused = PRI_NOT_FNC_IF; break;
+	default:
+		return 0;
+	}
+
+	return branch == OP_IFNOT ? fused + 1 : fused;
+}
+
+/*
+====================
+PR_Predecode
+
+Called from PR_LoadProgs, after the statements have been byte swapped
+====================
+*/
+void PR_Predecode (void)
+{
+	int			i, numfused;
+	dstatement_t	*st, *next;
+	prinstr_t	*ins;
+
+	pr_code = Hunk_AllocName ((progs->numstatements + 1) * sizeof(prinstr_t), "prcode");
+
+	for (i=0, st=pr_statements, ins=pr_code ; i<progs->numstatements ; i++, st++, ins++)
+	{
+		ins->op = st->op <= OP_BITOR ? st->op : PRI_BAD;
+		ins->s = i;
+		ins->a = (eval_t *)&pr_globals[st->a];
+		ins->b = (eval_t *)&pr_globals[st->b];
+		ins->c = (eval_t *)&pr_globals[st->c];
+
+		if (st->op == OP_IF || st->op == OP_IFNOT)
+			ins->jump = PR_BranchTarget (i + st->b);
+		else if (st->op == OP_GOTO)
+			ins->jump = PR_BranchTarget (i + st->a);
+	}
+
+// running off the end, or branching outside the progs
+	ins->op = PRI_BAD;
+	ins->s = progs->numstatements - 1;
+
+	numfused = 0;
+	for (i=0, st=pr_statements, ins=pr_code ; i<progs->numstatements-1 ; i++, st++, ins++)
+	{
+		next = st + 1;
+
+		if ((next->op == OP_IF || next->op == OP_IFNOT) && next->a == st->c
+		&& PR_FuseBranch (st->op, next->op))
+		{
+			ins->op = PR_FuseBranch (st->op, next->op);
+			ins->jump = ins[1].jump;
+		}
+		else if (st->op >= OP_LOAD_F && st->op <= OP_LOAD_FNC && next->a == st->c
+		&& (st->op == OP_LOAD_V) == (next->op == OP_STORE_V)
+		&& next->op >= OP_STORE_F && next->op <= OP_STORE_FNC)
+		{
+			ins->op = st->op == OP_LOAD_V ? PRI_LOAD_STORE_V : PRI_LOAD_STORE;
+			ins->d = (eval_t *)&pr_globals[next->b];
+		}
+		else if (st->op == OP_ADDRESS && next->b == st->c
+		&& next->op >= OP_STOREP_F && next->op <= OP_STOREP_FNC
+		&& next->op != OP_STOREP_S)		// left alone for ED_StringStored
+		{
+			ins->op = next->op == OP_STOREP_V ? PRI_ADDRESS_STOREP_V : PRI_ADDRESS_STOREP;
+			ins->d = (eval_t *)&pr_globals[next->a];
+		}
+		else
+			continue;
+		numfused++;
+	}
+
+	Con_DPrintf ("%i of %i statements fused\n", numfused, progs->numstatements);
+}
+
+/*
+====================
+PR_FastRunaway
+
+A fused instruction takes two statements off the runaway count, so work
+out which of them ran it out.  The statement loop reports the statement
+before that one, which this loop doesn't keep.
+====================
+*/
+static void PR_FastRunaway (prinstr_t *ins, int runaway)
+{
+	pr_xstatement = ins->s + runaway - 1;
+	PR_RunError ("runaway loop error");
+}
+
+#if defined(__GNUC__) && !defined(PR_NO_COMPUTED_GOTO)
+#define	PR_COMPUTED_GOTO
+#endif
+
+#ifdef PR_COMPUTED_GOTO
+#define	CASE(op)		L_##op:
+#define	DISPATCH()		goto *pr_labels[ins->op]
+#else
+#define	CASE(op)		case op:
+#define	DISPATCH()		goto dispatch
+#endif
+
+// every instruction starts with its statement count
+#define	STEP(n)												\
+	if ((runaway -= (n)) <= 0)								\
+		PR_FastRunaway (ins, runaway + (n));				\
+	a = ins->a;												\
+	b = ins->b;												\
+	c = ins->c
+
+#define	NEXT(n)			ins += (n); DISPATCH()
+
+#define	PROFILE()											\
+	pr_xfunction->profile += profilemark - runaway;			\
+	profilemark = runaway
+
+#define	BRANCH(name, test)									\
+	CASE(PRI_##name##_IF)									\
+		STEP(2);											\
+		c->_float = test;									\
+		if (c->_float)										\
+			ins = ins->jump;								\
+		else												\
+			ins += 2;										\
+		DISPATCH();											\
+	CASE(PRI_##name##_IFNOT)								\
+		STEP(2);											\
+		c->_float = test;									\
+		if (!c->_float)										\
+			ins = ins->jump;								\
+		else												\
+			ins += 2;										\
+		DISPATCH();
+
+/*
+====================
+PR_ExecuteFast
+
+Continues after statement s, as PR_ExecuteSlow.  Drops to PR_ExecuteSlow
+if a builtin turns tracing on, and runs callees that have been compiled by
+the jit natively.
+====================
+*/
+static int PR_ExecuteFast (int s, int exitdepth, int runaway)
+{
+	prinstr_t	*ins;
+	eval_t	*a, *b, *c;
+	dfunction_t	*newf;
+	int		i;
+	edict_t	*ed;
+	eval_t	*ptr;
+	int		profilemark;
+	prjitfunc_t	code;
+
+#ifdef PR_COMPUTED_GOTO
+	static void *pr_labels[PRI_NUMOPS] =
+	{
+		[OP_DONE] = &&L_OP_DONE,
+		[OP_MUL_F] = &&L_OP_MUL_F,
+		[OP_MUL_V] = &&L_OP_MUL_V,
+		[OP_MUL_FV] = &&L_OP_MUL_FV,
+		[OP_MUL_VF] = &&L_OP_MUL_VF,
+		[OP_DIV_F] = &&L_OP_DIV_F,
+		[OP_ADD_F] = &&L_OP_ADD_F,
+		[OP_ADD_V] = &&L_OP_ADD_V,
+		[OP_SUB_F] = &&L_OP_SUB_F,
+		[OP_SUB_V] = &&L_OP_SUB_V,
+		[OP_EQ_F] = &&L_OP_EQ_F,
+		[OP_EQ_V] = &&L_OP_EQ_V,
+		[OP_EQ_S] = &&L_OP_EQ_S,
+		[OP_EQ_E] = &&L_OP_EQ_E,
+		[OP_EQ_FNC] = &&L_OP_EQ_FNC,
+		[OP_NE_F] = &&L_OP_NE_F,
+		[OP_NE_V] = &&L_OP_NE_V,
+		[OP_NE_S] = &&L_OP_NE_S,
+		[OP_NE_E] = &&L_OP_NE_E,
+		[OP_NE_FNC] = &&L_OP_NE_FNC,
+		[OP_LE] = &&L_OP_LE,
+		[OP_GE] = &&L_OP_GE,
+		[OP_LT] = &&L_OP_LT,
+		[OP_GT] = &&L_OP_GT,
+		[OP_LOAD_F] = &&L_OP_LOAD_F,
+		[OP_LOAD_V] = &&L_OP_LOAD_V,
+		[OP_LOAD_S] = &&L_OP_LOAD_S,
+		[OP_LOAD_ENT] = &&L_OP_LOAD_ENT,
+		[OP_LOAD_FLD] = &&L_OP_LOAD_FLD,
+		[OP_LOAD_FNC] = &&L_OP_LOAD_FNC,
+		[OP_ADDRESS] = &&L_OP_ADDRESS,
+		[OP_STORE_F] = &&L_OP_STORE_F,
+		[OP_STORE_V] = &&L_OP_STORE_V,
+		[OP_STORE_S] = &&L_OP_STORE_S,
+		[OP_STORE_ENT] = &&L_OP_STORE_ENT,
+		[OP_STORE_FLD] = &&L_OP_STORE_FLD,
+		[OP_STORE_FNC] = &&L_OP_STORE_FNC,
+		[OP_STOREP_F] = &&L_OP_STOREP_F,
+		[OP_STOREP_V] = &&L_OP_STOREP_V,
+		[OP_STOREP_S] = &&L_OP_STOREP_S,
+		[OP_STOREP_ENT] = &&L_OP_STOREP_ENT,
+		[OP_STOREP_FLD] = &&L_OP_STOREP_FLD,
+		[OP_STOREP_FNC] = &&L_OP_STOREP_FNC,
+		[OP_RETURN] = &&L_OP_RETURN,
+		[OP_NOT_F] = &&L_OP_NOT_F,
+		[OP_NOT_V] = &&L_OP_NOT_V,
+		[OP_NOT_S] = &&L_OP_NOT_S,
+		[OP_NOT_ENT] = &&L_OP_NOT_ENT,
+		[OP_NOT_FNC] = &&L_OP_NOT_FNC,
+		[OP_IF] = &&L_OP_IF,
+		[OP_IFNOT] = &&L_OP_IFNOT,
+		[OP_CALL0] = &&L_OP_CALL0,
+		[OP_CALL1] = &&L_OP_CALL1,
+		[OP_CALL2] = &&L_OP_CALL2,
+		[OP_CALL3] = &&L_OP_CALL3,
+		[OP_CALL4] = &&L_OP_CALL4,
+		[OP_CALL5] = &&L_OP_CALL5,
+		[OP_CALL6] = &&L_OP_CALL6,
+		[OP_CALL7] = &&L_OP_CALL7,
+		[OP_CALL8] = &&L_OP_CALL8,
+		[OP_STATE] = &&L_OP_STATE,
+		[OP_GOTO] = &&L_OP_GOTO,
+		[OP_AND] = &&L_OP_AND,
+		[OP_OR] = &&L_OP_OR,
+		[OP_BITAND] = &&L_OP_BITAND,
+		[OP_BITOR] = &&L_OP_BITOR,
+		[PRI_BAD] = &&L_PRI_BAD,
+		[PRI_EQ_F_IF] = &&L_PRI_EQ_F_IF,
+		[PRI_EQ_F_IFNOT] = &&L_PRI_EQ_F_IFNOT,
+		[PRI_NE_F_IF] = &&L_PRI_NE_F_IF,
+		[PRI_NE_F_IFNOT] = &&L_PRI_NE_F_IFNOT,
+		[PRI_LE_IF] = &&L_PRI_LE_IF,
+		[PRI_LE_IFNOT] = &&L_PRI_LE_IFNOT,
+		[PRI_GE_IF] = &&L_PRI_GE_IF,
+		[PRI_GE_IFNOT] = &&L_PRI_GE_IFNOT,
+		[PRI_LT_IF] = &&L_PRI_LT_IF,
+		[PRI_LT_IFNOT] = &&L_PRI_LT_IFNOT,
+		[PRI_GT_IF] = &&L_PRI_GT_IF,
+		[PRI_GT_IFNOT] = &&L_PRI_GT_IFNOT,
+		[PRI_EQ_E_IF] = &&L_PRI_EQ_E_IF,
+		[PRI_EQ_E_IFNOT] = &&L_PRI_EQ_E_IFNOT,
+		[PRI_NE_E_IF] = &&L_PRI_NE_E_IF,
+		[PRI_NE_E_IFNOT] = &&L_PRI_NE_E_IFNOT,
+		[PRI_NOT_F_IF] = &&L_PRI_NOT_F_IF,
+		[PRI_NOT_F_IFNOT] = &&L_PRI_NOT_F_IFNOT,
+		[PRI_NOT_ENT_IF] = &&L_PRI_NOT_ENT_IF,
+		[PRI_NOT_ENT_IFNOT] = &&L_PRI_NOT_ENT_IFNOT,
+		[PRI_NOT_FNC_IF] = &&L_PRI_NOT_FNC_IF,
+		[PRI_NOT_FNC_IFNOT] = &&L_PRI_NOT_FNC_IFNOT,
+		[PRI_LOAD_STORE] = &&L_PRI_LOAD_STORE,
+		[PRI_LOAD_STORE_V] = &&L_PRI_LOAD_STORE_V,
+		[PRI_ADDRESS_STOREP] = &&L_PRI_ADDRESS_STOREP,
+		[PRI_ADDRESS_STOREP_V] = &&L_PRI_ADDRESS_STOREP_V
+	};
+#endif
+
+	profilemark = runaway;
+	ins = &pr_code[s + 1];
+
+#ifdef PR_COMPUTED_GOTO
+	DISPATCH();
+	{
+#else
+dispatch:
+	switch (ins->op)
+	{
+#endif
+	CASE(OP_ADD_F)
+		STEP(1);
+		c->_float = a->_float + b->_float;
+		NEXT(1);
+	CASE(OP_ADD_V)
+		STEP(1);
+		c->vector[0] = a->vector[0] + b->vector[0];
+		c->vector[1] = a->vector[1] + b->vector[1];
+		c->vector[2] = a->vector[2] + b->vector[2];
+		NEXT(1);
+
+	CASE(OP_SUB_F)
+		STEP(1);
+		c->_float = a->_float - b->_float;
+		NEXT(1);
+	CASE(OP_SUB_V)
+		STEP(1);
+		c->vector[0] = a->vector[0] - b->vector[0];
+		c->vector[1] = a->vector[1] - b->vector[1];
+		c->vector[2] = a->vector[2] - b->vector[2];
+		NEXT(1);
+
+	CASE(OP_MUL_F)
+		STEP(1);
+		c->_float = a->_float * b->_float;
+		NEXT(1);
+	CASE(OP_MUL_V)
+		STEP(1);
+		c->_float = a->vector[0]*b->vector[0]
+				+ a->vector[1]*b->vector[1]
+				+ a->vector[2]*b->vector[2];
+		NEXT(1);
+	CASE(OP_MUL_FV)
+		STEP(1);
+		c->vector[0] = a->_float * b->vector[0];
+		c->vector[1] = a->_float * b->vector[1];
+		c->vector[2] = a->_float * b->vector[2];
+		NEXT(1);
+	CASE(OP_MUL_VF)
+		STEP(1);
+		c->vector[0] = b->_float * a->vector[0];
+		c->vector[1] = b->_float * a->vector[1];
+		c->vector[2] = b->_float * a->vector[2];
+		NEXT(1);
+
+	CASE(OP_DIV_F)
+		STEP(1);
+		c->_float = a->_float / b->_float;
+		NEXT(1);
+
+	CASE(OP_BITAND)
+		STEP(1);
+		c->_float = (int)a->_float & (int)b->_float;
+		NEXT(1);
+
+	CASE(OP_BITOR)
+		STEP(1);
+		c->_float = (int)a->_float | (int)b->_float;
+		NEXT(1);
+
+	CASE(OP_GE)
+		STEP(1);
+		c->_float = a->_float >= b->_float;
+		NEXT(1);
+	CASE(OP_LE)
+		STEP(1);
+		c->_float = a->_float <= b->_float;
+		NEXT(1);
+	CASE(OP_GT)
+		STEP(1);
+		c->_float = a->_float > b->_float;
+		NEXT(1);
+	CASE(OP_LT)
+		STEP(1);
+		c->_float = a->_float < b->_float;
+		NEXT(1);
+	CASE(OP_AND)
+		STEP(1);
+		c->_float = a->_float && b->_float;
+		NEXT(1);
+	CASE(OP_OR)
+		STEP(1);
+		c->_float = a->_float || b->_float;
+		NEXT(1);
+
+	CASE(OP_NOT_F)
+		STEP(1);
+		c->_float = !a->_float;
+		NEXT(1);
+	CASE(OP_NOT_V)
+		STEP(1);
+		c->_float = !a->vector[0] && !a->vector[1] && !a->vector[2];
+		NEXT(1);
+	CASE(OP_NOT_S)
+		STEP(1);
+		c->_float = !a->string || !pr_strings[a->string];
+		NEXT(1);
+	CASE(OP_NOT_FNC)
+		STEP(1);
+		c->_float = !a->function;
+		NEXT(1);
+	CASE(OP_NOT_ENT)
+		STEP(1);
+		c->_float = (PROG_TO_EDICT(a->edict) == sv.edicts);
+		NEXT(1);
+
+	CASE(OP_EQ_F)
+		STEP(1);
+		c->_float = a->_float == b->_float;
+		NEXT(1);
+	CASE(OP_EQ_V)
+		STEP(1);
+		c->_float = (a->vector[0] == b->vector[0]) &&
+					(a->vector[1] == b->vector[1]) &&
+					(a->vector[2] == b->vector[2]);
+		NEXT(1);
+	CASE(OP_EQ_S)
+		STEP(1);
+		c->_float = !strcmp(pr_strings+a->string,pr_strings+b->string);
+		NEXT(1);
+	CASE(OP_EQ_E)
+		STEP(1);
+		c->_float = a->_int == b->_int;
+		NEXT(1);
+	CASE(OP_EQ_FNC)
+		STEP(1);
+		c->_float = a->function == b->function;
+		NEXT(1);
+
+	CASE(OP_NE_F)
+		STEP(1);
+		c->_float = a->_float != b->_float;
+		NEXT(1);
+	CASE(OP_NE_V)
+		STEP(1);
+		c->_float = (a->vector[0] != b->vector[0]) ||
+					(a->vector[1] != b->vector[1]) ||
+					(a->vector[2] != b->vector[2]);
+		NEXT(1);
+	CASE(OP_NE_S)
+		STEP(1);
+		c->_float = strcmp(pr_strings+a->string,pr_strings+b->string);
+		NEXT(1);
+	CASE(OP_NE_E)
+		STEP(1);
+		c->_float = a->_int != b->_int;
+		NEXT(1);
+	CASE(OP_NE_FNC)
+		STEP(1);
+		c->_float = a->function != b->function;
+		NEXT(1);
+
+//==================
+	CASE(OP_STORE_F)
+	CASE(OP_STORE_ENT)
+	CASE(OP_STORE_FLD)		// integers
+	CASE(OP_STORE_S)
+	CASE(OP_STORE_FNC)		// pointers
+		STEP(1);
+		b->_int = a->_int;
+		NEXT(1);
+	CASE(OP_STORE_V)
+		STEP(1);
+		b->vector[0] = a->vector[0];
+		b->vector[1] = a->vector[1];
+		b->vector[2] = a->vector[2];
+		NEXT(1);
+
+	CASE(OP_STOREP_F)
+	CASE(OP_STOREP_ENT)
+	CASE(OP_STOREP_FLD)		// integers
+	CASE(OP_STOREP_FNC)		// pointers
+		STEP(1);
+		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+		ptr->_int = a->_int;
+		NEXT(1);
+	CASE(OP_STOREP_S)
+		STEP(1);
+		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+		ptr->_int = a->_int;
+		ED_StringStored (b->_int);
+		NEXT(1);
+	CASE(OP_STOREP_V)
+		STEP(1);
+		ptr = (eval_t *)((byte *)sv.edicts + b->_int);
+		ptr->vector[0] = a->vector[0];
+		ptr->vector[1] = a->vector[1];
+		ptr->vector[2] = a->vector[2];
+		NEXT(1);
+
+	CASE(OP_ADDRESS)
+		STEP(1);
+		ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = ins->s;
+			PR_RunError ("assignment to world entity");
+		}
+		c->_int = (pr_int_t)((byte *)((pr_int_t *)&ed->v + b->_int) - (byte *)sv.edicts);
+		if (SV_WATCHEDFIELD(b->_int))
+			SV_FieldChanged (ed);
+		NEXT(1);
+
+	CASE(OP_LOAD_F)
+	CASE(OP_LOAD_FLD)
+	CASE(OP_LOAD_ENT)
+	CASE(OP_LOAD_FNC)
+	CASE(OP_LOAD_S)
+		STEP(1);
+		ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((pr_int_t *)&ed->v + b->_int);
+		c->_int = a->_int;
+		NEXT(1);
+
+	CASE(OP_LOAD_V)
+		STEP(1);
+		ed = PROG_TO_EDICT(a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);		// make sure it's in range
+#endif
+		a = (eval_t *)((pr_int_t *)&ed->v + b->_int);
+		c->vector[0] = a->vector[0];
+		c->vector[1] = a->vector[1];
+		c->vector[2] = a->vector[2];
+		NEXT(1);
+
+//==================
+
+	CASE(OP_IFNOT)
+		STEP(1);
+		if (!a->_int)
+			ins = ins->jump;
+		else
+			ins++;
+		DISPATCH();
+
+	CASE(OP_IF)
+		STEP(1);
+		if (a->_int)
+			ins = ins->jump;
+		else
+			ins++;
+		DISPATCH();
+
+	CASE(OP_GOTO)
+		STEP(1);
+		ins = ins->jump;
+		DISPATCH();
+
+	CASE(OP_CALL0)
+	CASE(OP_CALL1)
+	CASE(OP_CALL2)
+	CASE(OP_CALL3)
+	CASE(OP_CALL4)
+	CASE(OP_CALL5)
+	CASE(OP_CALL6)
+	CASE(OP_CALL7)
+	CASE(OP_CALL8)
+		STEP(1);
+		pr_xstatement = ins->s;
+		pr_argc = ins->op - OP_CALL0;
+		if (!a->function)
+			PR_RunError ("NULL function");
+
+		newf = &pr_functions[a->function];
+
+		if (newf->first_statement < 0)
+		{	// negative statements are built in functions
+			i = -newf->first_statement;
+			if (i >= pr_numbuiltins)
+				PR_RunError ("Bad builtin call number");
+			if (pr_profiling)
+				PR_ProfileBuiltin (newf, i);
+			else
+				pr_builtins[i] ();
+			if (pr_trace)
+			{	// traceon
+				PROFILE();
+				return PR_ExecuteSlow (ins->s, exitdepth, runaway);
+			}
+			NEXT(1);
+		}
+
+		PROFILE();
+		s = PR_EnterFunction (newf);
+		if (pr_jit.value && (code = PR_JitFunction (newf)))
+		{
+			runaway = PR_JitRun (code, runaway);
+			profilemark = runaway;
+			NEXT(1);
+		}
+		ins = &pr_code[s + 1];
+		DISPATCH();
+
+	CASE(OP_DONE)
+	CASE(OP_RETURN)
+		STEP(1);
+		pr_xstatement = ins->s;
+		pr_globals[OFS_RETURN] = ((float *)a)[0];
+		pr_globals[OFS_RETURN+1] = ((float *)a)[1];
+		pr_globals[OFS_RETURN+2] = ((float *)a)[2];
+
+		PROFILE();
+		s = PR_LeaveFunction ();
+		if (pr_depth == exitdepth)
+			return runaway;		// all done
+		ins = &pr_code[s + 1];
+		DISPATCH();
+
+	CASE(OP_STATE)
+		STEP(1);
+		ed = PROG_TO_EDICT(pr_global_struct->self);
+#ifdef FPS_20
+		ed->v.nextthink = pr_global_struct->time + 0.05;
+#else
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+#endif
+		if (a->_float != ed->v.frame)
+		{
+			ed->v.frame = a->_float;
+		}
+		ed->v.think = b->function;
+		SV_ThinkChanged (ed);
+		NEXT(1);
+
+//==================
+
+	BRANCH(EQ_F, a->_float == b->_float)
+	BRANCH(NE_F, a->_float != b->_float)
+	BRANCH(LE, a->_float <= b->_float)
+	BRANCH(GE, a->_float >= b->_float)
+	BRANCH(LT, a->_float < b->_float)
+	BRANCH(GT, a->_float > b->_float)
+	BRANCH(EQ_E, a->_int == b->_int)
+	BRANCH(NE_E, a->_int != b->_int)
+	BRANCH(NOT_F, !a->_float)
+	BRANCH(NOT_ENT, PROG_TO_EDICT(a->edict) == sv.edicts)
+	BRANCH(NOT_FNC, !a->function)
+
+	CASE(PRI_LOAD_STORE)
+		STEP(2);
+		ed = PROG_TO_EDICT(a->edict);
+		a = (eval_t *)((pr_int_t *)&ed->v + b->_int);
+		c->_int = a->_int;
+		ins->d->_int = c->_int;
+		NEXT(2);
+
+	CASE(PRI_LOAD_STORE_V)
+		STEP(2);
+		ed = PROG_TO_EDICT(a->edict);
+		a = (eval_t *)((pr_int_t *)&ed->v + b->_int);
+		c->vector[0] = a->vector[0];
+		c->vector[1] = a->vector[1];
+		c->vector[2] = a->vector[2];
+		ins->d->vector[0] = c->vector[0];
+		ins->d->vector[1] = c->vector[1];
+		ins->d->vector[2] = c->vector[2];
+		NEXT(2);
+
+	CASE(PRI_ADDRESS_STOREP)
+		STEP(2);
+		ed = PROG_TO_EDICT(a->edict);
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = ins->s;
+			PR_RunError ("assignment to world entity");
+		}
+		c->_int = (pr_int_t)((byte *)((pr_int_t *)&ed->v + b->_int) - (byte *)sv.edicts);
+		if (SV_WATCHEDFIELD(b->_int))
+			SV_FieldChanged (ed);
+		ptr = (eval_t *)((byte *)sv.edicts + c->_int);
+		ptr->_int = ins->d->_int;
+		NEXT(2);
+
+	CASE(PRI_ADDRESS_STOREP_V)
+		STEP(2);
+		ed = PROG_TO_EDICT(a->edict);
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = ins->s;
+			PR_RunError ("assignment to world entity");
+		}
+		c->_int = (pr_int_t)((byte *)((pr_int_t *)&ed->v + b->_int) - (byte *)sv.edicts);
+		if (SV_WATCHEDFIELD(b->_int))
+			SV_FieldChanged (ed);
+		ptr = (eval_t *)((byte *)sv.edicts + c->_int);
+		ptr->vector[0] = ins->d->vector[0];
+		ptr->vector[1] = ins->d->vector[1];
+		ptr->vector[2] = ins->d->vector[2];
+		NEXT(2);
+
+	CASE(PRI_BAD)
+		pr_xstatement = ins->s;
+		if (ins == &pr_code[progs->numstatements])
+			PR_RunError ("branch out of the progs");
+		PR_RunError ("Bad opcode %i", pr_statements[ins->s].op);
+#ifndef PR_COMPUTED_GOTO
+	default:
+		PR_RunError ("Bad opcode %i", ins->op);
+#endif
+	}
+
+	return 0;	// PR_RunError doesn't return
+}
+
+#undef	CASE
+#undef	DISPATCH
+#undef	STEP
+#undef	NEXT
+#undef	PROFILE
+#undef	BRANCH
+
+/*
+====================
+PR_RunFunction
+
+Enters f and runs it until it returns, with whichever engine applies.
+Returns the runaway count left.
+====================
+*/
+int PR_RunFunction (dfunction_t *f, int runaway)
+{
+	int		s;
+	int		exitdepth;
+	prjitfunc_t	code;
+
+	exitdepth = pr_depth;
+	s = PR_EnterFunction (f);
+
+	if (pr_trace)
+		return PR_ExecuteSlow (s, exitdepth, runaway);
+	if (pr_jit.value && (code = PR_JitFunction (f)))
+		return PR_JitRun (code, runaway);
+	if (pr_predecode.value)
+		return PR_ExecuteFast (s, exitdepth, runaway);
+	return PR_ExecuteSlow (s, exitdepth, runaway);
+}
+
+/*
+====================
+PR_ExecuteProgram
+====================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	dfunction_t	*f;
+
+	if (!fnum || fnum >= progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
+		Host_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	f = &pr_functions[fnum];
+
+	if (!pr_depth)
+		PR_ProfileBegin ();
+
+	if (!pr_depth && pr_jit.value)
+	{
+		pr_jitsuspended = false;	// a Host_Error can leave it set
+		if (pr_jittest.value)
+		{
+			PR_JitTest (f);
+			return;
+		}
+	}
+
+	pr_trace = false;
+	PR_RunFunction (f, 100000);
+}
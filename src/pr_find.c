@@ -0,0 +1,301 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_find.c -- string index behind the find builtin
+
+/*
+classname, targetname and target are indexed by the hash of their text.
+Each hash bucket is a list of edict numbers in ascending order, so a find
+from some edict continues down the list from there, and a loop of finds
+walks each list once.  Matches are still checked with strcmp, the index
+only has to never leave an edict out.
+
+An edict is reindexed when it is cleared, parsed or freed.  The progs
+change string fields with OP_STOREP_S, which logs the edict here; the log
+is caught up with at the next find.  If it fills, or the edicts are
+overwritten wholesale, the index is rebuilt at the next find.
+*/
+
+#include "quakedef.h"
+
+#define	FIND_FIELDS		3
+#define	FIND_HASHSIZE	256			// power of two
+#define	FIND_LOGSIZE	64
+
+typedef struct
+{
+	int		field;					// entvars offset, in ints
+	int		head[FIND_HASHSIZE];	// edict numbers, 0 = empty
+	int		tail[FIND_HASHSIZE];
+	int		next[MAX_EDICTS];
+	int		prev[MAX_EDICTS];
+	int		bucket[MAX_EDICTS];		// -1 = not indexed
+} findindex_t;
+
+cvar_t	pr_findindex = {"pr_findindex", "1"};
+
+static findindex_t	ed_findindex[FIND_FIELDS];
+static qboolean	ed_findrebuild = true;
+static int		ed_findlog[FIND_LOGSIZE];	// edict numbers
+static int		ed_findlogged;
+
+/*
+============
+ED_FindHash
+============
+*/
+static int ED_FindHash (char *s)
+{
+	unsigned	hash;
+
+	hash = 0;
+	while (*s)
+		hash = hash*33 + *(byte *)s++;
+	return hash & (FIND_HASHSIZE-1);
+}
+
+/*
+============
+ED_FindUnlink
+============
+*/
+static void ED_FindUnlink (findindex_t *idx, int e)
+{
+	int		b;
+
+	b = idx->bucket[e];
+	if (b < 0)
+		return;
+
+	if (idx->prev[e])
+		idx->next[idx->prev[e]] = idx->next[e];
+	else
+		idx->head[b] = idx->next[e];
+	if (idx->next[e])
+		idx->prev[idx->next[e]] = idx->prev[e];
+	else
+		idx->tail[b] = idx->prev[e];
+	idx->bucket[e] = -1;
+}
+
+/*
+============
+ED_FindLink
+
+Inserts e in number order, which is at the tail when the edicts are
+indexed in order
+============
+*/
+static void ED_FindLink (findindex_t *idx, int e, int b)
+{
+	int		after;
+
+	for (after = idx->tail[b] ; after > e ; after = idx->prev[after])
+		;
+
+	idx->prev[e] = after;
+	if (after)
+	{
+		idx->next[e] = idx->next[after];
+		idx->next[after] = e;
+	}
+	else
+	{
+		idx->next[e] = idx->head[b];
+		idx->head[b] = e;
+	}
+	if (idx->next[e])
+		idx->prev[idx->next[e]] = e;
+	else
+		idx->tail[b] = e;
+	idx->bucket[e] = b;
+}
+
+/*
+============
+ED_FindIndex
+============
+*/
+static void ED_FindIndex (int e)
+{
+	edict_t		*ed;
+	findindex_t	*idx;
+	int			i, b;
+
+	ed = EDICT_NUM(e);
+	for (i=0, idx=ed_findindex ; i<FIND_FIELDS ; i++, idx++)
+	{
+		if (ed->free)
+		{
+			ED_FindUnlink (idx, e);
+			continue;
+		}
+		b = ED_FindHash (E_STRING(ed, idx->field));
+		if (b == idx->bucket[e])
+			continue;
+		ED_FindUnlink (idx, e);
+		ED_FindLink (idx, e, b);
+	}
+}
+
+/*
+============
+ED_FindRebuild
+============
+*/
+static void ED_FindRebuild (void)
+{
+	findindex_t	*idx;
+	int			i, e;
+
+	ed_findindex[0].field = offsetof(entvars_t, classname) / 4;
+	ed_findindex[1].field = offsetof(entvars_t, targetname) / 4;
+	ed_findindex[2].field = offsetof(entvars_t, target) / 4;
+
+	for (i=0, idx=ed_findindex ; i<FIND_FIELDS ; i++, idx++)
+	{
+		memset (idx->head, 0, sizeof(idx->head));
+		memset (idx->tail, 0, sizeof(idx->tail));
+		memset (idx->bucket, 0xff, sizeof(idx->bucket));
+	}
+
+	for (e=1 ; e<sv.num_edicts ; e++)
+		ED_FindIndex (e);
+
+	ed_findrebuild = false;
+	ed_findlogged = 0;
+}
+
+/*
+============
+ED_FindReset
+
+The edicts have been overwritten, so rebuild the index before the next find
+============
+*/
+void ED_FindReset (void)
+{
+	ed_findrebuild = true;
+}
+
+/*
+============
+ED_FindUpdate
+
+Called when an edict has been cleared, parsed or freed
+============
+*/
+void ED_FindUpdate (edict_t *ed)
+{
+	int		e;
+
+	e = NUM_FOR_EDICT(ed);
+	if (!e || ed_findrebuild)
+		return;
+	ED_FindIndex (e);
+}
+
+/*
+============
+ED_StringStored
+
+OP_STOREP_S has written a string into an edict field, at ofs from sv.edicts
+============
+*/
+void ED_StringStored (int ofs)
+{
+	int		e, field;
+
+	if (ed_findrebuild)
+		return;
+
+	e = ofs / pr_edict_size;
+	field = (ofs - e*pr_edict_size - (int)offsetof(edict_t, v)) / 4;
+	if (field != ed_findindex[0].field && field != ed_findindex[1].field
+	&& field != ed_findindex[2].field)
+		return;
+	if (ed_findlogged && ed_findlog[ed_findlogged-1] == e)
+		return;
+
+	if (ed_findlogged == FIND_LOGSIZE)
+		ed_findrebuild = true;
+	else
+		ed_findlog[ed_findlogged++] = e;
+}
+
+/*
+============
+ED_FindField
+
+Returns the index for a field, or NULL if it isn't indexed
+============
+*/
+static findindex_t *ED_FindField (int field)
+{
+	int		i;
+
+	for (i=0 ; i<FIND_FIELDS ; i++)
+		if (ed_findindex[i].field == field)
+			return &ed_findindex[i];
+	return NULL;
+}
+
+/*
+============
+ED_FindString
+
+The first edict after start whose string field equals s, sv.edicts if there
+is none, or NULL if the field isn't indexed.
+============
+*/
+edict_t *ED_FindString (int start, int field, char *s)
+{
+	findindex_t	*idx;
+	edict_t		*ed;
+	int			i, e, b;
+
+	if (ed_findrebuild)
+		ED_FindRebuild ();
+	idx = ED_FindField (field);
+	if (!idx)
+		return NULL;
+
+	for (i=0 ; i<ed_findlogged ; i++)
+		if (ed_findlog[i] > 0 && ed_findlog[i] < sv.num_edicts)
+			ED_FindIndex (ed_findlog[i]);
+	ed_findlogged = 0;
+
+	b = ED_FindHash (s);
+	if (start > 0 && start < sv.num_edicts && idx->bucket[start] == b)
+		e = idx->next[start];
+	else
+		for (e = idx->head[b] ; e && e <= start ; e = idx->next[e])
+			;
+
+	for ( ; e && e < sv.num_edicts ; e = idx->next[e])
+	{
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		if (!strcmp (E_STRING(ed, field), s))
+			return ed;
+	}
+
+	return sv.edicts;
+}
@@ -0,0 +1,1279 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_jit.c -- x86-64 native code for hot progs functions
+
+/*
+A function is compiled the JIT_HOTCALLS'th time it is entered.  The code
+runs with the function already entered by PR_EnterFunction, and returns at
+its OP_RETURN/OP_DONE; the caller then does PR_LeaveFunction, so locals,
+parms and the progs stack are handled exactly as for the interpreter.
+
+Floats and vectors are scalar SSE on pr_globals, entity fields are
+addressed off sv.edicts.  Calls, string and vector comparisons and
+OP_STATE go back to C helpers.  The runaway count and the profile counts
+are charged a basic block at a time.  A function with a bad opcode or a
+branch outside the progs is left to the interpreter.
+
+The code memory is never writable and executable at once.  It is made
+writable from the start of the new function while it is compiled, and
+executable again before anything runs.  Code that is on the call stack
+below the compile only runs again after that.
+
+With pr_jittest, every call from the engine into the progs is run twice,
+interpreted and then compiled, from the same state, and the resulting
+globals and edicts are compared.
+*/
+
+#include "quakedef.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define	PR_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+cvar_t	pr_jit = {"pr_jit", "0"};
+cvar_t	pr_jittest = {"pr_jittest", "0"};
+
+qboolean	pr_jitsuspended;		// interpreting the first half of a pr_jittest call
+
+#define	JIT_HOTCALLS	16
+#define	JIT_CODESIZE	(8*1024*1024)
+#define	JIT_STATEMENTSIZE	192		// generous upper bound per statement
+#define	JIT_MAXFIXUPS	8192
+
+static prjitfunc_t	*pr_jitcode;	// [numfunctions]
+static int		*pr_jitcalls;		// [numfunctions], -1 = can't be compiled
+
+ddef_t *ED_GlobalAtOfs (int ofs);
+ddef_t *ED_FieldAtOfs (int ofs);
+
+#ifdef PR_JIT
+
+static byte		*jit_code;			// mapped once, reused for each progs
+static int		jit_used;
+static qboolean	jit_nomemory;
+
+static int		pr_jitrunaway;		// count of the running native function
+static int		*jit_statementofs;	// [numstatements], code offset, -1 = unreached
+static byte		*jit_leader;		// [numstatements], starts a basic block
+static byte		*jit_fieldconst;	// [numglobals], never stored to
+
+typedef struct
+{
+	int		pos;			// of the rel32
+	int		statement;
+} jitfixup_t;
+
+static jitfixup_t	jit_fixups[JIT_MAXFIXUPS];
+static int		jit_numfixups;
+
+/*
+==============================================================================
+
+CODE EMISSION
+
+Only what the compiler below needs.  All memory operands use a 32 bit
+displacement.
+
+==============================================================================
+*/
+
+enum {RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15};
+
+#define	XMM0	0
+#define	XMM1	1
+
+// condition codes for Jcc (0x0f 0x80+cc) and SETcc (0x0f 0x90+cc)
+#define	CC_P	0xa
+#define	CC_NP	0xb
+#define	CC_E	0x4
+#define	CC_NE	0x5
+#define	CC_AE	0x3
+#define	CC_A	0x7
+#define	CC_LE	0xe
+#define	CC_G	0xf
+
+// registers held across the function
+#define	REG_RUNAWAY		RBX		// &pr_jitrunaway
+#define	REG_GLOBALS		R12		// pr_globals
+#define	REG_EDICTS		R13		// sv.edicts
+
+static void J_Byte (int b)
+{
+	jit_code[jit_used++] = b;
+}
+
+static void J_Long (int l)
+{
+	memcpy (jit_code + jit_used, &l, 4);
+	jit_used += 4;
+}
+
+static void J_Quad (void *p)
+{
+	memcpy (jit_code + jit_used, &p, 8);
+	jit_used += 8;
+}
+
+/*
+============
+J_Mem
+
+prefix (0 = none), REX, opcode (0x0fxx for two bytes), then reg and the
+operand [base + index*scale + disp].  index < 0 for none, scale is the
+SIB shift.
+============
+*/
+static void J_Mem (int prefix, qboolean wide, int op, int reg, int base, int index, int scale, int disp)
+{
+	int		rex;
+
+	if (prefix)
+		J_Byte (prefix);
+
+	rex = 0x40;
+	if (wide)
+		rex |= 8;
+	if (reg & 8)
+		rex |= 4;
+	if (index >= 0 && (index & 8))
+		rex |= 2;
+	if (base & 8)
+		rex |= 1;
+	if (rex != 0x40)
+		J_Byte (rex);
+
+	if (op > 0xff)
+		J_Byte (op >> 8);
+	J_Byte (op & 0xff);
+
+	if (index < 0 && (base & 7) != RSP)
+		J_Byte (0x80 | (reg & 7) << 3 | (base & 7));
+	else
+	{
+		J_Byte (0x80 | (reg & 7) << 3 | RSP);
+		J_Byte (scale << 6 | (index < 0 ? RSP : index & 7) << 3 | (base & 7));
+	}
+	J_Long (disp);
+}
+
+// op reg, [pr_globals + ofs]
+static void J_Global (int prefix, qboolean wide, int op, int reg, int ofs)
+{
+	J_Mem (prefix, wide, op, reg, REG_GLOBALS, -1, 0, ofs*4);
+}
+
+#define	J_LoadInt(reg, ofs)		J_Global (0, false, 0x8b, reg, ofs)
+#define	J_StoreInt(reg, ofs)	J_Global (0, false, 0x89, reg, ofs)
+#define	J_LoadIndex(reg, ofs)	J_Global (0, true, 0x63, reg, ofs)		// movsxd
+#define	J_LoadFloat(xmm, ofs)	J_Global (0xf3, false, 0x0f10, xmm, ofs)
+#define	J_StoreFloat(xmm, ofs)	J_Global (0xf3, false, 0x0f11, xmm, ofs)
+#define	J_FloatOp(op, xmm, ofs)	J_Global (0xf3, false, op, xmm, ofs)
+
+#define	SSE_ADD		0x0f58
+#define	SSE_MUL		0x0f59
+#define	SSE_SUB		0x0f5c
+#define	SSE_DIV		0x0f5e
+
+// mov reg, imm64
+static void J_MovImm64 (int reg, void *p)
+{
+	J_Byte (0x48 | (reg >> 3));
+	J_Byte (0xb8 + (reg & 7));
+	J_Quad (p);
+}
+
+/*
+============
+J_CallHelper
+
+helper (statement number), then reload sv.edicts.  The prologue leaves
+the stack 16 byte aligned.
+============
+*/
+static void J_CallHelper (void (*helper) (int), int s)
+{
+	J_Byte (0xbf);				// mov edi, s
+	J_Long (s);
+	J_MovImm64 (RAX, (void *)helper);
+	J_Byte (0xff);				// call rax
+	J_Byte (0xd0);
+
+	J_MovImm64 (RAX, &sv.edicts);
+	J_Mem (0, true, 0x8b, REG_EDICTS, RAX, -1, 0, 0);
+}
+
+// jmp/jcc rel32 to statement s, patched once the function is laid out
+static void J_Branch (int cc, int s)
+{
+	if (cc < 0)
+		J_Byte (0xe9);
+	else
+	{
+		J_Byte (0x0f);
+		J_Byte (0x80 + cc);
+	}
+	jit_fixups[jit_numfixups].pos = jit_used;
+	jit_fixups[jit_numfixups].statement = s;
+	jit_numfixups++;
+	J_Long (0);
+}
+
+// setcc reg8 (al = 0, cl = 1, dl = 2)
+static void J_Set (int cc, int reg)
+{
+	J_Byte (0x0f);
+	J_Byte (0x90 + cc);
+	J_Byte (0xc0 + reg);
+}
+
+/*
+============
+J_StoreBool
+
+al (0 or 1) to a float 0 or 1 at ofs
+============
+*/
+static void J_StoreBool (int ofs)
+{
+	J_Byte (0x0f);				// movzx eax, al
+	J_Byte (0xb6);
+	J_Byte (0xc0);
+	J_Byte (0xf7);				// neg eax
+	J_Byte (0xd8);
+	J_Byte (0x25);				// and eax, 1.0f
+	J_Long (0x3f800000);
+	J_StoreInt (RAX, ofs);
+}
+
+// al = float at ofs compares equal, cc_e, or unequal to the float in xmm0
+static void J_FloatEqual (int ofs, qboolean equal)
+{
+	J_Global (0, false, 0x0f2e, XMM0, ofs);		// ucomiss xmm0, [ofs]
+	if (equal)
+	{
+		J_Set (CC_E, RAX);
+		J_Set (CC_NP, RCX);
+		J_Byte (0x20);			// and al, cl
+		J_Byte (0xc8);
+	}
+	else
+	{
+		J_Set (CC_NE, RAX);
+		J_Set (CC_P, RCX);
+		J_Byte (0x08);			// or al, cl
+		J_Byte (0xc8);
+	}
+}
+
+// al = float at ofs is not 0, as C truth
+static void J_FloatTrue (int ofs)
+{
+	J_Byte (0x0f);				// xorps xmm0, xmm0
+	J_Byte (0x57);
+	J_Byte (0xc0);
+	J_FloatEqual (ofs, false);
+}
+
+/*
+==============================================================================
+
+HELPERS
+
+Called from the native code with the statement number.
+
+==============================================================================
+*/
+
+static void PR_JitRunaway (int s)
+{
+	pr_xstatement = s;
+	PR_RunError ("runaway loop error");
+}
+
+static void PR_JitAddressWorld (int s)
+{
+	if (sv.state != ss_active)
+		return;
+	pr_xstatement = s;
+	PR_RunError ("assignment to world entity");
+}
+
+static void PR_JitStringStored (int s)
+{
+	ED_StringStored (((int *)pr_globals)[pr_statements[s].b]);
+}
+
+static void PR_JitAddressed (int s)
+{
+	dstatement_t	*st;
+
+	st = &pr_statements[s];
+	if (SV_WATCHEDFIELD(((int *)pr_globals)[st->b]))
+		SV_FieldChanged (PROG_TO_EDICT(((int *)pr_globals)[st->a]));
+}
+
+/*
+============
+PR_JitCall
+
+OP_CALL0-8, the same as the interpreter
+============
+*/
+static void PR_JitCall (int s)
+{
+	dstatement_t	*st;
+	dfunction_t	*newf;
+	eval_t		*a;
+	int			i;
+
+	st = &pr_statements[s];
+	a = (eval_t *)&pr_globals[st->a];
+
+	pr_xstatement = s;
+	pr_argc = st->op - OP_CALL0;
+	if (!a->function)
+		PR_RunError ("NULL function");
+
+	newf = &pr_functions[a->function];
+
+	if (newf->first_statement < 0)
+	{	// negative statements are built in functions
+		i = -newf->first_statement;
+		if (i >= pr_numbuiltins)
+			PR_RunError ("Bad builtin call number");
+		if (pr_profiling)
+			PR_ProfileBuiltin (newf, i);
+		else
+			pr_builtins[i] ();
+		return;
+	}
+
+	pr_jitrunaway = PR_RunFunction (newf, pr_jitrunaway);
+}
+
+/*
+============
+PR_JitOp
+
+The opcodes that aren't worth generating code for
+============
+*/
+static void PR_JitOp (int s)
+{
+	dstatement_t	*st;
+	eval_t		*a, *b, *c;
+	edict_t		*ed;
+
+	st = &pr_statements[s];
+	a = (eval_t *)&pr_globals[st->a];
+	b = (eval_t *)&pr_globals[st->b];
+	c = (eval_t *)&pr_globals[st->c];
+
+	switch (st->op)
+	{
+	case OP_NOT_V:
+		c->_float = !a->vector[0] && !a->vector[1] && !a->vector[2];
+		break;
+	case OP_NOT_S:
+		c->_float = !a->string || !pr_strings[a->string];
+		break;
+	case OP_EQ_V:
+		c->_float = (a->vector[0] == b->vector[0]) &&
+					(a->vector[1] == b->vector[1]) &&
+					(a->vector[2] == b->vector[2]);
+		break;
+	case OP_EQ_S:
+		c->_float = !strcmp(pr_strings+a->string,pr_strings+b->string);
+		break;
+	case OP_NE_V:
+		c->_float = (a->vector[0] != b->vector[0]) ||
+					(a->vector[1] != b->vector[1]) ||
+					(a->vector[2] != b->vector[2]);
+		break;
+	case OP_NE_S:
+		c->_float = strcmp(pr_strings+a->string,pr_strings+b->string);
+		break;
+	case OP_STATE:
+		ed = PROG_TO_EDICT(pr_global_struct->self);
+#ifdef FPS_20
+		ed->v.nextthink = pr_global_struct->time + 0.05;
+#else
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+#endif
+		if (a->_float != ed->v.frame)
+		{
+			ed->v.frame = a->_float;
+		}
+		ed->v.think = b->function;
+		SV_ThinkChanged (ed);
+		break;
+	default:
+		pr_xstatement = s;
+		PR_RunError ("Bad opcode %i", st->op);
+	}
+}
+
+/*
+==============================================================================
+
+COMPILER
+
+==============================================================================
+*/
+
+/*
+============
+PR_JitFindBody
+
+Marks the statements reachable from the start of f, and the basic block
+leaders among them.  False if anything reachable can't be compiled.
+============
+*/
+static qboolean PR_JitFindBody (dfunction_t *f, int *first, int *last)
+{
+	static int	*stack;
+	static int	stacksize;
+	int			sp, s, next;
+	dstatement_t	*st;
+
+	if (stacksize < progs->numstatements)
+	{
+		stacksize = progs->numstatements;
+		stack = realloc (stack, stacksize * sizeof(*stack));
+		if (!stack)
+			Sys_Error ("PR_JitFindBody: out of memory");
+	}
+
+	*first = *last = f->first_statement;
+	jit_leader[f->first_statement] = true;
+	jit_statementofs[f->first_statement] = 0;
+	stack[0] = f->first_statement;
+	sp = 1;
+
+	while (sp)
+	{
+		s = stack[--sp];
+		st = &pr_statements[s];
+
+		if (s < *first)
+			*first = s;
+		if (s > *last)
+			*last = s;
+		if (st->op > OP_BITOR)
+			return false;
+
+		next = s + 1;
+		switch (st->op)
+		{
+		case OP_DONE:
+		case OP_RETURN:
+			next = -1;
+			break;
+		case OP_GOTO:
+			next = s + st->a;
+			break;
+		case OP_IF:
+		case OP_IFNOT:
+			if (s + st->b < 0 || s + st->b >= progs->numstatements)
+				return false;
+			if (jit_statementofs[s + st->b] < 0)
+			{
+				jit_statementofs[s + st->b] = 0;
+				stack[sp++] = s + st->b;
+			}
+			jit_leader[s + st->b] = true;
+			if (s + 1 < progs->numstatements)
+				jit_leader[s + 1] = true;
+			break;
+		}
+
+		if (next < 0)
+		{
+			if (s + 1 < progs->numstatements)
+				jit_leader[s + 1] = true;
+			continue;
+		}
+		if (next >= progs->numstatements || next < 0)
+			return false;
+		if (st->op == OP_GOTO)
+		{
+			jit_leader[next] = true;
+			if (s + 1 < progs->numstatements)
+				jit_leader[s + 1] = true;
+		}
+		if (jit_statementofs[next] < 0)
+		{
+			jit_statementofs[next] = 0;
+			stack[sp++] = next;
+		}
+	}
+
+	return true;
+}
+
+/*
+============
+J_FieldAddress
+
+rax (+ rcx*4) + disp addresses field b of the entity in global a
+============
+*/
+static int J_FieldAddress (int a, int b, qboolean *indexed)
+{
+	J_LoadIndex (RAX, a);
+	J_Byte (0x4c);				// add rax, r13
+	J_Byte (0x01);
+	J_Byte (0xe8);
+
+	if (jit_fieldconst[b])
+	{
+		*indexed = false;
+		return (int)offsetof(edict_t, v) + ((int *)pr_globals)[b]*4;
+	}
+	J_LoadIndex (RCX, b);
+	*indexed = true;
+	return (int)offsetof(edict_t, v);
+}
+
+/*
+============
+PR_JitStatement
+============
+*/
+static void PR_JitStatement (dfunction_t *f, int s, int blocksize)
+{
+	dstatement_t	*st;
+	int			i, disp;
+	qboolean	indexed;
+
+	st = &pr_statements[s];
+
+	if (blocksize)
+	{	// runaway and profile, for the whole block
+		J_Mem (0, false, 0x81, 5, REG_RUNAWAY, -1, 0, 0);	// sub [rbx], n
+		J_Long (blocksize);
+		J_Byte (0x7f);			// jg over the call
+		J_Byte (5 + 10 + 2 + 10 + 7);
+		J_CallHelper (PR_JitRunaway, s);
+		J_MovImm64 (RAX, &f->profile);
+		J_Mem (0, false, 0x81, 0, RAX, -1, 0, 0);			// add [rax], n
+		J_Long (blocksize);
+	}
+
+	switch (st->op)
+	{
+	case OP_ADD_F:
+	case OP_SUB_F:
+	case OP_MUL_F:
+	case OP_DIV_F:
+		J_LoadFloat (XMM0, st->a);
+		J_FloatOp (st->op == OP_ADD_F ? SSE_ADD : st->op == OP_SUB_F ? SSE_SUB
+			: st->op == OP_MUL_F ? SSE_MUL : SSE_DIV, XMM0, st->b);
+		J_StoreFloat (XMM0, st->c);
+		break;
+
+	case OP_ADD_V:
+	case OP_SUB_V:
+		for (i=0 ; i<3 ; i++)
+		{
+			J_LoadFloat (XMM0, st->a + i);
+			J_FloatOp (st->op == OP_ADD_V ? SSE_ADD : SSE_SUB, XMM0, st->b + i);
+			J_StoreFloat (XMM0, st->c + i);
+		}
+		break;
+
+	case OP_MUL_V:
+		J_LoadFloat (XMM0, st->a);
+		J_FloatOp (SSE_MUL, XMM0, st->b);
+		for (i=1 ; i<3 ; i++)
+		{
+			J_LoadFloat (XMM1, st->a + i);
+			J_FloatOp (SSE_MUL, XMM1, st->b + i);
+			J_Byte (0xf3);		// addss xmm0, xmm1
+			J_Byte (0x0f);
+			J_Byte (0x58);
+			J_Byte (0xc1);
+		}
+		J_StoreFloat (XMM0, st->c);
+		break;
+
+	case OP_MUL_FV:
+	case OP_MUL_VF:
+		for (i=0 ; i<3 ; i++)
+		{
+			if (st->op == OP_MUL_FV)
+			{
+				J_LoadFloat (XMM0, st->a);
+				J_FloatOp (SSE_MUL, XMM0, st->b + i);
+			}
+			else
+			{
+				J_LoadFloat (XMM0, st->b);
+				J_FloatOp (SSE_MUL, XMM0, st->a + i);
+			}
+			J_StoreFloat (XMM0, st->c + i);
+		}
+		break;
+
+	case OP_BITAND:
+	case OP_BITOR:
+		J_Global (0xf3, false, 0x0f2c, RAX, st->a);		// cvttss2si eax
+		J_Global (0xf3, false, 0x0f2c, RCX, st->b);		// cvttss2si ecx
+		J_Byte (st->op == OP_BITAND ? 0x21 : 0x09);		// and/or eax, ecx
+		J_Byte (0xc8);
+		J_Byte (0xf3);			// cvtsi2ss xmm0, eax
+		J_Byte (0x0f);
+		J_Byte (0x2a);
+		J_Byte (0xc0);
+		J_StoreFloat (XMM0, st->c);
+		break;
+
+	case OP_GT:
+	case OP_GE:
+	case OP_LT:
+	case OP_LE:
+	// unordered sets CF and ZF, so seta/setae are false for a NaN
+		if (st->op == OP_GT || st->op == OP_GE)
+		{
+			J_LoadFloat (XMM0, st->a);
+			J_Global (0, false, 0x0f2e, XMM0, st->b);
+		}
+		else
+		{
+			J_LoadFloat (XMM0, st->b);
+			J_Global (0, false, 0x0f2e, XMM0, st->a);
+		}
+		J_Set (st->op == OP_GT || st->op == OP_LT ? CC_A : CC_AE, RAX);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_EQ_F:
+	case OP_NE_F:
+		J_LoadFloat (XMM0, st->a);
+		J_FloatEqual (st->b, st->op == OP_EQ_F);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_NOT_F:
+		J_FloatTrue (st->a);
+		J_Byte (0x34);			// xor al, 1
+		J_Byte (0x01);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_AND:
+	case OP_OR:
+		J_FloatTrue (st->a);
+		J_Byte (0x88);			// mov dl, al
+		J_Byte (0xc2);
+		J_FloatTrue (st->b);
+		J_Byte (st->op == OP_AND ? 0x20 : 0x08);		// and/or al, dl
+		J_Byte (0xd0);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_EQ_E:
+	case OP_EQ_FNC:
+	case OP_NE_E:
+	case OP_NE_FNC:
+		J_LoadInt (RAX, st->a);
+		J_Global (0, false, 0x3b, RAX, st->b);			// cmp eax, [b]
+		J_Set (st->op == OP_EQ_E || st->op == OP_EQ_FNC ? CC_E : CC_NE, RAX);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_NOT_ENT:		// the world is edict offset 0
+	case OP_NOT_FNC:
+		J_Global (0, false, 0x83, 7, st->a);			// cmp dword [a], 0
+		J_Byte (0);
+		J_Set (CC_E, RAX);
+		J_StoreBool (st->c);
+		break;
+
+	case OP_STORE_F:
+	case OP_STORE_ENT:
+	case OP_STORE_FLD:
+	case OP_STORE_S:
+	case OP_STORE_FNC:
+		J_LoadInt (RAX, st->a);
+		J_StoreInt (RAX, st->b);
+		break;
+	case OP_STORE_V:
+		for (i=0 ; i<3 ; i++)
+		{
+			J_LoadInt (RAX, st->a + i);
+			J_StoreInt (RAX, st->b + i);
+		}
+		break;
+
+	case OP_STOREP_F:
+	case OP_STOREP_ENT:
+	case OP_STOREP_FLD:
+	case OP_STOREP_S:
+	case OP_STOREP_FNC:
+	case OP_STOREP_V:
+		J_LoadIndex (RAX, st->b);
+		for (i=0 ; i < (st->op == OP_STOREP_V ? 3 : 1) ; i++)
+		{
+			J_LoadInt (RDX, st->a + i);
+			J_Mem (0, false, 0x89, RDX, REG_EDICTS, RAX, 0, i*4);
+		}
+		if (st->op == OP_STOREP_S)
+			J_CallHelper (PR_JitStringStored, s);
+		break;
+
+	case OP_ADDRESS:
+		J_Global (0, false, 0x83, 7, st->a);			// cmp dword [a], 0
+		J_Byte (0);
+		J_Byte (0x75);			// jne over the call
+		J_Byte (5 + 10 + 2 + 10 + 7);
+		J_CallHelper (PR_JitAddressWorld, s);
+		J_LoadInt (RAX, st->a);
+		if (jit_fieldconst[st->b])
+		{
+			J_Byte (0x05);		// add eax, imm32
+			J_Long ((int)offsetof(edict_t, v) + ((int *)pr_globals)[st->b]*4);
+		}
+		else
+		{
+			J_LoadInt (RCX, st->b);
+			J_Mem (0, false, 0x8d, RAX, RAX, RCX, 2, (int)offsetof(edict_t, v));	// lea
+		}
+		J_StoreInt (RAX, st->c);
+		if (!jit_fieldconst[st->b] || SV_WATCHEDFIELD(((int *)pr_globals)[st->b]))
+			J_CallHelper (PR_JitAddressed, s);
+		break;
+
+	case OP_LOAD_F:
+	case OP_LOAD_FLD:
+	case OP_LOAD_ENT:
+	case OP_LOAD_FNC:
+	case OP_LOAD_S:
+	case OP_LOAD_V:
+		disp = J_FieldAddress (st->a, st->b, &indexed);
+		for (i=0 ; i < (st->op == OP_LOAD_V ? 3 : 1) ; i++)
+		{
+			J_Mem (0, false, 0x8b, RDX, RAX, indexed ? RCX : -1, 2, disp + i*4);
+			J_StoreInt (RDX, st->c + i);
+		}
+		break;
+
+	case OP_IF:
+	case OP_IFNOT:
+		J_Global (0, false, 0x83, 7, st->a);			// cmp dword [a], 0
+		J_Byte (0);
+		J_Branch (st->op == OP_IF ? CC_NE : CC_E, s + st->b);
+		break;
+
+	case OP_GOTO:
+		J_Branch (-1, s + st->a);
+		break;
+
+	case OP_CALL0:
+	case OP_CALL1:
+	case OP_CALL2:
+	case OP_CALL3:
+	case OP_CALL4:
+	case OP_CALL5:
+	case OP_CALL6:
+	case OP_CALL7:
+	case OP_CALL8:
+		J_CallHelper (PR_JitCall, s);
+		break;
+
+	case OP_DONE:
+	case OP_RETURN:
+		for (i=0 ; i<3 ; i++)
+		{
+			J_LoadInt (RAX, st->a + i);
+			J_StoreInt (RAX, OFS_RETURN + i);
+		}
+		J_Byte (0x41);			// pop r14
+		J_Byte (0x5e);
+		J_Byte (0x41);			// pop r13
+		J_Byte (0x5d);
+		J_Byte (0x41);			// pop r12
+		J_Byte (0x5c);
+		J_Byte (0x5b);			// pop rbx
+		J_Byte (0x5d);			// pop rbp
+		J_Byte (0xc3);			// ret
+		break;
+
+	default:				// NOT_V, NOT_S, EQ_V, EQ_S, NE_V, NE_S, STATE
+		J_CallHelper (PR_JitOp, s);
+		break;
+	}
+}
+
+/*
+============
+PR_JitProtect
+
+Makes the code memory from ofs on writable or executable.  Code already
+compiled there can't run if it can't be made executable again.
+============
+*/
+static qboolean PR_JitProtect (int ofs, qboolean writable)
+{
+	int		page;
+
+	page = ofs & ~(sysconf (_SC_PAGESIZE) - 1);
+	if (!mprotect (jit_code + page, JIT_CODESIZE - page, writable ? PROT_READ|PROT_WRITE : PROT_READ|PROT_EXEC))
+		return true;
+
+	if (!writable)
+		Sys_Error ("pr_jit: couldn't make code memory executable");
+	Con_Printf ("pr_jit: couldn't make code memory writable\n");
+	jit_nomemory = true;
+	return false;
+}
+
+/*
+============
+PR_JitCompile
+============
+*/
+static prjitfunc_t PR_JitCompile (dfunction_t *f)
+{
+	int			s, first, last, start, count, blocksize, next;
+	jitfixup_t	*fix;
+	qboolean	ok;
+
+	if (!jit_code && !jit_nomemory)
+	{
+		jit_code = mmap (NULL, JIT_CODESIZE, PROT_READ,
+			MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if (jit_code == MAP_FAILED)
+		{
+			Con_Printf ("pr_jit: couldn't map code memory\n");
+			jit_code = NULL;
+			jit_nomemory = true;
+		}
+	}
+	if (!jit_code || jit_nomemory)
+		return NULL;
+
+	memset (jit_statementofs, 0xff, progs->numstatements * sizeof(int));
+	memset (jit_leader, 0, progs->numstatements);
+
+	ok = PR_JitFindBody (f, &first, &last);
+
+	count = 0;
+	for (s=first ; s<=last ; s++)
+		if (jit_statementofs[s] >= 0)
+			count++;
+	if (!ok || count >= JIT_MAXFIXUPS
+	|| jit_used + (count + 1) * JIT_STATEMENTSIZE > JIT_CODESIZE)
+		return NULL;
+
+	start = jit_used;
+	jit_numfixups = 0;
+	if (!PR_JitProtect (start, true))
+		return NULL;
+
+// prologue, leaves the stack 16 byte aligned
+	J_Byte (0x55);				// push rbp
+	J_Byte (0x53);				// push rbx
+	J_Byte (0x41);				// push r12
+	J_Byte (0x54);
+	J_Byte (0x41);				// push r13
+	J_Byte (0x55);
+	J_Byte (0x41);				// push r14
+	J_Byte (0x56);
+	J_MovImm64 (REG_RUNAWAY, &pr_jitrunaway);
+	J_MovImm64 (RAX, &pr_globals);
+	J_Mem (0, true, 0x8b, REG_GLOBALS, RAX, -1, 0, 0);
+	J_MovImm64 (RAX, &sv.edicts);
+	J_Mem (0, true, 0x8b, REG_EDICTS, RAX, -1, 0, 0);
+	J_Branch (-1, f->first_statement);
+
+	for (s=first ; s<=last ; s++)
+	{
+		if (jit_statementofs[s] < 0)
+			continue;
+		jit_statementofs[s] = jit_used;
+
+		blocksize = 0;
+		if (jit_leader[s])
+		{
+			for (next=s+1 ; next<=last && !jit_leader[next] ; next++)
+				;
+			blocksize = next - s;
+		}
+		PR_JitStatement (f, s, blocksize);
+	}
+
+	for (fix=jit_fixups ; fix<jit_fixups+jit_numfixups ; fix++)
+	{
+		s = jit_statementofs[fix->statement] - (fix->pos + 4);
+		memcpy (jit_code + fix->pos, &s, 4);
+	}
+
+	PR_JitProtect (start, false);
+
+	Con_DPrintf ("pr_jit: %s, %i statements, %i bytes\n",
+		pr_strings + f->s_name, count, jit_used - start);
+
+	return (prjitfunc_t)(jit_code + start);
+}
+
+#endif	// PR_JIT
+
+/*
+============
+PR_JitReset
+
+Called from PR_LoadProgs.  Code for the previous progs is thrown away.
+============
+*/
+void PR_JitReset (void)
+{
+#ifdef PR_JIT
+	dstatement_t	*st;
+	ddef_t		*def;
+	dfunction_t	*f;
+	int			i, j;
+#endif
+
+	pr_jitcode = Hunk_AllocName (progs->numfunctions * sizeof(prjitfunc_t), "prjit");
+	pr_jitcalls = Hunk_AllocName (progs->numfunctions * sizeof(int), "prjit");
+	pr_jitsuspended = false;
+
+#ifdef PR_JIT
+	jit_used = 0;
+	jit_statementofs = Hunk_AllocName (progs->numstatements * sizeof(int), "prjit");
+	jit_leader = Hunk_AllocName (progs->numstatements, "prjit");
+
+// a global holding a field offset can be compiled in as a constant if
+// nothing writes it: not a statement, not a builtin (they only write the
+// system globals), not a savegame, and not a function's locals
+	jit_fieldconst = Hunk_AllocName (progs->numglobals, "prjit");
+	for (i=sizeof(globalvars_t)/4 ; i<progs->numglobals ; i++)
+		jit_fieldconst[i] = true;
+
+	for (i=0, st=pr_statements ; i<progs->numstatements ; i++, st++)
+	{
+		if (st->op >= OP_STORE_F && st->op <= OP_STORE_FNC)
+			j = st->b;
+		else if ((st->op >= OP_STOREP_F && st->op <= OP_STOREP_FNC)
+		|| (st->op >= OP_IF && st->op <= OP_GOTO) || st->op == OP_RETURN || st->op == OP_DONE)
+			continue;
+		else
+			j = st->c;
+		if (j >= 0 && j < progs->numglobals)
+			jit_fieldconst[j] = false;
+	}
+
+	for (i=0, def=pr_globaldefs ; i<progs->numglobaldefs ; i++, def++)
+		if (def->type & DEF_SAVEGLOBAL)
+			for (j=0 ; j<type_size[def->type & ~DEF_SAVEGLOBAL] ; j++)
+				if (def->ofs + j < progs->numglobals)
+					jit_fieldconst[def->ofs + j] = false;
+
+	for (i=0, f=pr_functions ; i<progs->numfunctions ; i++, f++)
+		for (j=0 ; j<f->locals ; j++)
+			if (f->parm_start + j >= 0 && f->parm_start + j < progs->numglobals)
+				jit_fieldconst[f->parm_start + j] = false;
+#endif
+}
+
+/*
+============
+PR_JitFunction
+
+Native code for f, compiling it if it has got hot, or NULL to interpret it
+============
+*/
+prjitfunc_t PR_JitFunction (dfunction_t *f)
+{
+	int		i;
+
+	if (pr_jitsuspended)
+		return NULL;
+
+	i = f - pr_functions;
+	if (pr_jitcode[i])
+		return pr_jitcode[i];
+	if (pr_jitcalls[i] < 0)
+		return NULL;
+	if (++pr_jitcalls[i] < JIT_HOTCALLS && !pr_jittest.value)
+		return NULL;
+
+#ifdef PR_JIT
+	pr_jitcode[i] = PR_JitCompile (f);
+#endif
+	if (!pr_jitcode[i])
+		pr_jitcalls[i] = -1;
+	return pr_jitcode[i];
+}
+
+/*
+============
+PR_JitRun
+
+Runs a function that has been entered with PR_EnterFunction, and leaves
+it.  Returns the runaway count left.
+============
+*/
+int PR_JitRun (prjitfunc_t code, int runaway)
+{
+#ifdef PR_JIT
+	int		outer;
+
+	outer = pr_jitrunaway;		// a builtin can be running progs
+	pr_jitrunaway = runaway;
+	code ();
+	runaway = pr_jitrunaway;
+	pr_jitrunaway = outer;
+	PR_LeaveFunction ();
+#endif
+	return runaway;
+}
+
+/*
+==============================================================================
+
+DIFFERENTIAL TEST
+
+Builtins run in both passes.  Output to the message buffers from the
+interpreted pass is dropped, random() is reseeded to give both passes the
+same numbers, and entities that the interpreted pass moved in the area
+lists are put back.  The compiled pass is the one that is kept.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	int		datagram, reliable, signon;
+	int		message[MAX_SCOREBOARD];
+	int		num_edicts;
+	int		lastcheck;
+	double	lastchecktime;
+	qboolean	changelevel_issued;
+} jitstate_t;
+
+static byte		*jit_before, *jit_after;	// globals then edicts
+static int		jit_snapsize;
+
+static int		jit_tested, jit_failed;
+
+static void PR_JitSaveState (jitstate_t *state, byte *buf)
+{
+	int		i;
+
+	state->datagram = sv.datagram.cursize;
+	state->reliable = sv.reliable_datagram.cursize;
+	state->signon = sv.signon.cursize;
+	for (i=0 ; i<svs.maxclients ; i++)
+		state->message[i] = svs.clients[i].message.cursize;
+	state->num_edicts = sv.num_edicts;
+	state->lastcheck = sv.lastcheck;
+	state->lastchecktime = sv.lastchecktime;
+	state->changelevel_issued = svs.changelevel_issued;
+
+	memcpy (buf, pr_globals, progs->numglobals*4);
+	memcpy (buf + progs->numglobals*4, sv.edicts, sv.max_edicts*pr_edict_size);
+}
+
+/*
+============
+PR_JitRestoreState
+
+Everything but the area links is copied back.  An entity whose links the
+interpreted pass changed is unlinked, and relinked if it was linked before.
+============
+*/
+static void PR_JitRestoreState (jitstate_t *state, byte *buf)
+{
+	int		i, num, linkstart, linkend;
+	edict_t	*ed, *old;
+	qboolean	moved;
+
+	sv.datagram.cursize = state->datagram;
+	sv.reliable_datagram.cursize = state->reliable;
+	sv.signon.cursize = state->signon;
+	for (i=0 ; i<svs.maxclients ; i++)
+		svs.clients[i].message.cursize = state->message[i];
+	sv.lastcheck = state->lastcheck;
+	sv.lastchecktime = state->lastchecktime;
+	svs.changelevel_issued = state->changelevel_issued;
+
+	memcpy (pr_globals, buf, progs->numglobals*4);
+
+	linkstart = offsetof(edict_t, area);
+	linkend = linkstart + sizeof(link_t);
+	num = sv.num_edicts > state->num_edicts ? sv.num_edicts : state->num_edicts;
+	for (i=0 ; i<sv.max_edicts ; i++)
+	{
+		ed = EDICT_NUM(i);
+		old = (edict_t *)(buf + progs->numglobals*4 + i*pr_edict_size);
+
+		moved = i < num && (ed->free != old->free || ed->v.solid != old->v.solid
+			|| !ed->area.prev != !old->area.prev
+			|| !VectorCompare (ed->v.absmin, old->v.absmin)
+			|| !VectorCompare (ed->v.absmax, old->v.absmax));
+		if (moved)
+			SV_UnlinkEdict (ed);
+
+		memcpy (ed, old, linkstart);
+		memcpy ((byte *)ed + linkend, (byte *)old + linkend, pr_edict_size - linkend);
+
+		if (moved && old->area.prev)
+		{
+			SV_LinkEdict (ed, false);
+			memcpy ((byte *)ed + linkend, (byte *)old + linkend, pr_edict_size - linkend);
+		}
+	}
+	sv.num_edicts = state->num_edicts;
+	ED_Reindex ();
+}
+
+/*
+============
+PR_JitSame
+
+Two NaNs count as the same: which one an operation passes on depends on
+the order the C compiler put the operands of the interpreter's + and *.
+============
+*/
+static qboolean PR_JitSame (int a, int b)
+{
+	if (a == b)
+		return true;
+	return (a & 0x7f800000) == 0x7f800000 && (a & 0x7fffff)
+		&& (b & 0x7f800000) == 0x7f800000 && (b & 0x7fffff);
+}
+
+/*
+============
+PR_JitCompare
+============
+*/
+static qboolean PR_JitCompare (dfunction_t *f, byte *interpreted)
+{
+	int		i, j, num, reported;
+	int		*a, *b;
+	edict_t	*ed;
+	ddef_t	*def;
+	int		linkstart, linkend;
+
+	reported = 0;
+
+	a = (int *)interpreted;
+	b = (int *)pr_globals;
+	for (i=0 ; i<progs->numglobals && reported < 4 ; i++)
+	{
+		if (PR_JitSame (a[i], b[i]))
+			continue;
+		def = ED_GlobalAtOfs (i);
+		Con_Printf ("pr_jittest: %s: global %s (%i) is %08x, interpreted %08x\n",
+			pr_strings + f->s_name, def ? pr_strings + def->s_name : "?", i, b[i], a[i]);
+		reported++;
+	}
+
+	linkstart = offsetof(edict_t, area);
+	linkend = linkstart + sizeof(link_t);
+	num = sv.num_edicts;
+	for (i=0 ; i<num && reported < 4 ; i++)
+	{
+		ed = EDICT_NUM(i);
+		a = (int *)(interpreted + progs->numglobals*4 + i*pr_edict_size);
+		b = (int *)ed;
+		if (!memcmp (a, b, linkstart) && !memcmp ((byte *)a + linkend, (byte *)b + linkend,
+			offsetof(edict_t, v) - linkend))
+		{
+			a = (int *)((byte *)a + offsetof(edict_t, v));
+			b = (int *)&ed->v;
+			for (j=0 ; j<progs->entityfields ; j++)
+			{
+				if (PR_JitSame (a[j], b[j]))
+					continue;
+				def = ED_FieldAtOfs (j);
+				Con_Printf ("pr_jittest: %s: edict %i .%s is %08x, interpreted %08x\n",
+					pr_strings + f->s_name, i, def ? pr_strings + def->s_name : "?", b[j], a[j]);
+				reported++;
+				break;
+			}
+		}
+		else
+		{
+			Con_Printf ("pr_jittest: %s: edict %i header differs\n", pr_strings + f->s_name, i);
+			reported++;
+		}
+	}
+
+	return !reported;
+}
+
+/*
+============
+PR_JitTest
+
+Runs f interpreted, puts the state back, runs it again with the jit and
+compares.
+============
+*/
+void PR_JitTest (dfunction_t *f)
+{
+	jitstate_t	before, interpreted;
+	int			size, seed, num_edicts;
+
+	size = progs->numglobals*4 + sv.max_edicts*pr_edict_size;
+	if (size > jit_snapsize)
+	{
+		free (jit_before);
+		free (jit_after);
+		jit_before = malloc (size);
+		jit_after = malloc (size);
+		if (!jit_before || !jit_after)
+			Sys_Error ("PR_JitTest: out of memory");
+		jit_snapsize = size;
+	}
+
+	seed = rand ();
+	PR_JitSaveState (&before, jit_before);
+
+	srand (seed);
+	pr_jitsuspended = true;
+	pr_trace = false;
+	PR_RunFunction (f, 100000);
+	pr_jitsuspended = false;
+
+	PR_JitSaveState (&interpreted, jit_after);
+	num_edicts = sv.num_edicts;
+	PR_JitRestoreState (&before, jit_before);
+
+	srand (seed);
+	pr_trace = false;
+	PR_RunFunction (f, 100000);
+
+	jit_tested++;
+	if (num_edicts != sv.num_edicts)
+		Con_Printf ("pr_jittest: %s: %i edicts, interpreted %i\n",
+			pr_strings + f->s_name, sv.num_edicts, num_edicts);
+	if (!PR_JitCompare (f, jit_after) || num_edicts != sv.num_edicts)
+	{
+		jit_failed++;
+		Con_Printf ("pr_jittest: %i of %i calls differ\n", jit_failed, jit_tested);
+	}
+}
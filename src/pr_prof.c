@@ -0,0 +1,406 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_prof.c -- call graph profiler for the progs
+
+/*
+With pr_callprofile set, every progs function and builtin is timed from
+PR_EnterFunction to PR_LeaveFunction (or around the builtin call).  Times
+are kept per node of a call tree, a node being one call path down from the
+engine, so the same function called from two places is two nodes.
+
+"profile" adds the functions and builtins with the most time to its
+statement counts, and profile_dump writes the tree as folded stacks, one
+"caller;callee;... microseconds" line per node, for flamegraph.pl and the
+tools that read its input.
+
+The tree survives a map change as long as the same progs are loaded again.
+*/
+
+#include "quakedef.h"
+
+#define	PROF_MAXNODES	32768
+#define	PROF_HASHSIZE	8192		// power of two
+#define	PROF_DEPTH		128			// progs calls, builtins and the progs they run
+
+typedef struct
+{
+	int		parent;			// node, -1 for a call from the engine
+	int		function;		// pr_functions index
+	int		calls;
+	double	self;			// seconds, not counting callees
+	double	total;			// seconds, counting callees, but not recursive calls twice
+	int		hashnext;		// node + 1, 0 = end of chain
+} profnode_t;
+
+typedef struct
+{
+	int		node;
+	double	start;
+	double	children;		// seconds spent in callees so far
+	qboolean	outermost;	// not already further up the stack
+} profframe_t;
+
+cvar_t	pr_callprofile = {"pr_callprofile", "0"};
+
+qboolean	pr_profiling;		// pr_callprofile, latched at each call from the engine
+
+static profnode_t	prof_nodes[PROF_MAXNODES];	// node 0 collects whatever doesn't fit
+static int		prof_numnodes = 1;
+static int		prof_hash[PROF_HASHSIZE];		// node + 1, 0 = empty
+static int		prof_overflows;
+
+static profframe_t	prof_stack[PROF_DEPTH];
+static int		prof_depth;
+
+static unsigned short	prof_crc;
+static int		prof_numfunctions;
+
+/*
+============
+PR_ProfileClear
+============
+*/
+static void PR_ProfileClear (void)
+{
+	memset (prof_hash, 0, sizeof(prof_hash));
+	memset (&prof_nodes[0], 0, sizeof(prof_nodes[0]));
+	prof_nodes[0].parent = -1;
+	prof_numnodes = 1;
+	prof_overflows = 0;
+}
+
+/*
+============
+PR_ProfileReset
+
+Called when progs are loaded.  Keeps what has been gathered if they are the
+same progs as before.
+============
+*/
+void PR_ProfileReset (void)
+{
+	prof_depth = 0;
+	if (pr_crc == prof_crc && progs->numfunctions == prof_numfunctions)
+		return;
+
+	prof_crc = pr_crc;
+	prof_numfunctions = progs->numfunctions;
+	PR_ProfileClear ();
+}
+
+/*
+============
+PR_ProfileBegin
+
+Called for each call from the engine into the progs
+============
+*/
+void PR_ProfileBegin (void)
+{
+	prof_depth = 0;		// a Host_Error can leave frames behind
+	pr_profiling = pr_callprofile.value != 0;
+}
+
+/*
+============
+PR_ProfileNode
+============
+*/
+static int PR_ProfileNode (int parent, int function)
+{
+	int			hash, n;
+	profnode_t	*node;
+
+	hash = ((parent + 1) * 31 + function) & (PROF_HASHSIZE-1);
+	for (n = prof_hash[hash] ; n ; n = prof_nodes[n-1].hashnext)
+	{
+		node = &prof_nodes[n-1];
+		if (node->parent == parent && node->function == function)
+			return n-1;
+	}
+
+	if (prof_numnodes == PROF_MAXNODES)
+	{
+		prof_overflows++;
+		return 0;
+	}
+
+	n = prof_numnodes++;
+	node = &prof_nodes[n];
+	memset (node, 0, sizeof(*node));
+	node->parent = parent;
+	node->function = function;
+	node->hashnext = prof_hash[hash];
+	prof_hash[hash] = n + 1;
+	return n;
+}
+
+/*
+============
+PR_ProfileEnter
+============
+*/
+void PR_ProfileEnter (dfunction_t *f)
+{
+	profframe_t	*frame;
+	int			i, function;
+
+	if (prof_depth >= PROF_DEPTH)
+	{	// still counted, so the leaves pair up
+		prof_depth++;
+		return;
+	}
+
+	function = f - pr_functions;
+	frame = &prof_stack[prof_depth];
+	frame->node = PR_ProfileNode (prof_depth ? prof_stack[prof_depth-1].node : -1, function);
+	frame->outermost = true;
+	for (i=0 ; i<prof_depth ; i++)
+		if (prof_nodes[prof_stack[i].node].function == function)
+		{
+			frame->outermost = false;
+			break;
+		}
+	frame->children = 0;
+	prof_depth++;
+
+	frame->start = Sys_FloatTime ();
+}
+
+/*
+============
+PR_ProfileLeave
+============
+*/
+void PR_ProfileLeave (void)
+{
+	double		now, time;
+	profframe_t	*frame;
+	profnode_t	*node;
+
+	now = Sys_FloatTime ();
+
+	if (prof_depth <= 0)
+		return;
+	if (--prof_depth >= PROF_DEPTH)
+		return;
+
+	frame = &prof_stack[prof_depth];
+	time = now - frame->start;
+	node = &prof_nodes[frame->node];
+	node->calls++;
+	node->self += time - frame->children;
+	if (frame->outermost)
+		node->total += time;
+	if (prof_depth)
+		prof_stack[prof_depth-1].children += time;
+}
+
+/*
+============
+PR_ProfileBuiltin
+============
+*/
+void PR_ProfileBuiltin (dfunction_t *f, int num)
+{
+	PR_ProfileEnter (f);
+	pr_builtins[num] ();
+	PR_ProfileLeave ();
+}
+
+/*
+============
+PR_ProfileReport
+
+Top ten progs functions and builtins by their own time, for PR_Profile_f
+============
+*/
+typedef struct
+{
+	int		function;
+	int		calls;
+	double	self;
+	double	total;
+} proftotal_t;
+
+static int PR_ProfileCompare (const void *a, const void *b)
+{
+	double	sa, sb;
+
+	sa = ((proftotal_t *)a)->self;
+	sb = ((proftotal_t *)b)->self;
+	if (sa > sb)
+		return -1;
+	return sa < sb;
+}
+
+static void PR_ProfileTop (proftotal_t *totals, int count, char *title)
+{
+	int			i;
+	dfunction_t	*f;
+
+	qsort (totals, count, sizeof(*totals), PR_ProfileCompare);
+
+	Con_Printf ("%-8s   calls   self ms  total ms\n", title);
+	for (i=0 ; i<count && i<10 ; i++)
+	{
+		if (!totals[i].calls)
+			break;
+		f = &pr_functions[totals[i].function];
+		Con_Printf ("%8i %9.2f %9.2f %s", totals[i].calls, totals[i].self * 1000,
+			totals[i].total * 1000, pr_strings + f->s_name);
+		if (f->first_statement < 0)
+			Con_Printf (" #%i", -f->first_statement);
+		Con_Printf ("\n");
+	}
+}
+
+void PR_ProfileReport (void)
+{
+	proftotal_t	*functions, *builtins, *t;
+	profnode_t	*node;
+	int			i, numbuiltins;
+
+	if (prof_numnodes == 1)
+	{
+		if (!pr_callprofile.value)
+			Con_Printf ("set pr_callprofile 1 for times\n");
+		return;
+	}
+
+	functions = Hunk_TempAlloc ((progs->numfunctions + pr_numbuiltins) * sizeof(*functions));
+	builtins = functions + progs->numfunctions;
+	memset (functions, 0, (progs->numfunctions + pr_numbuiltins) * sizeof(*functions));
+
+	for (i=0 ; i<progs->numfunctions ; i++)
+		functions[i].function = i;
+	for (i=1, node = &prof_nodes[1] ; i<prof_numnodes ; i++, node++)
+	{
+		if (pr_functions[node->function].first_statement < 0)
+		{	// by builtin number, whichever name the progs gave it
+			t = &builtins[-pr_functions[node->function].first_statement];
+			t->function = node->function;
+		}
+		else
+			t = &functions[node->function];
+		t->calls += node->calls;
+		t->self += node->self;
+		t->total += node->total;
+	}
+
+	numbuiltins = 0;
+	for (i=0 ; i<pr_numbuiltins ; i++)
+		if (builtins[i].calls)
+			builtins[numbuiltins++] = builtins[i];
+
+	PR_ProfileTop (functions, progs->numfunctions, "function");
+	PR_ProfileTop (builtins, numbuiltins, "builtin");
+
+	if (prof_overflows)
+		Con_Printf ("%i calls past %i call paths not broken down\n", prof_overflows, PROF_MAXNODES);
+}
+
+/*
+============
+PR_ProfileDump_f
+
+profile_dump <file>
+============
+*/
+void PR_ProfileDump_f (void)
+{
+	char		name[MAX_OSPATH];
+	FILE		*f;
+	int			i, n, depth, lines;
+	int			path[PROF_DEPTH];
+	int			usec;
+	dfunction_t	*func;
+
+	if (Cmd_Argc () != 2)
+	{
+		Con_Printf ("profile_dump <file> : write the progs call profile as folded stacks\n");
+		return;
+	}
+
+	if (strstr (Cmd_Argv(1), ".."))
+	{
+		Con_Printf ("Relative pathnames are not allowed.\n");
+		return;
+	}
+
+	if (prof_numnodes == 1)
+	{
+		Con_Printf ("no calls profiled%s\n", pr_callprofile.value ? "" : ", set pr_callprofile 1");
+		return;
+	}
+
+	if (snprintf (name, sizeof(name), "%s/%s", com_gamedir, Cmd_Argv(1)) >= (int)sizeof(name))
+	{
+		Con_Printf ("Path name is too long.\n");
+		return;
+	}
+	f = fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("Couldn't open %s\n", name);
+		return;
+	}
+
+	lines = 0;
+	for (i=0 ; i<prof_numnodes ; i++)
+	{
+		usec = (int)(prof_nodes[i].self * 1000000 + 0.5);
+		if (usec <= 0)
+			continue;
+
+		depth = 0;
+		for (n = i ; n >= 0 && depth < PROF_DEPTH ; n = prof_nodes[n].parent)
+			path[depth++] = n;
+
+		while (depth--)
+		{
+			n = path[depth];
+			func = &pr_functions[prof_nodes[n].function];
+			if (!n)
+				fprintf (f, "[overflow]");
+			else if (func->first_statement < 0)
+				fprintf (f, "%s[builtin]", pr_strings + func->s_name);
+			else
+				fprintf (f, "%s", pr_strings + func->s_name);
+			if (depth)
+				fprintf (f, ";");
+		}
+		fprintf (f, " %i\n", usec);
+		lines++;
+	}
+	fclose (f);
+
+	Con_Printf ("Wrote %i call paths to %s\n", lines, name);
+}
+
+/*
+============
+PR_ProfileReset_f
+============
+*/
+void PR_ProfileReset_f (void)
+{
+	PR_ProfileClear ();
+}
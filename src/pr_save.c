@@ -0,0 +1,633 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_save.c -- binary snapshots of the globals and edicts for savegames
+
+/*
+ED_Write and ED_ParseEdict put every field through text and a field name
+lookup.  A snapshot instead has a table of the field and global defs it
+was written with, one table of the strings, function and field names the
+values refer to, and then each edict's fields as one raw block.
+
+Values that mean nothing outside this run are translated: strings,
+functions and field offsets become numbers in the name table, entities
+become edict numbers.  Everything else is kept bit for bit, so floats
+come back exactly, which the text format does not promise.
+
+When the defs in the file are the ones the progs have now, each block is
+read straight into the edict and translated where it lies.  Otherwise
+fields are matched by name and type, as the text loader does, and the
+ones that don't match are dropped.
+
+All ints are little endian.
+
+	int		SNAPSHOT_IDENT, SNAPSHOT_VERSION
+	int		numfielddefs, then type, ofs and name for each
+	int		numglobaldefs, the same
+	int		entityfields
+	int		numnames, then length and text for each
+	int		the saved globals, by the global defs
+	int		numedicts, then number, free and entityfields ints for each
+*/
+
+#include "quakedef.h"
+
+#define	SNAPSHOT_IDENT		(('P'<<24)+('N'<<16)+('S'<<8)+'Q')	// "QSNP"
+#define	SNAPSHOT_VERSION	1
+
+cvar_t	pr_savebinary = {"pr_savebinary", "0"};
+
+typedef struct
+{
+	int		type;				// ev_*, without DEF_SAVEGLOBAL
+	int		ofs;				// in ints
+	int		name;				// index into the snapshot names
+	int		localofs;			// where it goes now, -1 = dropped
+} snapdef_t;
+
+typedef struct
+{
+	int			numnames;
+	char		**names;		// writing: the text, reading: into text
+	char		*text;
+	int			*hash;			// writing: name + 1 chains, 0 = end
+	int			*hashnext;
+	int			maxnames;
+	string_t	*strings;		// reading: resolved as strings, 0 = not yet
+	int			*functions;		// and as functions, -1 = not yet
+	int			*fields;		// and as field offsets, -2 = not yet, -1 = none
+} snapnames_t;
+
+#define	SNAP_HASHSIZE	1024		// power of two
+
+ddef_t *ED_FieldAtOfs (int ofs);
+ddef_t *ED_FindField (char *name);
+ddef_t *ED_FindGlobal (char *name);
+dfunction_t *ED_FindFunction (char *name);
+
+/*
+============
+Snap_FieldTypes
+
+The type to decode each int of an edict as, from the current field defs
+============
+*/
+static void Snap_FieldTypes (int *types)
+{
+	int		i, type;
+	ddef_t	*def;
+
+	for (i=0 ; i<progs->entityfields ; i++)
+		types[i] = ev_void;
+	for (i=1, def=pr_fielddefs+1 ; i<progs->numfielddefs ; i++, def++)
+	{
+		type = def->type & ~DEF_SAVEGLOBAL;
+		if (type == ev_string || type == ev_entity || type == ev_function || type == ev_field)
+			if (types[def->ofs] == ev_void)
+				types[def->ofs] = type;
+	}
+}
+
+/*
+===============================================================================
+
+WRITING
+
+===============================================================================
+*/
+
+static void Snap_WriteInt (FILE *f, int i)
+{
+	i = LittleLong (i);
+	fwrite (&i, 4, 1, f);
+}
+
+static int Snap_Hash (char *s)
+{
+	unsigned	hash;
+
+	hash = 0;
+	while (*s)
+		hash = hash*33 + *(byte *)s++;
+	return hash & (SNAP_HASHSIZE-1);
+}
+
+/*
+============
+Snap_Name
+
+Index of s in the names, added if it isn't there yet
+============
+*/
+static int Snap_Name (snapnames_t *n, char *s)
+{
+	int		h, i;
+
+	h = Snap_Hash (s);
+	for (i = n->hash[h] ; i ; i = n->hashnext[i-1])
+		if (!strcmp (n->names[i-1], s))
+			return i-1;
+
+	if (n->numnames == n->maxnames)
+	{
+		n->maxnames = n->maxnames ? n->maxnames*2 : 256;
+		n->names = realloc (n->names, n->maxnames * sizeof(*n->names));
+		n->hashnext = realloc (n->hashnext, n->maxnames * sizeof(*n->hashnext));
+		if (!n->names || !n->hashnext)
+			Sys_Error ("Snap_Name: out of memory");
+	}
+	i = n->numnames++;
+	n->names[i] = s;
+	n->hashnext[i] = n->hash[h];
+	n->hash[h] = i+1;
+	return i;
+}
+
+/*
+============
+Snap_Encode
+
+The file value of a field or global of the given type, over v
+============
+*/
+static void Snap_Encode (snapnames_t *n, int type, int *v)
+{
+	ddef_t	*def;
+
+	switch (type)
+	{
+	case ev_string:
+		if (*v)
+			*v = Snap_Name (n, pr_strings + *v) + 1;
+		break;
+	case ev_entity:
+		*v = *v / pr_edict_size;
+		break;
+	case ev_function:
+		if (*v)
+			*v = Snap_Name (n, pr_strings + pr_functions[*v].s_name) + 1;
+		break;
+	case ev_field:
+		def = *v ? ED_FieldAtOfs (*v) : NULL;
+		*v = def ? Snap_Name (n, pr_strings + def->s_name) + 1 : 0;
+		break;
+	}
+}
+
+/*
+============
+Snap_SavedGlobal
+
+The globals the text format saves
+============
+*/
+static qboolean Snap_SavedGlobal (ddef_t *def)
+{
+	int		type;
+
+	if ( !(def->type & DEF_SAVEGLOBAL) )
+		return false;
+	type = def->type & ~DEF_SAVEGLOBAL;
+	return type == ev_string || type == ev_float || type == ev_entity;
+}
+
+/*
+============
+ED_WriteSnapshot
+
+Writes the saved globals if globals is set, and the edicts from first up,
+leaving out those with any of skipflags set
+============
+*/
+void ED_WriteSnapshot (FILE *f, qboolean globals, int first, int skipflags)
+{
+	snapnames_t	n;
+	int			*blocks, *numbers, *block, *gvalues;
+	int			*types, numblocks, blocksize;
+	int			i, j, e, numglobals;
+	ddef_t		*def;
+	edict_t		*ent;
+	int			hash[SNAP_HASHSIZE];
+
+	memset (&n, 0, sizeof(n));
+	memset (hash, 0, sizeof(hash));
+	n.hash = hash;
+
+// the defs, whose names go first in the names
+	for (i=0 ; i<progs->numfielddefs ; i++)
+		Snap_Name (&n, pr_strings + pr_fielddefs[i].s_name);
+	numglobals = 0;
+	if (globals)
+		for (i=0 ; i<progs->numglobaldefs ; i++)
+			if (Snap_SavedGlobal (&pr_globaldefs[i]))
+			{
+				Snap_Name (&n, pr_strings + pr_globaldefs[i].s_name);
+				numglobals++;
+			}
+
+// translate the edicts into one buffer, collecting the names they use
+	blocksize = progs->entityfields;
+	blocks = malloc ((sv.num_edicts+1) * blocksize * 4);
+	numbers = malloc ((sv.num_edicts+1) * sizeof(int));
+	types = malloc ((blocksize+1) * sizeof(int));
+	if (!blocks || !numbers || !types)
+		Sys_Error ("ED_WriteSnapshot: out of memory");
+	Snap_FieldTypes (types);
+
+	numblocks = 0;
+	for (e=first ; e<sv.num_edicts ; e++)
+	{
+		ent = EDICT_NUM(e);
+		if ((int)ent->v.flags & skipflags)
+			continue;
+		block = blocks + numblocks*blocksize;
+		numbers[numblocks++] = ent->free ? -1 - e : e;
+		if (ent->free)
+			continue;
+		memcpy (block, &ent->v, blocksize*4);
+		for (j=0 ; j<blocksize ; j++)
+			if (types[j] != ev_void)
+				Snap_Encode (&n, types[j], block + j);
+	}
+
+// and the globals
+	gvalues = malloc ((numglobals+1) * sizeof(int));
+	if (!gvalues)
+		Sys_Error ("ED_WriteSnapshot: out of memory");
+	for (i=0, j=0, def=pr_globaldefs ; i<progs->numglobaldefs && globals ; i++, def++)
+		if (Snap_SavedGlobal (def))
+		{
+			gvalues[j] = ((int *)pr_globals)[def->ofs];
+			Snap_Encode (&n, def->type & ~DEF_SAVEGLOBAL, &gvalues[j]);
+			j++;
+		}
+
+// header and defs
+	Snap_WriteInt (f, SNAPSHOT_IDENT);
+	Snap_WriteInt (f, SNAPSHOT_VERSION);
+
+	Snap_WriteInt (f, progs->numfielddefs);
+	for (i=0, def=pr_fielddefs ; i<progs->numfielddefs ; i++, def++)
+	{
+		Snap_WriteInt (f, def->type & ~DEF_SAVEGLOBAL);
+		Snap_WriteInt (f, def->ofs);
+		Snap_WriteInt (f, Snap_Name (&n, pr_strings + def->s_name));
+	}
+
+	Snap_WriteInt (f, numglobals);
+	for (i=0, def=pr_globaldefs ; i<progs->numglobaldefs && globals ; i++, def++)
+		if (Snap_SavedGlobal (def))
+		{
+			Snap_WriteInt (f, def->type & ~DEF_SAVEGLOBAL);
+			Snap_WriteInt (f, def->ofs);
+			Snap_WriteInt (f, Snap_Name (&n, pr_strings + def->s_name));
+		}
+
+	Snap_WriteInt (f, blocksize);
+
+	Snap_WriteInt (f, n.numnames);
+	for (i=0 ; i<n.numnames ; i++)
+	{
+		j = strlen (n.names[i]);
+		Snap_WriteInt (f, j);
+		fwrite (n.names[i], 1, j, f);
+	}
+
+	for (i=0 ; i<numglobals ; i++)
+		Snap_WriteInt (f, gvalues[i]);
+
+// and the edicts
+	Snap_WriteInt (f, numblocks);
+	for (i=0 ; i<numblocks ; i++)
+	{
+		Snap_WriteInt (f, numbers[i] < 0 ? -1 - numbers[i] : numbers[i]);
+		Snap_WriteInt (f, numbers[i] < 0);
+		if (numbers[i] < 0)
+			continue;
+		block = blocks + i*blocksize;
+		if (LittleLong (1) != 1)
+			for (j=0 ; j<blocksize ; j++)
+				block[j] = LittleLong (block[j]);
+		fwrite (block, 4, blocksize, f);
+	}
+
+	free (blocks);
+	free (numbers);
+	free (types);
+	free (gvalues);
+	free (n.names);
+	free (n.hashnext);
+}
+
+/*
+===============================================================================
+
+READING
+
+===============================================================================
+*/
+
+static qboolean	snap_short;		// ran out of file
+
+static int Snap_ReadInt (FILE *f)
+{
+	int		i;
+
+	if (fread (&i, 4, 1, f) != 1)
+	{
+		snap_short = true;
+		return 0;
+	}
+	return LittleLong (i);
+}
+
+/*
+============
+Snap_ReadDefs
+============
+*/
+static snapdef_t *Snap_ReadDefs (FILE *f, int *count)
+{
+	snapdef_t	*defs;
+	int			i;
+
+	*count = Snap_ReadInt (f);
+	if (*count < 0 || *count > 65536)
+	{
+		snap_short = true;
+		*count = 0;
+	}
+	defs = malloc ((*count+1) * sizeof(*defs));
+	if (!defs)
+		Sys_Error ("ED_ReadSnapshot: out of memory");
+	for (i=0 ; i<*count ; i++)
+	{
+		defs[i].type = Snap_ReadInt (f);
+		defs[i].ofs = Snap_ReadInt (f);
+		defs[i].name = Snap_ReadInt (f);
+		defs[i].localofs = -1;
+	}
+	return defs;
+}
+
+/*
+============
+Snap_Decode
+
+The value in this run of a file value of the given type, over v
+============
+*/
+static void Snap_Decode (snapnames_t *n, int type, int *v)
+{
+	int			i;
+	char		*s;
+	dfunction_t	*func;
+	ddef_t		*def;
+
+	switch (type)
+	{
+	case ev_string:
+	case ev_function:
+	case ev_field:
+		i = *v - 1;
+		if (i < 0 || i >= n->numnames)
+		{
+			*v = 0;
+			return;
+		}
+		break;
+	case ev_entity:
+		if (*v < 0 || *v >= sv.max_edicts)
+			*v = 0;
+		*v = EDICT_TO_PROG(EDICT_NUM(*v));
+		return;
+	default:
+		return;
+	}
+
+	switch (type)
+	{
+	case ev_string:
+		if (!n->strings[i])
+		{	// one copy for every edict that refers to it
+			s = Hunk_Alloc (strlen(n->names[i]) + 1);
+			strcpy (s, n->names[i]);
+			n->strings[i] = PR_SetString (s);
+		}
+		*v = n->strings[i];
+		break;
+	case ev_function:
+		if (n->functions[i] < 0)
+		{
+			func = ED_FindFunction (n->names[i]);
+			if (!func)
+				Con_Printf ("Can't find function %s\n", n->names[i]);
+			n->functions[i] = func ? func - pr_functions : 0;
+		}
+		*v = n->functions[i];
+		break;
+	case ev_field:
+		if (n->fields[i] == -2)
+		{
+			def = ED_FindField (n->names[i]);
+			if (!def)
+				Con_Printf ("Can't find field %s\n", n->names[i]);
+			n->fields[i] = def ? def->ofs : -1;
+		}
+		*v = n->fields[i] < 0 ? 0 : n->fields[i];
+		break;
+	}
+}
+
+/*
+============
+ED_ReadSnapshot
+
+Reads what ED_WriteSnapshot wrote, linking the edicts as they come if link
+is set.  Returns one more than the highest edict number read, or -1 if
+the snapshot is bad.
+============
+*/
+int ED_ReadSnapshot (FILE *f, qboolean link)
+{
+	snapnames_t	n;
+	snapdef_t	*fdefs, *gdefs, *d;
+	ddef_t		*def;
+	int			numfdefs, numgdefs, blocksize;
+	int			*offsets, *types, *block, *v;
+	int			i, j, k, e, len, textsize, numedicts, highest, value;
+	qboolean	direct;
+	edict_t		*ent;
+
+	snap_short = false;
+	if (Snap_ReadInt (f) != SNAPSHOT_IDENT || Snap_ReadInt (f) != SNAPSHOT_VERSION)
+	{
+		Con_Printf ("Not a version %i snapshot\n", SNAPSHOT_VERSION);
+		return -1;
+	}
+
+	fdefs = Snap_ReadDefs (f, &numfdefs);
+	gdefs = Snap_ReadDefs (f, &numgdefs);
+	blocksize = Snap_ReadInt (f);
+
+// the names, into one block of text
+	memset (&n, 0, sizeof(n));
+	n.numnames = Snap_ReadInt (f);
+	if (blocksize < 0 || blocksize > 65536 || n.numnames < 0 || n.numnames > 1<<20)
+		snap_short = true;
+	if (snap_short)
+		n.numnames = blocksize = 0;
+	offsets = malloc ((n.numnames+1) * sizeof(int));
+	textsize = 0;
+	for (i=0 ; i<n.numnames && !snap_short ; i++)
+	{
+		len = Snap_ReadInt (f);
+		if (len < 0 || len > 65536)
+		{
+			snap_short = true;
+			break;
+		}
+		n.text = realloc (n.text, textsize + len + 1);
+		if (!n.text)
+			Sys_Error ("ED_ReadSnapshot: out of memory");
+		if (len && fread (n.text + textsize, 1, len, f) != (size_t)len)
+			snap_short = true;
+		n.text[textsize + len] = 0;
+		offsets[i] = textsize;
+		textsize += len + 1;
+	}
+	if (snap_short)
+		n.numnames = 0;
+
+	n.names = malloc ((n.numnames+1) * sizeof(*n.names));
+	n.strings = malloc ((n.numnames+1) * sizeof(*n.strings));
+	n.functions = malloc ((n.numnames+1) * sizeof(*n.functions));
+	n.fields = malloc ((n.numnames+1) * sizeof(*n.fields));
+	types = malloc ((progs->entityfields+1) * sizeof(int));
+	block = malloc ((blocksize+1) * 4);
+	if (!offsets || !n.names || !n.strings || !n.functions || !n.fields || !types || !block)
+		Sys_Error ("ED_ReadSnapshot: out of memory");
+	for (i=0 ; i<n.numnames ; i++)
+	{
+		n.names[i] = n.text + offsets[i];
+		n.strings[i] = 0;
+		n.functions[i] = -1;
+		n.fields[i] = -2;
+	}
+
+// match the field defs to the progs by name
+	direct = blocksize == progs->entityfields && numfdefs == progs->numfielddefs;
+	for (i=0, d=fdefs ; i<numfdefs ; i++, d++)
+	{
+		if (d->name < 0 || d->name >= n.numnames || d->type < 0 || d->type >= 8
+		|| d->ofs < 0 || d->ofs + type_size[d->type] > blocksize)
+		{
+			direct = false;
+			continue;
+		}
+		def = ED_FindField (n.names[d->name]);
+		if (def && (def->type & ~DEF_SAVEGLOBAL) == d->type
+		&& def->ofs + type_size[d->type] <= progs->entityfields)
+			d->localofs = def->ofs;
+		if (!direct || d->localofs != d->ofs
+		|| (pr_fielddefs[i].type & ~DEF_SAVEGLOBAL) != d->type || pr_fielddefs[i].ofs != d->ofs)
+			direct = false;
+	}
+	Snap_FieldTypes (types);
+
+// the globals
+	for (i=0, d=gdefs ; i<numgdefs ; i++, d++)
+	{
+		value = Snap_ReadInt (f);
+		if (d->name < 0 || d->name >= n.numnames)
+			continue;
+		def = d->type >= 0 && d->type < 8 ? ED_FindGlobal (n.names[d->name]) : NULL;
+		if (!def || (def->type & ~DEF_SAVEGLOBAL) != d->type || type_size[d->type] != 1)
+		{
+			Con_Printf ("'%s' is not a global\n", n.names[d->name]);
+			continue;
+		}
+		Snap_Decode (&n, d->type, &value);
+		((int *)pr_globals)[def->ofs] = value;
+	}
+
+// the edicts
+	highest = -1;
+	numedicts = Snap_ReadInt (f);
+	for (i=0 ; i<numedicts && !snap_short ; i++)
+	{
+		e = Snap_ReadInt (f);
+		if (e < 0 || e >= sv.max_edicts)
+		{
+			snap_short = true;
+			break;
+		}
+		if (e > highest)
+			highest = e;
+
+		ent = EDICT_NUM(e);
+		memset (&ent->v, 0, progs->entityfields * 4);
+		ent->free = Snap_ReadInt (f) != 0;
+		if (ent->free)
+			continue;
+
+		v = (int *)&ent->v;
+		if (direct)
+		{	// straight into the edict
+			if (fread (v, 4, blocksize, f) != (size_t)blocksize)
+				snap_short = true;
+			if (LittleLong (1) != 1)
+				for (j=0 ; j<blocksize ; j++)
+					v[j] = LittleLong (v[j]);
+		}
+		else
+		{
+			if (fread (block, 4, blocksize, f) != (size_t)blocksize)
+				snap_short = true;
+			for (j=0, d=fdefs ; j<numfdefs ; j++, d++)
+				if (d->localofs >= 0)
+					for (k=0 ; k<type_size[d->type] ; k++)
+						v[d->localofs + k] = LittleLong (block[d->ofs + k]);
+		}
+		for (j=0 ; j<progs->entityfields ; j++)
+			if (types[j] != ev_void)
+				Snap_Decode (&n, types[j], v + j);
+
+		if (link)
+			SV_LinkEdict (ent, false);
+	}
+
+	free (fdefs);
+	free (gdefs);
+	free (offsets);
+	free (types);
+	free (block);
+	free (n.text);
+	free (n.names);
+	free (n.strings);
+	free (n.functions);
+	free (n.fields);
+
+	if (snap_short)
+	{
+		Con_Printf ("Snapshot is cut short\n");
+		return -1;
+	}
+	return highest + 1;
+}
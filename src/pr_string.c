@@ -0,0 +1,214 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// pr_string.c -- temporary strings for the builtins
+
+/*
+ftos, vtos and etos used to put every result on the hunk for the rest of
+the level.  Their results now go in a pool of fixed size slots, allocated
+on the hunk with the progs so the offsets from pr_strings stay small.  The
+same text always gets the same slot, so a score printed every frame only
+ever takes one.
+
+Once a server frame, when the pool is over half full, the slots nothing
+refers to any more are freed.  With the progs back in the engine, a string
+can only be kept in a string global, a string field of an edict, or as a
+precache or lightstyle name, so those are all that is checked.  If the
+pool fills up within a frame, strings go on the hunk as before.
+*/
+
+#include "quakedef.h"
+
+#define	PR_TEMPSTRINGS		512
+#define	PR_TEMPSTRINGSIZE	128			// the size of pr_string_temp
+#define	PR_TEMPHASHSIZE		256			// power of two
+
+static char		(*pr_tempstrings)[PR_TEMPSTRINGSIZE];
+static int		pr_temphash[PR_TEMPHASHSIZE];	// slot + 1, 0 = empty
+static int		pr_temphashnext[PR_TEMPSTRINGS];
+static qboolean	pr_tempused[PR_TEMPSTRINGS];
+static int		pr_tempfree[PR_TEMPSTRINGS];	// stack of free slots
+static int		pr_numtempfree;
+static qboolean	pr_tempoverflowed;
+
+static int		*pr_stringglobals;		// offsets of the string globals
+static int		pr_numstringglobals;
+static int		*pr_stringfields;		// and of the string fields
+static int		pr_numstringfields;
+
+/*
+============
+PR_TempHash
+============
+*/
+static int PR_TempHash (char *s)
+{
+	unsigned	hash;
+
+	hash = 0;
+	while (*s)
+		hash = hash*33 + *(byte *)s++;
+	return hash & (PR_TEMPHASHSIZE-1);
+}
+
+/*
+============
+PR_RehashTempStrings
+
+Rebuilds the hash chains and the free stack from pr_tempused
+============
+*/
+static void PR_RehashTempStrings (void)
+{
+	int		i, h;
+
+	memset (pr_temphash, 0, sizeof(pr_temphash));
+	pr_numtempfree = 0;
+	for (i=PR_TEMPSTRINGS-1 ; i>=0 ; i--)
+	{
+		if (!pr_tempused[i])
+		{
+			pr_tempfree[pr_numtempfree++] = i;
+			continue;
+		}
+		h = PR_TempHash (pr_tempstrings[i]);
+		pr_temphashnext[i] = pr_temphash[h];
+		pr_temphash[h] = i + 1;
+	}
+}
+
+/*
+============
+PR_InitTempStrings
+
+Called when progs are loaded
+============
+*/
+void PR_InitTempStrings (void)
+{
+	ddef_t	*def;
+	int		i;
+
+	pr_tempstrings = Hunk_AllocName (PR_TEMPSTRINGS*PR_TEMPSTRINGSIZE, "prtemp");
+	memset (pr_tempused, 0, sizeof(pr_tempused));
+	PR_RehashTempStrings ();
+	pr_tempoverflowed = false;
+
+	pr_stringglobals = Hunk_AllocName (progs->numglobaldefs*sizeof(int), "prtemp");
+	pr_numstringglobals = 0;
+	for (i=0, def=pr_globaldefs ; i<progs->numglobaldefs ; i++, def++)
+		if ((def->type & ~DEF_SAVEGLOBAL) == ev_string)
+			pr_stringglobals[pr_numstringglobals++] = def->ofs;
+
+	pr_stringfields = Hunk_AllocName (progs->numfielddefs*sizeof(int), "prtemp");
+	pr_numstringfields = 0;
+	for (i=0, def=pr_fielddefs ; i<progs->numfielddefs ; i++, def++)
+		if ((def->type & ~DEF_SAVEGLOBAL) == ev_string)
+			pr_stringfields[pr_numstringfields++] = def->ofs;
+}
+
+/*
+============
+PR_TempString
+
+Returns a copy of s that lasts until nothing refers to it
+============
+*/
+char *PR_TempString (char *s)
+{
+	int		h, n;
+
+	h = PR_TempHash (s);
+	for (n = pr_temphash[h] ; n ; n = pr_temphashnext[n-1])
+		if (!strcmp (pr_tempstrings[n-1], s))
+			return pr_tempstrings[n-1];
+
+	if (!pr_numtempfree || strlen(s) >= PR_TEMPSTRINGSIZE)
+	{
+		if (!pr_tempoverflowed)
+			Con_DPrintf ("PR_TempString: pool full, using the hunk\n");
+		pr_tempoverflowed = true;
+		return ED_NewString (s);
+	}
+
+	n = pr_tempfree[--pr_numtempfree];
+	strcpy (pr_tempstrings[n], s);
+	pr_tempused[n] = true;
+	pr_temphashnext[n] = pr_temphash[h];
+	pr_temphash[h] = n + 1;
+	return pr_tempstrings[n];
+}
+
+/*
+============
+PR_MarkTempString
+============
+*/
+static void PR_MarkTempString (char *s, qboolean *marks)
+{
+	ptrdiff_t	ofs;
+
+	if (!s)
+		return;
+	ofs = s - pr_tempstrings[0];
+	if (ofs < 0 || ofs >= PR_TEMPSTRINGS*PR_TEMPSTRINGSIZE)
+		return;
+	marks[ofs / PR_TEMPSTRINGSIZE] = true;
+}
+
+/*
+============
+PR_FreeTempStrings
+
+Called between server frames, with no progs running
+============
+*/
+void PR_FreeTempStrings (void)
+{
+	qboolean	marks[PR_TEMPSTRINGS];
+	edict_t		*ed;
+	int			i, j;
+
+	if (!sv.active)
+		return;
+	if (pr_numtempfree >= PR_TEMPSTRINGS/2)
+		return;
+
+	memset (marks, 0, sizeof(marks));
+
+	for (i=0 ; i<pr_numstringglobals ; i++)
+		PR_MarkTempString (G_STRING(pr_stringglobals[i]), marks);
+
+	for (i=0 ; i<sv.num_edicts ; i++)
+	{	// free edicts too, the progs can still read them
+		ed = EDICT_NUM(i);
+		for (j=0 ; j<pr_numstringfields ; j++)
+			PR_MarkTempString (E_STRING(ed, pr_stringfields[j]), marks);
+	}
+
+	for (i=0 ; i<MAX_MODELS ; i++)
+		PR_MarkTempString (sv.model_precache[i], marks);
+	for (i=0 ; i<MAX_SOUNDS ; i++)
+		PR_MarkTempString (sv.sound_precache[i], marks);
+	for (i=0 ; i<MAX_LIGHTSTYLES ; i++)
+		PR_MarkTempString (sv.lightstyles[i], marks);
+
+	memcpy (pr_tempused, marks, sizeof(pr_tempused));
+	PR_RehashTempStrings ();
+}
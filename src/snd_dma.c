@@ -321,6 +321,24 @@ void S_TouchSound (char *name)
 	Cache_Check (&sfx->cache);
 }
 
+/*
+==================
+S_WillLoad
+
+True if S_PrecacheSound would read the sound's file
+==================
+*/
+qboolean S_WillLoad (char *name)
+{
+	sfx_t	*sfx;
+
+	if (!sound_started || nosound.value || !precache.value)
+		return false;
+
+	sfx = S_FindName (name);
+	return !Cache_Check (&sfx->cache);
+}
+
 /*
 ==================
 S_PrecacheSound
@@ -1003,15 +1021,18 @@ void S_LocalSound (char *sound)
 
 void S_ClearPrecache (void)
 {
+	S_DeferResampling (false);	// in case a Host_Error cut a precache short
 }
 
 
 void S_BeginPrecaching (void)
 {
+	S_DeferResampling (true);
 }
 
 
 void S_EndPrecaching (void)
 {
+	S_DeferResampling (false);
 }
 
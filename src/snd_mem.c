@@ -25,23 +25,37 @@ int			cache_full_cycle;
 
 byte *S_Alloc (int size);
 
+/*
+While the client precaches a new map's sounds, S_LoadSound only parses
+and allocates them, keeping a copy of the samples.  They are resampled
+on the worker threads together when the precaching ends.
+*/
+typedef struct
+{
+	sfx_t		*sfx;
+	sfxcache_t	*sc;
+	int			inrate, inwidth;
+	byte		*data;
+} resample_t;
+
+static qboolean		snd_deferring;
+static resample_t	*snd_resamples;
+static int			snd_numresamples, snd_maxresamples;
+
 /*
 ================
-ResampleSfx
+S_Resample
+
+Doesn't touch the cache, so it can run on a worker thread
 ================
 */
-void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+static void S_Resample (sfxcache_t *sc, int inrate, int inwidth, byte *data)
 {
 	int		outcount;
 	int		srcsample;
 	float	stepscale;
 	int		i;
 	int		sample, samplefrac, fracstep;
-	sfxcache_t	*sc;
-	
-	sc = Cache_Check (&sfx->cache);
-	if (!sc)
-		return;
 
 	stepscale = (float)inrate / shm->speed;	// this is usually 0.5, 1, or 2
 
@@ -87,6 +101,112 @@ void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 	}
 }
 
+/*
+================
+ResampleSfx
+================
+*/
+void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+{
+	sfxcache_t	*sc;
+	
+	sc = Cache_Check (&sfx->cache);
+	if (!sc)
+		return;
+
+	S_Resample (sc, inrate, inwidth, data);
+}
+
+/*
+================
+S_DeferResample
+
+Keeps what ResampleSfx needs until S_DeferResampling (false)
+================
+*/
+static qboolean S_DeferResample (sfx_t *sfx, sfxcache_t *sc, byte *data, int datalen)
+{
+	resample_t	*r;
+	int			len;
+
+	if (snd_numresamples == snd_maxresamples)
+	{
+		r = realloc (snd_resamples, (snd_maxresamples + 64) * sizeof(resample_t));
+		if (!r)
+			return false;
+		snd_resamples = r;
+		snd_maxresamples += 64;
+	}
+
+// the source may only be on the stack or the temp hunk
+	len = sc->length * sc->width;
+	r = &snd_resamples[snd_numresamples];
+	r->data = malloc (len);
+	if (!r->data)
+		return false;
+	if (datalen > len)
+		datalen = len;
+	if (datalen < 0)
+		datalen = 0;
+	memcpy (r->data, data, datalen);
+	memset (r->data + datalen, 0, len - datalen);
+
+	r->sfx = sfx;
+	r->inrate = sc->speed;
+	r->inwidth = sc->width;
+	snd_numresamples++;
+	return true;
+}
+
+static void S_ResampleJob (void *data, int index)
+{
+	resample_t	*r;
+
+	r = (resample_t *)data + index;
+	S_Resample (r->sc, r->inrate, r->inwidth, r->data);
+}
+
+/*
+================
+S_DeferResampling
+
+Called with true when precaching starts, and with false when it ends.
+Either way, whatever was loaded since the last call is resampled, so a
+precache cut short by a Host_Error is finished off by the next call.
+================
+*/
+void S_DeferResampling (qboolean defer)
+{
+	int			i, count;
+	resample_t	*r;
+	double		start;
+
+	snd_deferring = defer;
+	if (!snd_numresamples)
+		return;
+
+// later loads may have pushed some out of the cache
+	count = 0;
+	for (i=0, r=snd_resamples ; i<snd_numresamples ; i++, r++)
+	{
+		r->sc = Cache_Check (&r->sfx->cache);
+		if (!r->sc)
+		{
+			free (r->data);
+			continue;
+		}
+		snd_resamples[count++] = *r;
+	}
+
+	start = Sys_FloatTime ();
+	Sys_RunJobs (S_ResampleJob, snd_resamples, count, COM_PrefetchThreads ());
+	Con_DPrintf ("Resampled %i sounds in %.3f seconds\n", count, Sys_FloatTime () - start);
+
+	for (i=0 ; i<count ; i++)
+		free (snd_resamples[i].data);
+	snd_numresamples = 0;
+}
+
 //=============================================================================
 
 /*
@@ -116,7 +236,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
-	data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf));
+	data = COM_LoadMappedFile(namebuffer, stackbuf, sizeof(stackbuf));
 
 	if (!data)
 	{
@@ -146,6 +266,8 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	sc->width = info.width;
 	sc->stereo = info.channels;
 
+	if (snd_deferring && S_DeferResample (s, sc, data + info.dataofs, com_filesize - info.dataofs))
+		return sc;
 	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
 
 	return sc;
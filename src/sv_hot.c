@@ -0,0 +1,339 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_hot.c -- packed copies of the edict fields the server scans most
+
+/*
+An edict is several hundred bytes, and the fields the broadphase and the
+entity updates look at for every candidate are spread over two or three
+cache lines of it.  sv_hot keeps those fields in arrays indexed by edict
+number instead: the abs box and solid for the box tests of SV_ClipToLinks,
+SV_MoveBatch and SV_AreaEdicts (findradius), and whether there is a model
+and which leafs it is in for the visibility pass of the entity updates.
+The edicts that pass are then looked at as before.
+
+SV_LinkEdict updates the copy of the edict it links.  Anything else that
+writes one of the fields marks the edict, the progs through OP_ADDRESS as
+for sv_think.c, and the marked edicts are copied again at the next
+SV_HotSync, which the readers call before they start.  SV_Move calls made
+on the worker threads rely on the sync made before they were started.
+*/
+
+#include "quakedef.h"
+
+cvar_t	sv_hotfields = {"sv_hotfields", "1"};
+
+svhot_t	sv_hot;
+byte	sv_watchedfields[SV_WATCHEDFIELDS];
+
+static unsigned	hot_dirty[(MAX_EDICTS+31)/32];
+static qboolean	hot_anydirty;
+static qboolean	hot_rebuild = true;
+
+/*
+============
+SV_HotInit
+
+Fills in the fields whose writes by the progs have to be heard about
+============
+*/
+void SV_HotInit (void)
+{
+	static int	fields[] = {
+		offsetof(entvars_t, nextthink), offsetof(entvars_t, movetype),	// sv_think.c
+		offsetof(entvars_t, absmin), offsetof(entvars_t, absmin) + 4, offsetof(entvars_t, absmin) + 8,
+		offsetof(entvars_t, absmax), offsetof(entvars_t, absmax) + 4, offsetof(entvars_t, absmax) + 8,
+		offsetof(entvars_t, solid), offsetof(entvars_t, modelindex), offsetof(entvars_t, model)
+	};
+	int		i;
+
+	for (i=0 ; i<(int)(sizeof(fields)/sizeof(fields[0])) ; i++)
+		sv_watchedfields[fields[i]/4] = true;
+}
+
+/*
+============
+SV_HotReset
+
+The edicts have been overwritten, so copy all of them at the next sync
+============
+*/
+void SV_HotReset (void)
+{
+	hot_rebuild = true;
+}
+
+/*
+============
+SV_HotChanged
+============
+*/
+void SV_HotChanged (edict_t *ed)
+{
+	int		e;
+
+	e = NUM_FOR_EDICT(ed);
+	hot_dirty[e>>5] |= 1<<(e&31);
+	hot_anydirty = true;
+}
+
+/*
+============
+SV_FieldChanged
+
+The progs have taken the address of a watched field of ed
+============
+*/
+void SV_FieldChanged (edict_t *ed)
+{
+	SV_ThinkChanged (ed);
+	SV_HotChanged (ed);
+}
+
+/*
+============
+SV_HotCopy
+============
+*/
+static void SV_HotCopy (edict_t *ent, int e)
+{
+	VectorCopy (ent->v.absmin, sv_hot.absmin[e]);
+	VectorCopy (ent->v.absmax, sv_hot.absmax[e]);
+	sv_hot.solid[e] = ent->v.solid;
+	sv_hot.visible[e] = ent->v.modelindex && pr_strings[ent->v.model];
+	sv_hot.numleafs[e] = ent->num_leafs;
+	memcpy (sv_hot.leafnums[e], ent->leafnums, ent->num_leafs * sizeof(short));
+}
+
+/*
+============
+SV_HotLink
+
+Called by SV_LinkEdict once the abs box and leafs are set
+============
+*/
+void SV_HotLink (edict_t *ent)
+{
+	SV_HotCopy (ent, SV_HOTNUM(ent));
+}
+
+/*
+============
+SV_HotSync
+
+Brings the copies of the marked edicts up to date
+============
+*/
+void SV_HotSync (void)
+{
+	int			w, e;
+	unsigned	bits;
+
+	if (hot_rebuild)
+	{
+		for (e=0 ; e<sv.num_edicts ; e++)
+			SV_HotCopy (EDICT_NUM(e), e);
+		memset (hot_dirty, 0, sizeof(hot_dirty));
+		hot_anydirty = false;
+		hot_rebuild = false;
+		return;
+	}
+
+	if (!hot_anydirty)
+		return;
+	for (w=0 ; w<(MAX_EDICTS+31)/32 ; w++)
+	{
+		bits = hot_dirty[w];
+		if (!bits)
+			continue;
+		hot_dirty[w] = 0;
+		for (e = w<<5 ; bits ; bits >>= 1, e++)
+			if ((bits & 1) && e < sv.num_edicts)
+				SV_HotCopy (EDICT_NUM(e), e);
+	}
+	hot_anydirty = false;
+}
+
+/*
+============
+SV_HotVisible
+
+The model and PVS part of SV_EntityVisible
+============
+*/
+qboolean SV_HotVisible (int e, byte *pvs)
+{
+	int		i;
+	short	*leafs;
+
+	if (!sv_hot.visible[e])
+		return false;
+
+	leafs = sv_hot.leafnums[e];
+	for (i=0 ; i < sv_hot.numleafs[e] ; i++)
+		if (pvs[leafs[i] >> 3] & (1 << (leafs[i]&7) ))
+			return true;
+
+	return false;
+}
+
+/*
+===============================================================================
+
+BENCHMARK
+
+===============================================================================
+*/
+
+#define	HOTBENCH_FLUSH	(8*1024*1024)	// more than the last level cache
+
+static byte		*hotbench_flush;
+
+/*
+============
+SV_HotBenchRun
+
+Times one kind of query, with the caches emptied before each one when
+cold is set.  Returns the microseconds per query.
+============
+*/
+static double SV_HotBenchRun (int kind, int count, qboolean cold, int *found)
+{
+	int		i, e, n;
+	vec3_t	p, end, mins, maxs;
+	byte	*pvs;
+	double	start, total;
+	edict_t	*list[MAX_EDICTS];
+	static	vec3_t	hullmins = {-16, -16, -24}, hullmaxs = {16, 16, 32};
+
+	SV_BenchSeed (5 + kind);
+	total = 0;
+	n = 0;
+	for (i=0 ; i<count ; i++)
+	{
+		SV_BenchPoint (p);
+		pvs = Mod_LeafPVS (Mod_PointInLeaf (p, sv.worldmodel), sv.worldmodel);
+		if (cold)
+			memset (hotbench_flush, i, HOTBENCH_FLUSH);
+
+		start = Sys_FloatTime ();
+		switch (kind)
+		{
+		case 0:		// the visibility pass of the entity updates
+			for (e=1 ; e<sv.num_edicts ; e++)
+				if (SV_EntityVisible (NULL, EDICT_NUM(e), e, pvs))
+					n++;
+			break;
+		case 1:		// a player sized move
+			VectorCopy (p, end);
+			end[0] += 256;
+			end[1] += 128;
+			if (SV_Move (p, hullmins, hullmaxs, end, MOVE_NORMAL, NULL).ent)
+				n++;
+			break;
+		case 2:		// findradius 512 with pr_findindex
+			VectorCopy (p, mins);
+			VectorCopy (p, maxs);
+			for (e=0 ; e<3 ; e++)
+			{
+				mins[e] -= 513;
+				maxs[e] += 513;
+			}
+			n += SV_AreaEdicts (mins, maxs, list);
+			break;
+		}
+		total += Sys_FloatTime () - start;
+	}
+
+	*found = n;
+	return total * 1000000 / count;
+}
+
+/*
+============
+SV_HotBench_f
+
+sv_hotbench [extra entities] [queries]
+
+Runs the same visibility passes, moves and findradius boxes with the
+readers going to the edicts and to sv_hot, warm and with the caches
+emptied before each query.  The extra entities are modelled boxes
+scattered over the map, removed afterwards.
+============
+*/
+void SV_HotBench_f (void)
+{
+	int		i, kind, cold, numents, count, found[2];
+	edict_t	*spawned[MAX_EDICTS];
+	double	time[2];
+	char	oldvalue[32];
+	static	char	*names[3] = {"visibility", "move", "findradius"};
+	static	vec3_t	mins = {-16, -16, -24}, maxs = {16, 16, 32};
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_hotbench: no server running\n");
+		return;
+	}
+
+	numents = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : 0;
+	count = Cmd_Argc() > 2 ? Q_atoi (Cmd_Argv(2)) : 200;
+	if (count < 1)
+		count = 1;
+
+	hotbench_flush = malloc (HOTBENCH_FLUSH);
+	if (!hotbench_flush)
+	{
+		Con_Printf ("sv_hotbench: out of memory\n");
+		return;
+	}
+
+	SV_BenchSeed (1);
+	numents = SV_BenchSpawn (spawned, numents, mins, maxs);
+	for (i=0 ; i<numents ; i++)
+	{	// give them a model so the visibility pass looks at them
+		spawned[i]->v.model = sv.edicts->v.model;	// any name will do
+		spawned[i]->v.modelindex = 1;
+		SV_LinkEdict (spawned[i], false);
+	}
+
+	Q_strncpy (oldvalue, sv_hotfields.string, sizeof(oldvalue)-1);
+	oldvalue[sizeof(oldvalue)-1] = 0;
+	Con_Printf ("%i edicts of %i bytes, %i queries\n", sv.num_edicts, pr_edict_size, count);
+	Con_Printf ("                 edicts   sv_hot  us per query\n");
+	for (kind=0 ; kind<3 ; kind++)
+		for (cold=0 ; cold<2 ; cold++)
+		{
+			for (i=0 ; i<2 ; i++)
+			{
+				Cvar_SetValue ("sv_hotfields", i);
+				SV_HotSync ();
+				time[i] = SV_HotBenchRun (kind, count, cold, &found[i]);
+			}
+			Con_Printf ("%-10s %s %8.2f %8.2f\n", names[kind], cold ? "cold" : "warm", time[0], time[1]);
+			if (found[0] != found[1])
+				Con_Printf ("%s results differ: %i and %i\n", names[kind], found[0], found[1]);
+		}
+	Cvar_Set ("sv_hotfields", oldvalue);
+
+	SV_BenchRemove (spawned, numents);
+
+	free (hotbench_flush);
+	hotbench_flush = NULL;
+}
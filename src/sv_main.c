@@ -46,6 +46,11 @@ void SV_Init (void)
 	extern	cvar_t	sv_accelerate;
 	extern	cvar_t	sv_idealpitchscale;
 	extern	cvar_t	sv_aim;
+	extern	cvar_t	sv_threads;
+	extern	cvar_t	sv_area;
+	extern	cvar_t	sv_deltaentities;
+	extern	cvar_t	sv_tracememo;
+	extern	cvar_t	sv_parallelphysics;
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
@@ -57,6 +62,24 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
+	Cvar_RegisterVariable (&sv_threads);
+	Cvar_RegisterVariable (&sv_area);
+	Cvar_RegisterVariable (&sv_deltaentities);
+	Cvar_RegisterVariable (&sv_tracememo);
+	Cvar_RegisterVariable (&sv_parallelphysics);
+	Cvar_RegisterVariable (&sv_thinkqueue);
+	Cvar_RegisterVariable (&sv_hotfields);
+	Cvar_RegisterVariable (&sv_profile);
+	Cvar_RegisterVariable (&sv_statslog);
+
+	Cmd_AddCommand ("sv_areabench", SV_AreaBench_f);
+	Cmd_AddCommand ("sv_movebench", SV_MoveBench_f);
+	Cmd_AddCommand ("sv_hotbench", SV_HotBench_f);
+	Cmd_AddCommand ("sv_tracetest", SV_TraceTest_f);
+	Cmd_AddCommand ("sv_deltatest", SV_DeltaTest_f);
+	Cmd_AddCommand ("sv_stats", SV_Stats_f);
+
+	SV_HotInit ();
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -190,6 +213,7 @@ void SV_SendServerinfo (client_t *client)
 {
 	char			**s;
 	char			message[2048];
+	int				i;
 
 	MSG_WriteByte (&client->message, svc_print);
 	sprintf (message, "%c\nVERSION %4.2f SERVER (%i CRC)", 2, VERSION, pr_crc);
@@ -230,6 +254,12 @@ void SV_SendServerinfo (client_t *client)
 
 	client->sendsignon = true;
 	client->spawned = false;		// need prespawn, spawn, etc
+
+// the client asks for delta frames again at each signon
+	client->deltaentities = false;
+	client->deltaack = -1;
+	for (i=0 ; i<DELTA_BACKUP ; i++)
+		client->deltaframes[i].framenum = -1;
 }
 
 /*
@@ -358,30 +388,103 @@ or other small motion on the client side.  Otherwise, a bob might cause an
 entity that should be visible to not show up, especially when the bob
 crosses a waterline.
 
+The fat PVS only depends on which leafs are within reach of the view
+origin, so it is cached by that leaf set.  Clients standing in the same
+area share one entry, and an entry stays good until the next map.
+
 =============================================================================
 */
 
-int		fatbytes;
-byte	fatpvs[MAX_MAP_LEAFS/8];
+#define	MAX_FATLEAFS	32		// more than this is computed uncached
+#define	FATPVS_CACHE	32		// must be above MAX_SCOREBOARD
+
+typedef struct
+{
+	int		numleafs;			// 0 = free
+	mleaf_t	*leafs[MAX_FATLEAFS];
+	int		stamp;				// sv_fatpvsstamp when last used
+	byte	pvs[MAX_MAP_LEAFS/8];
+} fatpvs_t;
+
+static fatpvs_t	sv_fatpvs[FATPVS_CACHE];
+static int		sv_fatpvsstamp;
 
-void SV_AddToFatPVS (vec3_t org, mnode_t *node)
+/*
+=============
+SV_ClearFatPVS
+
+Called at map load, since the cache holds leaf pointers
+=============
+*/
+void SV_ClearFatPVS (void)
 {
 	int		i;
-	byte	*pvs;
+
+	for (i=0 ; i<FATPVS_CACHE ; i++)
+		sv_fatpvs[i].numleafs = 0;
+	sv_fatpvsstamp = 0;
+}
+
+/*
+=============
+SV_FatLeafs
+
+Collects the non-solid leafs within 8 units of org.  Returns the full
+count even if it is above MAX_FATLEAFS.
+=============
+*/
+int SV_FatLeafs (vec3_t org, mnode_t *node, mleaf_t **leafs, int numleafs)
+{
 	mplane_t	*plane;
 	float	d;
 
 	while (1)
 	{
-	// if this is a leaf, accumulate the pvs bits
 		if (node->contents < 0)
 		{
 			if (node->contents != CONTENTS_SOLID)
 			{
-				pvs = Mod_LeafPVS ( (mleaf_t *)node, sv.worldmodel);
-				for (i=0 ; i<fatbytes ; i++)
-					fatpvs[i] |= pvs[i];
+				if (numleafs < MAX_FATLEAFS)
+					leafs[numleafs] = (mleaf_t *)node;
+				numleafs++;
 			}
+			return numleafs;
+		}
+	
+		plane = node->plane;
+		d = DotProduct (org, plane->normal) - plane->dist;
+		if (d > 8)
+			node = node->children[0];
+		else if (d < -8)
+			node = node->children[1];
+		else
+		{	// go down both
+			numleafs = SV_FatLeafs (org, node->children[0], leafs, numleafs);
+			node = node->children[1];
+		}
+	}
+}
+
+/*
+=============
+SV_AddToFatPVS
+
+The leaf rows are ORed straight into the caller's buffer so that several
+clients can build their PVS at once.
+=============
+*/
+void SV_AddToFatPVS (vec3_t org, mnode_t *node, byte *pvs)
+{
+	mplane_t	*plane;
+	float	d;
+
+	while (1)
+	{
+	// if this is a leaf, accumulate the pvs bits
+		if (node->contents < 0)
+		{
+			if (node->contents != CONTENTS_SOLID)
+				Mod_OrLeafPVS ( (mleaf_t *)node, sv.worldmodel, pvs);
 			return;
 		}
 	
@@ -393,7 +496,7 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 			node = node->children[1];
 		else
 		{	// go down both
-			SV_AddToFatPVS (org, node->children[0]);
+			SV_AddToFatPVS (org, node->children[0], pvs);
 			node = node->children[1];
 		}
 	}
@@ -404,69 +507,120 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node)
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  The result is usually a cache entry; pvs is only written if the
+point touches too many leafs to be cached.  Main thread only.
 =============
 */
-byte *SV_FatPVS (vec3_t org)
+byte *SV_FatPVS (vec3_t org, byte *pvs)
 {
+	int			i, j, numleafs, fatbytes;
+	mleaf_t		*leafs[MAX_FATLEAFS];
+	fatpvs_t	*fat, *oldest;
+
 	fatbytes = (sv.worldmodel->numleafs+31)>>3;
-	Q_memset (fatpvs, 0, fatbytes);
-	SV_AddToFatPVS (org, sv.worldmodel->nodes);
-	return fatpvs;
+	numleafs = SV_FatLeafs (org, sv.worldmodel->nodes, leafs, 0);
+
+	if (numleafs > MAX_FATLEAFS)
+	{
+		Q_memset (pvs, 0, fatbytes);
+		SV_AddToFatPVS (org, sv.worldmodel->nodes, pvs);
+		return pvs;
+	}
+
+	oldest = sv_fatpvs;
+	for (i=0, fat = sv_fatpvs ; i<FATPVS_CACHE ; i++, fat++)
+	{
+		if (fat->numleafs == numleafs)
+		{
+			for (j=0 ; j<numleafs ; j++)
+				if (fat->leafs[j] != leafs[j])
+					break;
+			if (j == numleafs)
+			{
+				fat->stamp = sv_fatpvsstamp;
+				return fat->pvs;
+			}
+		}
+		if (oldest->numleafs && (!fat->numleafs || fat->stamp < oldest->stamp))
+			oldest = fat;
+	}
+
+// replace the least recently used entry.  Entries handed out this frame are
+// never the oldest, since there are more entries than clients.
+	fat = oldest;
+	fat->numleafs = numleafs;
+	fat->stamp = sv_fatpvsstamp;
+	Q_memset (fat->pvs, 0, fatbytes);
+	for (j=0 ; j<numleafs ; j++)
+	{
+		fat->leafs[j] = leafs[j];
+		Mod_OrLeafPVS (leafs[j], sv.worldmodel, fat->pvs);
+	}
+
+	return fat->pvs;
 }
 
 //=============================================================================
 
 
+/*
+=============
+SV_EntityVisible
+
+Whether ent goes in the entity updates sent to clent
+=============
+*/
+qboolean SV_EntityVisible (edict_t *clent, edict_t *ent, int e, byte *pvs)
+{
+	int		i;
+
+#ifdef QUAKE2
+	// don't send if flagged for NODRAW and there are no lighting effects
+	if (ent->v.effects == EF_NODRAW)
+		return false;
+#endif
+
+	if (ent == clent)
+		return true;	// clent is ALLWAYS sent
+
+	if (sv_hotfields.value)
+		return SV_HotVisible (e, pvs);
+
+// ignore ents without visible models
+	if (!ent->v.modelindex || !pr_strings[ent->v.model])
+		return false;
+
+// ignore if not touching a PV leaf
+	for (i=0 ; i < ent->num_leafs ; i++)
+		if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
+			return true;
+
+	return false;
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
 
+pvs is the client's fat PVS.  Returns false if the message ran out of room.
 =============
 */
-void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
+qboolean SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg, byte *pvs)
 {
 	int		e, i;
 	int		bits;
-	byte	*pvs;
-	vec3_t	org;
 	float	miss;
 	edict_t	*ent;
 
-// find the client's PVS
-	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org);
-
 // send over all entities (excpet the client) that touch the pvs
 	ent = NEXT_EDICT(sv.edicts);
 	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
 	{
-#ifdef QUAKE2
-		// don't send if flagged for NODRAW and there are no lighting effects
-		if (ent->v.effects == EF_NODRAW)
+		if (!SV_EntityVisible (clent, ent, e, pvs))
 			continue;
-#endif
-
-// ignore if not touching a PV leaf
-		if (ent != clent)	// clent is ALLWAYS sent
-		{
-// ignore ents without visible models
-			if (!ent->v.modelindex || !pr_strings[ent->v.model])
-				continue;
-
-			for (i=0 ; i < ent->num_leafs ; i++)
-				if (pvs[ent->leafnums[i] >> 3] & (1 << (ent->leafnums[i]&7) ))
-					break;
-				
-			if (i == ent->num_leafs)
-				continue;		// not visible
-		}
 
 		if (msg->maxsize - msg->cursize < 16)
-		{
-			Con_Printf ("packet overflow\n");
-			return;
-		}
+			return false;		// packet overflow
 
 // send an update
 		bits = 0;
@@ -546,6 +700,397 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 		if (bits & U_ANGLE3)
 			MSG_WriteAngle(msg, ent->v.angles[2]);
 	}
+
+	return true;
+}
+
+/*
+=============================================================================
+
+DELTA ENTITY FRAMES
+
+Clients that asked for svc_deltaentities get their entity updates relative
+to the last frame they acknowledged with clc_deltaack, instead of relative
+to the baselines.  An entity that has not changed since then costs nothing,
+and entities that left the frame are removed explicitly.  Entities new to
+the client are sent relative to an all-zero state, so the client never has
+to reconstruct wire values from its float baselines.
+
+Both sides build the resulting frame with the same merge, so anything the
+server could not fit in the message keeps its old state on both ends.
+
+=============================================================================
+*/
+
+cvar_t	sv_deltaentities = {"sv_deltaentities", "0"};	// allow clients to ask for delta frames
+
+#define	MAX_DELTA_BYTES	18		// largest single entity record
+
+/*
+=============
+SV_PackEntity
+
+The entity as the client will decode it
+=============
+*/
+static void SV_PackEntity (int e, edict_t *ent, deltaentity_t *to)
+{
+	int		i;
+
+	to->number = e;
+	to->flags = (ent->v.movetype == MOVETYPE_STEP) ? U_NOLERP : 0;
+	for (i=0 ; i<3 ; i++)
+	{
+		to->origin[i] = (int)(ent->v.origin[i]*8);
+		to->angles[i] = ((int)ent->v.angles[i]*256/360) & 255;
+	}
+	to->modelindex = (int)ent->v.modelindex;
+	to->frame = (int)ent->v.frame;
+	to->colormap = (int)ent->v.colormap;
+	to->skin = (int)ent->v.skin;
+	to->effects = (int)ent->v.effects;
+}
+
+/*
+=============
+SV_WriteDeltaEntity
+
+Writes to relative to from, or relative to nothing if from is NULL
+=============
+*/
+static void SV_WriteDeltaEntity (deltaentity_t *from, deltaentity_t *to, sizebuf_t *msg)
+{
+	static deltaentity_t	null;
+	int		bits, i;
+
+	if (!from)
+		from = &null;
+
+	bits = to->flags & U_NOLERP;
+	for (i=0 ; i<3 ; i++)
+	{
+		if (to->origin[i] != from->origin[i])
+			bits |= U_ORIGIN1<<i;
+	}
+	if (to->angles[0] != from->angles[0])
+		bits |= U_ANGLE1;
+	if (to->angles[1] != from->angles[1])
+		bits |= U_ANGLE2;
+	if (to->angles[2] != from->angles[2])
+		bits |= U_ANGLE3;
+	if (to->modelindex != from->modelindex)
+		bits |= U_MODEL;
+	if (to->frame != from->frame)
+		bits |= U_FRAME;
+	if (to->colormap != from->colormap)
+		bits |= U_COLORMAP;
+	if (to->skin != from->skin)
+		bits |= U_SKIN;
+	if (to->effects != from->effects)
+		bits |= U_EFFECTS;
+
+	if (to->number >= 256)
+		bits |= U_LONGENTITY;
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+	MSG_WriteByte (msg, bits | U_SIGNAL);
+	if (bits & U_MOREBITS)
+		MSG_WriteByte (msg, bits>>8);
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg, to->number);
+	else
+		MSG_WriteByte (msg, to->number);
+
+	if (bits & U_MODEL)
+		MSG_WriteByte (msg, to->modelindex);
+	if (bits & U_FRAME)
+		MSG_WriteByte (msg, to->frame);
+	if (bits & U_COLORMAP)
+		MSG_WriteByte (msg, to->colormap);
+	if (bits & U_SKIN)
+		MSG_WriteByte (msg, to->skin);
+	if (bits & U_EFFECTS)
+		MSG_WriteByte (msg, to->effects);
+	if (bits & U_ORIGIN1)
+		MSG_WriteShort (msg, to->origin[0]);
+	if (bits & U_ANGLE1)
+		MSG_WriteByte (msg, to->angles[0]);
+	if (bits & U_ORIGIN2)
+		MSG_WriteShort (msg, to->origin[1]);
+	if (bits & U_ANGLE2)
+		MSG_WriteByte (msg, to->angles[1]);
+	if (bits & U_ORIGIN3)
+		MSG_WriteShort (msg, to->origin[2]);
+	if (bits & U_ANGLE3)
+		MSG_WriteByte (msg, to->angles[2]);
+}
+
+/*
+=============
+SV_WriteRemoveEntity
+=============
+*/
+static void SV_WriteRemoveEntity (int number, sizebuf_t *msg)
+{
+	int		bits;
+
+	bits = U_REMOVE | U_MOREBITS;
+	if (number >= 256)
+		bits |= U_LONGENTITY;
+
+	MSG_WriteByte (msg, bits | U_SIGNAL);
+	MSG_WriteByte (msg, bits>>8);
+	if (bits & U_LONGENTITY)
+		MSG_WriteShort (msg, number);
+	else
+		MSG_WriteByte (msg, number);
+}
+
+/*
+=============
+SV_AddDeltaEntity
+
+Both ends drop whatever does not fit in a frame
+=============
+*/
+static void SV_AddDeltaEntity (deltaframe_t *frame, deltaentity_t *ent)
+{
+	if (frame->numentities < MAX_DELTA_ENTITIES)
+		frame->entities[frame->numentities++] = *ent;
+}
+
+/*
+=============
+SV_WriteDeltaEntities
+
+The svc_deltaentities equivalent of SV_WriteEntitiesToClient.  Only touches
+the client's own frames, so it is safe on the datagram worker threads.
+Returns false if the message ran out of room.  If more than
+MAX_DELTA_ENTITIES are visible only the first ones are sent, as if the
+rest were not, and truncated is set.
+=============
+*/
+qboolean SV_WriteDeltaEntities (client_t *client, sizebuf_t *msg, byte *pvs, qboolean *truncated)
+{
+	deltaentity_t	cur[MAX_DELTA_ENTITIES];
+	deltaframe_t	*from, *to;
+	deltaentity_t	*old, *new;
+	int		numcur, e, oldindex, newindex, oldnum, newnum;
+	int		age;
+	edict_t	*ent;
+	qboolean	room;
+
+	room = true;
+	*truncated = false;
+
+// the entities the client should see now
+	numcur = 0;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+	{
+		if (!SV_EntityVisible (client->edict, ent, e, pvs))
+			continue;
+		if (numcur == MAX_DELTA_ENTITIES)
+		{
+			*truncated = true;
+			break;
+		}
+		SV_PackEntity (e, ent, &cur[numcur++]);
+	}
+
+// delta from the last acknowledged frame if it is still around
+	from = NULL;
+	age = client->deltaframe - client->deltaack;
+	if (client->deltaack >= 0 && age > 0 && age < DELTA_BACKUP)
+	{
+		from = &client->deltaframes[client->deltaack & DELTA_MASK];
+		if (from->framenum != client->deltaack)
+			from = NULL;
+	}
+
+	to = &client->deltaframes[client->deltaframe & DELTA_MASK];
+	to->framenum = -1;
+	to->numentities = 0;
+
+	if (msg->maxsize - msg->cursize < 10)
+		return false;
+
+	MSG_WriteByte (msg, svc_deltaentities);
+	MSG_WriteLong (msg, client->deltaframe);
+	MSG_WriteLong (msg, from ? from->framenum : -1);
+
+	oldindex = newindex = 0;
+	while (1)
+	{
+		old = (from && oldindex < from->numentities) ? &from->entities[oldindex] : NULL;
+		new = (newindex < numcur) ? &cur[newindex] : NULL;
+		if (!old && !new)
+			break;
+		oldnum = old ? old->number : 0x10000;
+		newnum = new ? new->number : 0x10000;
+
+		if (room && msg->maxsize - msg->cursize < MAX_DELTA_BYTES + 1)
+			room = false;		// packet overflow, the rest keep their old state
+
+		if (newnum == oldnum)
+		{	// still visible, send the changes if any
+			if (memcmp (old, new, sizeof(*new)))
+			{
+				if (room)
+				{
+					SV_WriteDeltaEntity (old, new, msg);
+					SV_AddDeltaEntity (to, new);
+				}
+				else
+					SV_AddDeltaEntity (to, old);
+			}
+			else
+				SV_AddDeltaEntity (to, new);
+			oldindex++;
+			newindex++;
+		}
+		else if (newnum < oldnum)
+		{	// new to the client
+			if (room)
+			{
+				SV_WriteDeltaEntity (NULL, new, msg);
+				SV_AddDeltaEntity (to, new);
+			}
+			newindex++;
+		}
+		else
+		{	// no longer visible
+			if (room)
+				SV_WriteRemoveEntity (oldnum, msg);
+			else
+				SV_AddDeltaEntity (to, old);
+			oldindex++;
+		}
+	}
+
+	MSG_WriteByte (msg, 0);
+
+	to->framenum = client->deltaframe++;
+	return room;
+}
+
+/*
+==================
+SV_DeltaTest_f
+
+sv_deltatest [entities]
+
+Copies a visible entity of the map, more times than a delta frame holds,
+and writes three delta frames for them to a dummy client that sees
+everything: from nothing, from the first frame after moving them, and from
+the second into a message with no room.  The first two have to hold the
+first MAX_DELTA_ENTITIES entities as they are now, the last one the state
+of the second frame.
+==================
+*/
+void SV_DeltaTest_f (void)
+{
+	static client_t	client;
+	static byte		pvs[MAX_MAP_LEAFS/8];
+	byte		buf[MAX_DELTA_ENTITIES*(MAX_DELTA_BYTES+1) + 16];
+	sizebuf_t	msg;
+	deltaframe_t	*frame;
+	deltaentity_t	packed;
+	edict_t		*ent, *spot, *spawned[MAX_EDICTS];
+	int			i, e, numents, visible, failed;
+	qboolean	ret, truncated;
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_deltatest: no server running\n");
+		return;
+	}
+
+	numents = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : MAX_DELTA_ENTITIES + 64;
+
+	spot = NULL;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+		if (!ent->free && ent->v.modelindex && pr_strings[ent->v.model] && ent->num_leafs)
+		{
+			spot = ent;
+			break;
+		}
+	if (!spot)
+	{
+		Con_Printf ("sv_deltatest: no visible entity to copy\n");
+		return;
+	}
+
+	numents = SV_BenchSpawn (spawned, numents, spot->v.mins, spot->v.maxs);
+	for (i=0 ; i<numents ; i++)
+	{	// all of them where the copied one is
+		ent = spawned[i];
+		ent->v.solid = SOLID_NOT;
+		ent->v.model = spot->v.model;
+		ent->v.modelindex = spot->v.modelindex;
+		VectorCopy (spot->v.origin, ent->v.origin);
+		SV_LinkEdict (ent, false);
+	}
+
+	memset (&client, 0, sizeof(client));
+	client.edict = sv.edicts;
+	client.deltaack = -1;
+	memset (pvs, 0xff, sizeof(pvs));
+
+	msg.data = buf;
+	msg.maxsize = sizeof(buf);
+	msg.allowoverflow = false;
+
+	SV_HotSync ();
+	visible = 0;
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+		if (SV_EntityVisible (client.edict, ent, e, pvs))
+			visible++;
+
+	failed = 0;
+	for (i=0 ; i<3 ; i++)
+	{
+		if (i)
+		{	// the client has the last frame, move everything it holds
+			client.deltaack = client.deltaframe - 1;
+			for (e=0 ; e<numents ; e++)
+			{
+				spawned[e]->v.origin[2] += 1;
+				SV_LinkEdict (spawned[e], false);
+			}
+			SV_HotSync ();
+		}
+
+		msg.cursize = 0;
+		msg.overflowed = false;
+		if (i == 2)
+			msg.maxsize = 16;
+		ret = SV_WriteDeltaEntities (&client, &msg, pvs, &truncated);
+		if (ret != (i != 2) || truncated != (visible > MAX_DELTA_ENTITIES))
+			failed++;
+
+		frame = &client.deltaframes[(client.deltaframe - 1) & DELTA_MASK];
+		if (frame->numentities != (visible < MAX_DELTA_ENTITIES ? visible : MAX_DELTA_ENTITIES))
+			failed++;
+		for (e=0 ; e<frame->numentities ; e++)
+		{
+			ent = EDICT_NUM(frame->entities[e].number);
+			if (i == 2)
+				packed = client.deltaframes[(client.deltaframe - 2) & DELTA_MASK].entities[e];
+			else
+				SV_PackEntity (frame->entities[e].number, ent, &packed);
+			if (memcmp (&packed, &frame->entities[e], sizeof(packed)))
+				failed++;
+		}
+	}
+
+	SV_BenchRemove (spawned, numents);
+
+	Con_Printf ("%i entities visible, %i in a frame\n", visible, frame->numentities);
+	Con_Printf ("%i checks failed\n", failed);
 }
 
 /*
@@ -569,11 +1114,14 @@ void SV_CleanupEnts (void)
 
 /*
 ==================
-SV_WriteClientdataToMessage
+SV_WriteClientdata
 
+Everything in SV_WriteClientdataToMessage except the ideal pitch update,
+which only depends on sv_player and so is shared by all clients.  Writes
+nothing but ent and msg, so it can run for several clients at once.
 ==================
 */
-void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
+static void SV_WriteClientdata (edict_t *ent, sizebuf_t *msg)
 {
 	int		bits;
 	int		i;
@@ -599,11 +1147,6 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 		ent->v.dmg_save = 0;
 	}
 
-//
-// send the current viewpos offset from the view entity
-//
-	SV_SetIdealPitch ();		// how much to look up / down ideally
-
 // a fixangle might get lost in a dropped packet.  Oh well.
 	if ( ent->v.fixangle )
 	{
@@ -626,7 +1169,7 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 #ifdef QUAKE2
 	items = (int)ent->v.items | ((int)ent->v.items2 << 23);
 #else
-	val = GetEdictFieldValue(ent, "items2");
+	val = GETEDICTFIELDVALUE(ent, eval_items2);
 
 	if (val)
 		items = (int)ent->v.items | ((int)val->_float << 23);
@@ -712,34 +1255,125 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 	}
 }
 
+/*
+==================
+SV_WriteClientdataToMessage
+
+==================
+*/
+void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
+{
+//
+// send the current viewpos offset from the view entity
+//
+	SV_SetIdealPitch ();		// how much to look up / down ideally
+
+	SV_WriteClientdata (ent, msg);
+}
+
+/*
+=============================================================================
+
+CLIENT DATAGRAMS
+
+The unreliable datagram for each client is built against the edict state
+left by SV_Physics.  With sv_threads > 1 the datagrams of all spawned
+clients are built up front on worker threads, and only the sends are done
+in client order on the main thread.  Building a datagram writes nothing but
+the client's own edict (damage and fixangle) and its clientframe_t, so the
+bytes sent are the same as the serial path.
+
+Anything that can run QuakeC in the send loop (SV_DropClient) invalidates
+the datagrams that were built ahead, and the remaining clients fall back
+to building their own in order.
+
+=============================================================================
+*/
+
+cvar_t	sv_threads = {"sv_threads", "0"};	// 0 or 1 = build datagrams serially
+
+typedef struct
+{
+	client_t	*client;
+	sizebuf_t	msg;
+	byte		buf[MAX_DATAGRAM];
+	byte		*fatpvs;			// from SV_FatPVS
+	byte		pvs[MAX_MAP_LEAFS/8];	// in case it could not be cached
+	qboolean	overflowed;
+	qboolean	truncated;			// more entities visible than a delta frame holds
+} clientframe_t;
+
+static clientframe_t	sv_clientframes[MAX_SCOREBOARD];
+
+/*
+=======================
+SV_SetupClientFrame
+
+Looks up the client's fat PVS, which has to be done on the main thread
+=======================
+*/
+static void SV_SetupClientFrame (clientframe_t *frame, client_t *client)
+{
+	vec3_t	org;
+
+	frame->client = client;
+	VectorAdd (client->edict->v.origin, client->edict->v.view_ofs, org);
+	frame->fatpvs = SV_FatPVS (org, frame->pvs);
+}
+
 /*
 =======================
-SV_SendClientDatagram
+SV_BuildClientDatagram
 =======================
 */
-qboolean SV_SendClientDatagram (client_t *client)
+static void SV_BuildClientDatagram (clientframe_t *frame, qboolean idealpitch)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
-	
-	msg.data = buf;
-	msg.maxsize = sizeof(buf);
-	msg.cursize = 0;
+	client_t	*client;
+	sizebuf_t	*msg;
+
+	client = frame->client;
+	msg = &frame->msg;
+	msg->data = frame->buf;
+	msg->maxsize = sizeof(frame->buf);
+	msg->cursize = 0;
+	msg->allowoverflow = false;
+	msg->overflowed = false;
 
-	MSG_WriteByte (&msg, svc_time);
-	MSG_WriteFloat (&msg, sv.time);
+	MSG_WriteByte (msg, svc_time);
+	MSG_WriteFloat (msg, sv.time);
 
 // add the client specific data to the datagram
-	SV_WriteClientdataToMessage (client->edict, &msg);
+	if (idealpitch)
+		SV_WriteClientdataToMessage (client->edict, msg);
+	else
+		SV_WriteClientdata (client->edict, msg);
 
-	SV_WriteEntitiesToClient (client->edict, &msg);
+	frame->truncated = false;
+	if (client->deltaentities && sv_deltaentities.value)
+		frame->overflowed = !SV_WriteDeltaEntities (client, msg, frame->fatpvs, &frame->truncated);
+	else
+		frame->overflowed = !SV_WriteEntitiesToClient (client->edict, msg, frame->fatpvs);
 
 // copy the server datagram if there is space
-	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
-		SZ_Write (&msg, sv.datagram.data, sv.datagram.cursize);
+	if (msg->cursize + sv.datagram.cursize < msg->maxsize)
+		SZ_Write (msg, sv.datagram.data, sv.datagram.cursize);
+}
+
+/*
+=======================
+SV_SendClientFrame
+=======================
+*/
+static qboolean SV_SendClientFrame (clientframe_t *frame)
+{
+	if (frame->overflowed)
+		Con_Printf ("packet overflow\n");
+	if (frame->truncated)
+		Con_DPrintf ("%s: more than %i entities visible\n", frame->client->name, MAX_DELTA_ENTITIES);
 
 // send the datagram
-	if (NET_SendUnreliableMessage (client->netconnection, &msg) == -1)
+	SV_StatsClientBytes (frame->client, frame->msg.cursize);
+	if (NET_SendUnreliableMessage (frame->client->netconnection, &frame->msg) == -1)
 	{
 		SV_DropClient (true);// if the message couldn't send, kick off
 		return false;
@@ -748,6 +1382,65 @@ qboolean SV_SendClientDatagram (client_t *client)
 	return true;
 }
 
+/*
+=======================
+SV_SendClientDatagram
+=======================
+*/
+qboolean SV_SendClientDatagram (client_t *client)
+{
+	clientframe_t	*frame;
+
+	frame = &sv_clientframes[client - svs.clients];
+	SV_SetupClientFrame (frame, client);
+	SV_BuildClientDatagram (frame, true);
+
+	return SV_SendClientFrame (frame);
+}
+
+static void SV_ClientFrameJob (void *data, int index)
+{
+	SV_BuildClientDatagram (((clientframe_t **)data)[index], false);
+}
+
+/*
+=======================
+SV_BuildClientFrames
+
+Builds the datagrams of all spawned clients on worker threads.  Returns
+false if sv_threads is off, in which case each datagram is built as it is
+sent.
+=======================
+*/
+static qboolean SV_BuildClientFrames (void)
+{
+	int			i, count;
+	client_t	*client;
+	clientframe_t	*jobs[MAX_SCOREBOARD];
+
+	if (sv_threads.value <= 1)
+		return false;
+
+	count = 0;
+	for (i=0, client = svs.clients ; i<svs.maxclients ; i++, client++)
+	{
+		if (!client->active || !client->spawned)
+			continue;
+		SV_SetupClientFrame (&sv_clientframes[i], client);
+		jobs[count++] = &sv_clientframes[i];
+	}
+	if (!count)
+		return false;
+
+// the ideal pitch only depends on sv_player, so the serial path computes
+// the same value for every client; do it once here instead
+	SV_SetIdealPitch ();
+
+	Sys_RunJobs (SV_ClientFrameJob, jobs, count, (int)sv_threads.value);
+
+	return true;
+}
+
 /*
 =======================
 SV_UpdateToReliableMessages
@@ -806,6 +1499,7 @@ void SV_SendNop (client_t *client)
 
 	MSG_WriteChar (&msg, svc_nop);
 
+	SV_StatsClientBytes (client, msg.cursize);
 	if (NET_SendUnreliableMessage (client->netconnection, &msg) == -1)
 		SV_DropClient (true);	// if the message couldn't send, kick off
 	client->last_message = realtime;
@@ -819,10 +1513,19 @@ SV_SendClientMessages
 void SV_SendClientMessages (void)
 {
 	int			i;
+	qboolean	prebuilt;
 	
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
+	if (sv_hotfields.value)
+		SV_HotSync ();
+
+	sv_fatpvsstamp++;
+
+// build the datagrams ahead of time if there are worker threads
+	prebuilt = SV_BuildClientFrames ();
+
 // build individual updates
 	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
 	{
@@ -831,7 +1534,15 @@ void SV_SendClientMessages (void)
 
 		if (host_client->spawned)
 		{
-			if (!SV_SendClientDatagram (host_client))
+			if (prebuilt)
+			{
+				if (!SV_SendClientFrame (&sv_clientframes[i]))
+				{
+					prebuilt = false;
+					continue;
+				}
+			}
+			else if (!SV_SendClientDatagram (host_client))
 				continue;
 		}
 		else
@@ -844,7 +1555,11 @@ void SV_SendClientMessages (void)
 			if (!host_client->sendsignon)
 			{
 				if (realtime - host_client->last_message > 5)
+				{
 					SV_SendNop (host_client);
+					if (!host_client->active)
+						prebuilt = false;
+				}
 				continue;	// don't send out non-signon messages
 			}
 		}
@@ -855,6 +1570,7 @@ void SV_SendClientMessages (void)
 		if (host_client->message.overflowed)
 		{
 			SV_DropClient (true);
+			prebuilt = false;
 			host_client->message.overflowed = false;
 			continue;
 		}
@@ -868,12 +1584,19 @@ void SV_SendClientMessages (void)
 			}
 
 			if (host_client->dropasap)
+			{
 				SV_DropClient (false);	// went to another level
+				prebuilt = false;
+			}
 			else
 			{
+				SV_StatsClientBytes (host_client, host_client->message.cursize);
 				if (NET_SendMessage (host_client->netconnection
 				, &host_client->message) == -1)
+				{
 					SV_DropClient (true);	// if the message couldn't send, kick off
+					prebuilt = false;
+				}
 				SZ_Clear (&host_client->message);
 				host_client->last_message = realtime;
 				host_client->sendsignon = false;
@@ -1032,6 +1755,43 @@ void SV_SaveSpawnparms (void)
 }
 
 
+/*
+================
+SV_PrefetchSpawn
+
+Reads the progs, the new map and the models the last map precached on the
+worker threads before the spawn loads them.  The spawn functions only name
+their models one at a time, but most maps share most of them, so the last
+map's list is the best guess there is.  Alias models that are still loaded
+are left out, as Mod_LoadModel won't read them again.  Has to be called
+before the last map is cleared out.
+================
+*/
+static void SV_PrefetchSpawn (char *server)
+{
+	static char	names[MAX_MODELS+1][MAX_QPATH];
+	char		*list[MAX_MODELS+1];
+	char		*name;
+	int			i, count;
+
+	strcpy (names[0], "progs.dat");
+	sprintf (names[1], "maps/%.*s.bsp", MAX_QPATH-10, server);
+	count = 2;
+
+	for (i=2 ; sv.active && i<MAX_MODELS && sv.model_precache[i] ; i++)
+	{
+		name = sv.model_precache[i];
+		if (name[0] == '*' || strlen (name) >= MAX_QPATH || !strcmp (name, names[1])
+		|| !Mod_WillLoad (name, true))
+			continue;
+		strcpy (names[count++], name);
+	}
+
+	for (i=0 ; i<count ; i++)
+		list[i] = names[i];
+	COM_PrefetchFiles (list, count);
+}
+
 /*
 ================
 SV_SpawnServer
@@ -1082,6 +1842,7 @@ void SV_SpawnServer (char *server)
 //
 // set up the new server
 //
+	SV_PrefetchSpawn (server);
 	Host_ClearMemory ();
 
 	memset (&sv, 0, sizeof(sv));
@@ -1099,6 +1860,7 @@ void SV_SpawnServer (char *server)
 	sv.max_edicts = MAX_EDICTS;
 
 	sv.edicts = Hunk_AllocName (sv.max_edicts*pr_edict_size, "edicts");
+	ED_Reindex ();
 
 	sv.datagram.maxsize = sizeof(sv.datagram_buf);
 	sv.datagram.cursize = 0;
@@ -1132,6 +1894,7 @@ void SV_SpawnServer (char *server)
 	{
 		Con_Printf ("Couldn't spawn server %s\n", sv.modelname);
 		sv.active = false;
+		COM_FreePrefetched ();
 		return;
 	}
 	sv.models[1] = sv.worldmodel;
@@ -1140,6 +1903,7 @@ void SV_SpawnServer (char *server)
 // clear world interaction links
 //
 	SV_ClearWorld ();
+	SV_ClearFatPVS ();
 
 	sv.sound_precache[0] = pr_strings;
 
@@ -1176,6 +1940,7 @@ void SV_SpawnServer (char *server)
 	pr_global_struct->serverflags = svs.serverflags;
 
 	ED_LoadFromFile (sv.worldmodel->entities);
+	COM_FreePrefetched ();
 
 	sv.active = true;
 
@@ -36,9 +36,10 @@ int c_yes, c_no;
 
 qboolean SV_CheckBottom (edict_t *ent)
 {
-	vec3_t	mins, maxs, start, stop;
-	trace_t	trace;
-	int		x, y;
+	vec3_t	mins, maxs, start;
+	batchmove_t	moves[5], *move;
+	trace_t	*trace;
+	int		i, x, y;
 	float	mid, bottom;
 	
 	VectorAdd (ent->v.origin, ent->v.mins, mins);
@@ -64,33 +65,47 @@ realcheck:
 	c_no++;
 //
 // check it for real...
+// the midpoint and the four corners are traced down together
 //
-	start[2] = mins[2];
-	
-// the midpoint must be within 16 of the bottom
-	start[0] = stop[0] = (mins[0] + maxs[0])*0.5;
-	start[1] = stop[1] = (mins[1] + maxs[1])*0.5;
-	stop[2] = start[2] - 2*STEPSIZE;
-	trace = SV_Move (start, vec3_origin, vec3_origin, stop, true, ent);
+	for (i=0 ; i<5 ; i++)
+	{
+		move = &moves[i];
+		if (!i)
+		{
+			move->start[0] = (mins[0] + maxs[0])*0.5;
+			move->start[1] = (mins[1] + maxs[1])*0.5;
+		}
+		else
+		{
+			move->start[0] = ((i-1) & 2) ? maxs[0] : mins[0];
+			move->start[1] = ((i-1) & 1) ? maxs[1] : mins[1];
+		}
+		move->start[2] = mins[2];
+		move->end[0] = move->start[0];
+		move->end[1] = move->start[1];
+		move->end[2] = mins[2] - 2*STEPSIZE;
+		VectorCopy (vec3_origin, move->mins);
+		VectorCopy (vec3_origin, move->maxs);
+		move->type = MOVE_NOMONSTERS;
+		move->passedict = ent;
+	}
+	SV_MoveBatch (moves, 5);
 
-	if (trace.fraction == 1.0)
+// the midpoint must be within 16 of the bottom
+	trace = &moves[0].trace;
+	if (trace->fraction == 1.0)
 		return false;
-	mid = bottom = trace.endpos[2];
+	mid = bottom = trace->endpos[2];
 	
 // the corners must be within 16 of the midpoint	
-	for	(x=0 ; x<=1 ; x++)
-		for	(y=0 ; y<=1 ; y++)
-		{
-			start[0] = stop[0] = x ? maxs[0] : mins[0];
-			start[1] = stop[1] = y ? maxs[1] : mins[1];
-			
-			trace = SV_Move (start, vec3_origin, vec3_origin, stop, true, ent);
-			
-			if (trace.fraction != 1.0 && trace.endpos[2] > bottom)
-				bottom = trace.endpos[2];
-			if (trace.fraction == 1.0 || mid - trace.endpos[2] > STEPSIZE)
-				return false;
-		}
+	for	(i=1 ; i<5 ; i++)
+	{
+		trace = &moves[i].trace;
+		if (trace->fraction != 1.0 && trace->endpos[2] > bottom)
+			bottom = trace->endpos[2];
+		if (trace->fraction == 1.0 || mid - trace->endpos[2] > STEPSIZE)
+			return false;
+	}
 
 	c_yes++;
 	return true;
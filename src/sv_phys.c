@@ -139,7 +139,9 @@ qboolean SV_RunThink (edict_t *ent)
 	pr_global_struct->time = thinktime;
 	pr_global_struct->self = EDICT_TO_PROG(ent);
 	pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
+	SV_StatsEnter (SVP_THINK);
 	PR_ExecuteProgram (ent->v.think);
+	SV_StatsLeave ();
 	return !ent->free;
 }
 
@@ -380,7 +382,7 @@ void SV_AddGravity (edict_t *ent)
 #else
 	eval_t	*val;
 
-	val = GetEdictFieldValue(ent, "gravity");
+	val = GETEDICTFIELDVALUE(ent, eval_gravity);
 	if (val && val->_float)
 		ent_gravity = val->_float;
 	else
@@ -400,12 +402,12 @@ PUSHMOVE
 
 /*
 ============
-SV_PushEntity
+SV_PushEntityTrace
 
-Does not change the entities velocity at all
+The trace SV_PushEntity clips the move with.  Only reads the world.
 ============
 */
-trace_t SV_PushEntity (edict_t *ent, vec3_t push)
+static trace_t SV_PushEntityTrace (edict_t *ent, vec3_t push)
 {
 	trace_t	trace;
 	vec3_t	end;
@@ -419,12 +421,39 @@ trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
 	else
 		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);	
-	
-	VectorCopy (trace.endpos, ent->v.origin);
+
+	return trace;
+}
+
+/*
+============
+SV_PushEntityLink
+
+Moves the entity to the end of the trace and runs the touch functions
+============
+*/
+static void SV_PushEntityLink (edict_t *ent, trace_t *trace)
+{
+	VectorCopy (trace->endpos, ent->v.origin);
 	SV_LinkEdict (ent, true);
 
-	if (trace.ent)
-		SV_Impact (ent, trace.ent);		
+	if (trace->ent)
+		SV_Impact (ent, trace->ent);		
+}
+
+/*
+============
+SV_PushEntity
+
+Does not change the entities velocity at all
+============
+*/
+trace_t SV_PushEntity (edict_t *ent, vec3_t push)
+{
+	trace_t	trace;
+
+	trace = SV_PushEntityTrace (ent, push);
+	SV_PushEntityLink (ent, &trace);
 
 	return trace;
 }					
@@ -511,8 +540,10 @@ void SV_PushMove (edict_t *pusher, float movetime)
 
 		// try moving the contacted entity 
 		pusher->v.solid = SOLID_NOT;
+		SV_HotChanged (pusher);
 		SV_PushEntity (check, move);
 		pusher->v.solid = SOLID_BSP;
+		SV_HotChanged (pusher);
 
 	// if it is still inside the pusher, block
 		block = SV_TestEntityPosition (check);
@@ -644,8 +675,10 @@ void SV_PushRotate (edict_t *pusher, float movetime)
 
 		// try moving the contacted entity 
 		pusher->v.solid = SOLID_NOT;
+		SV_HotChanged (pusher);
 		SV_PushEntity (check, move);
 		pusher->v.solid = SOLID_BSP;
+		SV_HotChanged (pusher);
 
 	// if it is still inside the pusher, block
 		block = SV_TestEntityPosition (check);
@@ -735,7 +768,9 @@ void SV_Physics_Pusher (edict_t *ent)
 		pr_global_struct->time = sv.time;
 		pr_global_struct->self = EDICT_TO_PROG(ent);
 		pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
+		SV_StatsEnter (SVP_THINK);
 		PR_ExecuteProgram (ent->v.think);
+		SV_StatsLeave ();
 		if (ent->free)
 			return;
 	}
@@ -1237,16 +1272,14 @@ void SV_CheckWaterTransition (edict_t *ent)
 
 /*
 =============
-SV_Physics_Toss
+SV_TossBegin
 
-Toss, bounce, and fly movement.  When onground, do nothing.
+Everything in SV_Physics_Toss up to the move.  Returns false if the entity
+is not going to move this frame.
 =============
 */
-void SV_Physics_Toss (edict_t *ent)
+static qboolean SV_TossBegin (edict_t *ent, vec3_t move)
 {
-	trace_t	trace;
-	vec3_t	move;
-	float	backoff;
 #ifdef QUAKE2
 	edict_t	*groundentity;
 
@@ -1259,7 +1292,7 @@ void SV_Physics_Toss (edict_t *ent)
 #endif
 	// regular thinking
 	if (!SV_RunThink (ent))
-		return;
+		return false;
 
 #ifdef QUAKE2
 	if (ent->v.velocity[2] > 0)
@@ -1268,7 +1301,7 @@ void SV_Physics_Toss (edict_t *ent)
 	if ( ((int)ent->v.flags & FL_ONGROUND) )
 //@@
 		if (VectorCompare(ent->v.basevelocity, vec_origin))
-			return;
+			return false;
 
 	SV_CheckVelocity (ent);
 
@@ -1282,7 +1315,7 @@ void SV_Physics_Toss (edict_t *ent)
 #else
 // if onground, return without moving
 	if ( ((int)ent->v.flags & FL_ONGROUND) )
-		return;
+		return false;
 
 	SV_CheckVelocity (ent);
 
@@ -1300,11 +1333,24 @@ void SV_Physics_Toss (edict_t *ent)
 	VectorAdd (ent->v.velocity, ent->v.basevelocity, ent->v.velocity);
 #endif
 	VectorScale (ent->v.velocity, host_frametime, move);
-	trace = SV_PushEntity (ent, move);
+	return true;
+}
+
+/*
+=============
+SV_TossEnd
+
+Everything in SV_Physics_Toss after the move
+=============
+*/
+static void SV_TossEnd (edict_t *ent, trace_t *trace)
+{
+	float	backoff;
+
 #ifdef QUAKE2
 	VectorSubtract (ent->v.velocity, ent->v.basevelocity, ent->v.velocity);
 #endif
-	if (trace.fraction == 1)
+	if (trace->fraction == 1)
 		return;
 	if (ent->free)
 		return;
@@ -1318,10 +1364,10 @@ void SV_Physics_Toss (edict_t *ent)
 	else
 		backoff = 1;
 
-	ClipVelocity (ent->v.velocity, trace.plane.normal, ent->v.velocity, backoff);
+	ClipVelocity (ent->v.velocity, trace->plane.normal, ent->v.velocity, backoff);
 
 // stop if on ground
-	if (trace.plane.normal[2] > 0.7)
+	if (trace->plane.normal[2] > 0.7)
 	{		
 #ifdef QUAKE2
 		if (ent->v.velocity[2] < 60 || (ent->v.movetype != MOVETYPE_BOUNCE && ent->v.movetype != MOVETYPE_BOUNCEMISSILE))
@@ -1330,7 +1376,7 @@ void SV_Physics_Toss (edict_t *ent)
 #endif
 		{
 			ent->v.flags = (int)ent->v.flags | FL_ONGROUND;
-			ent->v.groundentity = EDICT_TO_PROG(trace.ent);
+			ent->v.groundentity = EDICT_TO_PROG(trace->ent);
 			VectorCopy (vec3_origin, ent->v.velocity);
 			VectorCopy (vec3_origin, ent->v.avelocity);
 		}
@@ -1340,6 +1386,153 @@ void SV_Physics_Toss (edict_t *ent)
 	SV_CheckWaterTransition (ent);
 }
 
+/*
+=============
+SV_Physics_Toss
+
+Toss, bounce, and fly movement.  When onground, do nothing.
+=============
+*/
+void SV_Physics_Toss (edict_t *ent)
+{
+	trace_t	trace;
+	vec3_t	move;
+
+	if (!SV_TossBegin (ent, move))
+		return;
+
+	trace = SV_PushEntity (ent, move);
+
+	SV_TossEnd (ent, &trace);
+}
+
+/*
+===============================================================================
+
+PARALLEL TOSS
+
+With sv_parallelphysics set (and sv_threads > 1), toss, bounce and fly
+entities are not moved in the edict loop.  Their think functions still run
+there in edict order, and the move they want is queued.  After the loop the
+traces for all the queued moves are made on the worker threads against the
+world as the loop left it, with nothing linked or unlinked meanwhile.  Then
+each entity is moved, linked (touching triggers), and handed to SV_Impact in
+edict order on the main thread.
+
+So a projectile sees every other entity where it ended up this frame, and
+other projectiles where they started it, instead of whatever the edict
+order happened to give.  The result only depends on the world state, not
+on the number of threads.
+
+Moving a queued projectile is the only change the other traces may miss.
+Once anything else has been linked or unlinked since they were made (a
+touch or trigger removing, moving or spawning something, or a removed
+edict being reused), every later trace is made again on the main thread,
+against the world as it is at that point, before its projectile is moved.
+From there on the rest go as they would in the edict loop.
+
+===============================================================================
+*/
+
+cvar_t	sv_parallelphysics = {"sv_parallelphysics", "0"};
+
+#define	MIN_PARALLEL_TOSS	16		// fewer are traced on the main thread
+
+typedef struct
+{
+	edict_t		*ent;
+	vec3_t		move;
+	trace_t		trace;
+} tossmove_t;
+
+static	tossmove_t	sv_tossmoves[MAX_EDICTS];
+static	int			sv_numtossmoves;
+
+/*
+=============
+SV_QueueToss
+=============
+*/
+static void SV_QueueToss (edict_t *ent)
+{
+	tossmove_t	*toss;
+
+	toss = &sv_tossmoves[sv_numtossmoves];
+	if (!SV_TossBegin (ent, toss->move))
+		return;
+	toss->ent = ent;
+	sv_numtossmoves++;
+}
+
+/*
+=============
+SV_TossJob
+=============
+*/
+static void SV_TossJob (void *data, int i)
+{
+	tossmove_t	*toss;
+
+	toss = (tossmove_t *)data + i;
+	toss->trace = SV_PushEntityTrace (toss->ent, toss->move);
+}
+
+/*
+=============
+SV_RunQueuedTosses
+=============
+*/
+static void SV_RunQueuedTosses (void)
+{
+	int			i, changes;
+	qboolean	stale;
+	tossmove_t	*toss;
+	edict_t		*ent;
+	extern	cvar_t	sv_threads;
+
+	if (!sv_numtossmoves)
+		return;
+
+	sv_stattraces += sv_numtossmoves;	// SV_Move doesn't count on the workers
+	if (sv_hotfields.value)
+		SV_HotSync ();		// nor sync sv_hot
+	sv_parallelmoves = true;
+	if (sv_numtossmoves < MIN_PARALLEL_TOSS)
+	{
+		for (i=0 ; i<sv_numtossmoves ; i++)
+			SV_TossJob (sv_tossmoves, i);
+	}
+	else
+		Sys_RunJobs (SV_TossJob, sv_tossmoves, sv_numtossmoves, (int)sv_threads.value);
+	sv_parallelmoves = false;
+	changes = sv_worldchanges;
+	stale = false;
+
+// the touches, in edict order
+	for (i=0, toss=sv_tossmoves ; i<sv_numtossmoves ; i++, toss++)
+	{
+		ent = toss->ent;
+		if (ent->free)
+			continue;		// removed by an earlier touch
+		if (sv_worldchanges != changes)
+			stale = true;
+		if (stale)
+			toss->trace = SV_PushEntityTrace (ent, toss->move);	// out of date
+
+	// SV_PushEntityLink, with its own move left out of the changes
+		VectorCopy (toss->trace.endpos, ent->v.origin);
+		SV_LinkEdict (ent, false);
+		changes = sv_worldchanges;
+		SV_TouchTriggers (ent);
+		if (toss->trace.ent)
+			SV_Impact (ent, toss->trace.ent);
+
+		SV_TossEnd (ent, &toss->trace);
+	}
+
+	sv_numtossmoves = 0;
+}
+
 /*
 ===============================================================================
 
@@ -1508,21 +1701,28 @@ void SV_Physics (void)
 {
 	int		i;
 	edict_t	*ent;
+	qboolean	paralleltoss;
+	extern	cvar_t	sv_threads;
 
 // let the progs know that a new frame has started
 	pr_global_struct->self = EDICT_TO_PROG(sv.edicts);
 	pr_global_struct->other = EDICT_TO_PROG(sv.edicts);
 	pr_global_struct->time = sv.time;
+	SV_StatsEnter (SVP_STARTFRAME);
 	PR_ExecuteProgram (pr_global_struct->StartFrame);
+	SV_StatsLeave ();
 
 //SV_CheckAllEnts ();
 
+	paralleltoss = sv_parallelphysics.value && sv_threads.value > 1;
+
 //
-// treat each object in turn
+// treat each object in turn, skipping the ones with nothing to do
 //
-	ent = sv.edicts;
-	for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
+	SV_ThinkBeginFrame ();
+	for (i = SV_ThinkNext (-1) ; i<sv.num_edicts ; i = SV_ThinkNext (i))
 	{
+		ent = EDICT_NUM(i);
 		if (ent->free)
 			continue;
 
@@ -1532,19 +1732,37 @@ void SV_Physics (void)
 		}
 
 		if (i > 0 && i <= svs.maxclients)
+		{
+			SV_StatsEnter (SVP_CLIENT);
 			SV_Physics_Client (ent, i);
+		}
 		else if (ent->v.movetype == MOVETYPE_PUSH)
+		{
+			SV_StatsEnter (SVP_PUSH);
 			SV_Physics_Pusher (ent);
+		}
 		else if (ent->v.movetype == MOVETYPE_NONE)
+		{
+			SV_StatsEnter (SVP_NONE);
 			SV_Physics_None (ent);
+		}
 #ifdef QUAKE2
 		else if (ent->v.movetype == MOVETYPE_FOLLOW)
+		{
+			SV_StatsEnter (SVP_NONE);
 			SV_Physics_Follow (ent);
+		}
 #endif
 		else if (ent->v.movetype == MOVETYPE_NOCLIP)
+		{
+			SV_StatsEnter (SVP_NOCLIP);
 			SV_Physics_Noclip (ent);
+		}
 		else if (ent->v.movetype == MOVETYPE_STEP)
+		{
+			SV_StatsEnter (SVP_STEP);
 			SV_Physics_Step (ent);
+		}
 		else if (ent->v.movetype == MOVETYPE_TOSS 
 		|| ent->v.movetype == MOVETYPE_BOUNCE
 #ifdef QUAKE2
@@ -1552,10 +1770,21 @@ void SV_Physics (void)
 #endif
 		|| ent->v.movetype == MOVETYPE_FLY
 		|| ent->v.movetype == MOVETYPE_FLYMISSILE)
-			SV_Physics_Toss (ent);
+		{
+			SV_StatsEnter (SVP_TOSS);
+			if (paralleltoss)
+				SV_QueueToss (ent);
+			else
+				SV_Physics_Toss (ent);
+		}
 		else
 			Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);			
+		SV_StatsLeave ();
 	}
+
+	SV_StatsEnter (SVP_TOSS);
+	SV_RunQueuedTosses ();
+	SV_StatsLeave ();
 	
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;	
@@ -0,0 +1,342 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_stats.c -- server tick profiler
+
+#include "quakedef.h"
+
+#define	STATS_WINDOW	1024		// ticks kept for the percentiles, power of two
+#define	STATS_DEPTH		8			// nested phases
+
+// per tick series recorded after the phases
+enum {
+	STAT_TICK = SVP_NUMPHASES,	// sum of the phases, ms
+	STAT_TRACES,
+	STAT_LINKS,
+	STAT_BYTES,					// sent to all clients
+	NUM_STATSERIES
+};
+
+static char *sv_statnames[NUM_STATSERIES] =
+{
+	"frame",
+	"netpoll",
+	"newclients",
+	"runclients",
+	"startframe",
+	"client",
+	"push",
+	"none",
+	"noclip",
+	"step",
+	"toss",
+	"think",
+	"send",
+	"tick",
+	"traces",
+	"links",
+	"bytes"
+};
+
+cvar_t	sv_profile = {"sv_profile", "0"};
+cvar_t	sv_statslog = {"sv_statslog", "0"};	// seconds between sv_stats.csv rows, 0 = off
+
+int		sv_stattraces;		// SV_Move traces this tick
+int		sv_statlinks;		// SV_LinkEdict calls this tick
+
+static qboolean	sv_statsactive;		// sv_profile, latched at the start of the tick
+static double	sv_phasetime[SVP_NUMPHASES];	// seconds, not counting nested phases
+static int		sv_clientbytes[MAX_SCOREBOARD];
+
+static svphase_t	sv_phasestack[STATS_DEPTH];
+static int		sv_phasedepth;
+static double	sv_phasemark;
+
+static float	sv_statring[NUM_STATSERIES][STATS_WINDOW];
+static float	sv_clientring[MAX_SCOREBOARD][STATS_WINDOW];
+static int		sv_statticks;		// recorded since the last reset
+static int		sv_statoverruns;
+static int		sv_logticks;		// recorded since the last csv row
+static int		sv_logoverruns;
+static double	sv_lastlog;
+
+/*
+==================
+SV_StatsEnter
+
+Time from here to the matching SV_StatsLeave is charged to phase, and
+stops being charged to the phase it interrupted.
+==================
+*/
+void SV_StatsEnter (svphase_t phase)
+{
+	double	now;
+
+	if (!sv_statsactive)
+		return;
+	if (sv_phasedepth == STATS_DEPTH)
+		Sys_Error ("SV_StatsEnter: phases nested too deep");
+
+	now = Sys_FloatTime ();
+	if (sv_phasedepth)
+		sv_phasetime[sv_phasestack[sv_phasedepth-1]] += now - sv_phasemark;
+	sv_phasestack[sv_phasedepth++] = phase;
+	sv_phasemark = now;
+}
+
+/*
+==================
+SV_StatsLeave
+==================
+*/
+void SV_StatsLeave (void)
+{
+	double	now;
+
+	if (!sv_statsactive)
+		return;
+	if (!sv_phasedepth)
+		Sys_Error ("SV_StatsLeave: not in a phase");
+
+	now = Sys_FloatTime ();
+	sv_phasetime[sv_phasestack[--sv_phasedepth]] += now - sv_phasemark;
+	sv_phasemark = now;
+}
+
+/*
+==================
+SV_StatsClientBytes
+==================
+*/
+void SV_StatsClientBytes (client_t *client, int bytes)
+{
+	sv_clientbytes[client - svs.clients] += bytes;
+}
+
+/*
+==================
+SV_StatsBeginTick
+==================
+*/
+void SV_StatsBeginTick (void)
+{
+	sv_phasedepth = 0;		// a Host_Error can leave phases open
+	sv_statsactive = sv_profile.value != 0;
+	SV_StatsEnter (SVP_FRAME);
+}
+
+/*
+==================
+SV_StatsPercentiles
+
+Over the last count ticks of a series.
+==================
+*/
+static int SV_StatsCompare (const void *a, const void *b)
+{
+	float	fa, fb;
+
+	fa = *(float *)a;
+	fb = *(float *)b;
+	if (fa < fb)
+		return -1;
+	return fa > fb;
+}
+
+static void SV_StatsPercentiles (float *ring, int count, float *p50, float *p99, float *max)
+{
+	static float	sorted[STATS_WINDOW];
+	int		i;
+
+	if (count > sv_statticks)
+		count = sv_statticks;
+	if (count > STATS_WINDOW)
+		count = STATS_WINDOW;
+	if (count <= 0)
+	{
+		*p50 = *p99 = *max = 0;
+		return;
+	}
+
+	for (i=0 ; i<count ; i++)
+		sorted[i] = ring[(sv_statticks - count + i) & (STATS_WINDOW-1)];
+	qsort (sorted, count, sizeof(sorted[0]), SV_StatsCompare);
+
+	*p50 = sorted[(count-1)*50/100];
+	*p99 = sorted[(count-1)*99/100];
+	*max = sorted[count-1];
+}
+
+/*
+==================
+SV_StatsLog
+
+Appends a row covering the ticks since the last one to sv_stats.csv.
+==================
+*/
+static void SV_StatsLog (void)
+{
+	FILE	*f;
+	int		i, clients;
+	float	p50, p99, max;
+
+	sv_lastlog = realtime;
+
+	f = fopen (va("%s/sv_stats.csv", com_gamedir), "a");
+	if (!f)
+	{
+		Con_Printf ("Couldn't append to sv_stats.csv, logging stopped\n");
+		Cvar_SetValue ("sv_statslog", 0);
+		return;
+	}
+
+	fseek (f, 0, SEEK_END);
+	if (!ftell (f))
+	{
+		fprintf (f, "time,map,ticks,overruns,clients");
+		for (i=0 ; i<NUM_STATSERIES ; i++)
+			fprintf (f, ",%s_p50,%s_p99,%s_max", sv_statnames[i], sv_statnames[i], sv_statnames[i]);
+		fprintf (f, "\n");
+	}
+
+	clients = 0;
+	for (i=0 ; i<svs.maxclients ; i++)
+		if (svs.clients[i].active)
+			clients++;
+
+	fprintf (f, "%.1f,%s,%i,%i,%i", realtime, sv.name, sv_logticks, sv_logoverruns, clients);
+	for (i=0 ; i<NUM_STATSERIES ; i++)
+	{
+		SV_StatsPercentiles (sv_statring[i], sv_logticks, &p50, &p99, &max);
+		fprintf (f, ",%g,%g,%g", p50, p99, max);
+	}
+	fprintf (f, "\n");
+	fclose (f);
+
+	sv_logticks = 0;
+	sv_logoverruns = 0;
+}
+
+/*
+==================
+SV_StatsEndTick
+
+Records this tick into the rolling window.  A tick that takes longer than
+sys_ticrate counts as an overrun.
+==================
+*/
+void SV_StatsEndTick (void)
+{
+	int		i, slot, bytes;
+	float	total;
+
+	if (sv_statsactive)
+	{
+		SV_StatsLeave ();		// SVP_FRAME
+
+		slot = sv_statticks & (STATS_WINDOW-1);
+		total = 0;
+		for (i=0 ; i<SVP_NUMPHASES ; i++)
+		{
+			sv_statring[i][slot] = sv_phasetime[i] * 1000;
+			total += sv_statring[i][slot];
+		}
+		sv_statring[STAT_TICK][slot] = total;
+		sv_statring[STAT_TRACES][slot] = sv_stattraces;
+		sv_statring[STAT_LINKS][slot] = sv_statlinks;
+
+		bytes = 0;
+		for (i=0 ; i<MAX_SCOREBOARD ; i++)
+		{
+			sv_clientring[i][slot] = sv_clientbytes[i];
+			bytes += sv_clientbytes[i];
+		}
+		sv_statring[STAT_BYTES][slot] = bytes;
+
+		if (total > sys_ticrate.value * 1000)
+		{
+			sv_statoverruns++;
+			sv_logoverruns++;
+		}
+		sv_statticks++;
+		sv_logticks++;
+
+		if (sv_statslog.value > 0 && realtime - sv_lastlog >= sv_statslog.value)
+			SV_StatsLog ();
+	}
+
+	memset (sv_phasetime, 0, sizeof(sv_phasetime));
+	memset (sv_clientbytes, 0, sizeof(sv_clientbytes));
+	sv_stattraces = 0;
+	sv_statlinks = 0;
+}
+
+/*
+==================
+SV_Stats_f
+
+sv_stats [reset]
+==================
+*/
+void SV_Stats_f (void)
+{
+	int		i, count;
+	float	p50, p99, max;
+	client_t	*client;
+
+	if (Cmd_Argc () > 1 && !Q_strcmp (Cmd_Argv(1), "reset"))
+	{
+		sv_statticks = sv_statoverruns = 0;
+		sv_logticks = sv_logoverruns = 0;
+		return;
+	}
+
+	if (!sv_statticks)
+	{
+		Con_Printf ("no ticks recorded%s\n", sv_profile.value ? "" : ", set sv_profile 1");
+		return;
+	}
+
+	count = sv_statticks < STATS_WINDOW ? sv_statticks : STATS_WINDOW;
+	Con_Printf ("last %i ticks, %i of %i over %.1f ms\n", count,
+		sv_statoverruns, sv_statticks, sys_ticrate.value * 1000);
+
+	Con_Printf ("ms              p50     p99     max\n");
+	for (i=0 ; i<=STAT_TICK ; i++)
+	{
+		SV_StatsPercentiles (sv_statring[i], count, &p50, &p99, &max);
+		Con_Printf ("%-12s %7.3f %7.3f %7.3f\n", sv_statnames[i], p50, p99, max);
+	}
+
+	Con_Printf ("per tick        p50     p99     max\n");
+	for ( ; i<NUM_STATSERIES ; i++)
+	{
+		SV_StatsPercentiles (sv_statring[i], count, &p50, &p99, &max);
+		Con_Printf ("%-12s %7.0f %7.0f %7.0f\n", sv_statnames[i], p50, p99, max);
+	}
+
+	Con_Printf ("client bytes    p50     p99     max\n");
+	for (i=0, client = svs.clients ; i<svs.maxclients ; i++, client++)
+	{
+		if (!client->active)
+			continue;
+		SV_StatsPercentiles (sv_clientring[i], count, &p50, &p99, &max);
+		Con_Printf ("%-12.12s %7.0f %7.0f %7.0f\n", client->name, p50, p99, max);
+	}
+}
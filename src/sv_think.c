@@ -0,0 +1,326 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sv_think.c -- which edicts SV_Physics has to visit
+
+/*
+Most edicts in a level are MOVETYPE_NONE: triggers, items, lights and the
+like.  SV_Physics used to visit every one of them each frame for
+SV_RunThink to find nothing due.  Now it only visits the clients, the
+edicts with some other movetype, and the MOVETYPE_NONE edicts whose
+nextthink falls in this frame, still in edict order.
+
+The MOVETYPE_NONE edicts wait on a heap ordered by nextthink.  The progs
+can only write a field after taking its address with OP_ADDRESS, so taking
+the address of nextthink or movetype, or an OP_STATE, marks the edict, as
+do clearing, parsing and freeing it.  Marked edicts are looked at again
+between the edicts SV_Physics runs, so one that is made due by an edict
+before it still thinks in the same frame.  A heap entry whose edict has
+since been given another nextthink is dropped when it comes up.
+
+With force_retouch set every edict is visited, as it always was.
+*/
+
+#include "quakedef.h"
+
+#define	THINK_WORDS		((MAX_EDICTS+31)/32)
+#define	THINK_HEAPSIZE	(MAX_EDICTS*4)
+
+typedef struct
+{
+	float	time;			// nextthink when it was pushed
+	int		num;
+} thinkentry_t;
+
+cvar_t	sv_thinkqueue = {"sv_thinkqueue", "1"};
+
+static unsigned	think_active[THINK_WORDS];	// visited every frame
+static unsigned	think_due[THINK_WORDS];		// to think this frame
+static unsigned	think_dirty[THINK_WORDS];	// nextthink or movetype may have changed
+static qboolean	think_anydirty;
+static qboolean	think_rebuild = true;
+
+static thinkentry_t	think_heap[THINK_HEAPSIZE];
+static int		think_heapsize;
+
+/*
+============
+SV_ThinkReset
+
+The edicts have been overwritten, so look at all of them again before the
+next frame
+============
+*/
+void SV_ThinkReset (void)
+{
+	think_rebuild = true;
+}
+
+/*
+============
+SV_ThinkChanged
+
+ed's nextthink or movetype may have been written, or it has been cleared,
+parsed or freed
+============
+*/
+void SV_ThinkChanged (edict_t *ed)
+{
+	int		e;
+
+	e = NUM_FOR_EDICT(ed);
+	think_dirty[e>>5] |= 1<<(e&31);
+	think_anydirty = true;
+}
+
+/*
+============
+SV_ThinkWaits
+
+True for the edicts that SV_Physics only runs SV_RunThink on
+============
+*/
+static qboolean SV_ThinkWaits (edict_t *ed, int e)
+{
+	if (e > 0 && e <= svs.maxclients)
+		return false;
+	return ed->v.movetype == MOVETYPE_NONE;
+}
+
+/*
+============
+SV_ThinkIsDue
+
+The same test as SV_RunThink
+============
+*/
+static qboolean SV_ThinkIsDue (float thinktime)
+{
+	return thinktime > 0 && thinktime <= sv.time + host_frametime;
+}
+
+/*
+============
+SV_ThinkPush
+============
+*/
+static void SV_ThinkPush (float time, int e)
+{
+	int		i, parent;
+
+	if (think_heapsize == THINK_HEAPSIZE)
+	{	// mostly entries that have been superseded
+		think_rebuild = true;
+		return;
+	}
+
+	for (i = think_heapsize++ ; i > 0 ; i = parent)
+	{
+		parent = (i-1)/2;
+		if (think_heap[parent].time <= time)
+			break;
+		think_heap[i] = think_heap[parent];
+	}
+	think_heap[i].time = time;
+	think_heap[i].num = e;
+}
+
+/*
+============
+SV_ThinkPop
+============
+*/
+static void SV_ThinkPop (void)
+{
+	thinkentry_t	last;
+	int				i, child;
+
+	last = think_heap[--think_heapsize];
+	for (i = 0 ; (child = i*2+1) < think_heapsize ; i = child)
+	{
+		if (child+1 < think_heapsize && think_heap[child+1].time < think_heap[child].time)
+			child++;
+		if (last.time <= think_heap[child].time)
+			break;
+		think_heap[i] = think_heap[child];
+	}
+	think_heap[i] = last;
+}
+
+/*
+============
+SV_ThinkClassify
+
+Files e as visited every frame, waiting on the heap, or neither.  It is
+due this frame only if SV_Physics hasn't got past it yet.
+============
+*/
+static void SV_ThinkClassify (int e, int current)
+{
+	edict_t		*ed;
+	unsigned	bit;
+	int			w;
+
+	ed = EDICT_NUM(e);
+	w = e>>5;
+	bit = 1<<(e&31);
+
+	think_due[w] &= ~bit;
+	if (ed->free)
+	{
+		think_active[w] &= ~bit;
+		return;
+	}
+	if (!SV_ThinkWaits (ed, e))
+	{
+		think_active[w] |= bit;
+		return;
+	}
+
+	think_active[w] &= ~bit;
+	if (ed->v.nextthink <= 0)
+		return;
+	SV_ThinkPush (ed->v.nextthink, e);
+	if (e > current && SV_ThinkIsDue (ed->v.nextthink))
+		think_due[w] |= bit;
+}
+
+/*
+============
+SV_ThinkRebuild
+============
+*/
+static void SV_ThinkRebuild (int current)
+{
+	int		e;
+
+	memset (think_active, 0, sizeof(think_active));
+	memset (think_due, 0, sizeof(think_due));
+	memset (think_dirty, 0, sizeof(think_dirty));
+	think_anydirty = false;
+	think_heapsize = 0;
+	think_rebuild = false;
+
+	for (e=0 ; e<sv.num_edicts ; e++)
+		SV_ThinkClassify (e, current);
+}
+
+/*
+============
+SV_ThinkFlush
+
+Catches up with the marked edicts, SV_Physics having run up to current
+============
+*/
+static void SV_ThinkFlush (int current)
+{
+	int			w, e;
+	unsigned	bits;
+
+	if (think_anydirty && !think_rebuild)
+	{
+		for (w=0 ; w<THINK_WORDS ; w++)
+		{
+			bits = think_dirty[w];
+			if (!bits)
+				continue;
+			think_dirty[w] = 0;
+			for (e = w<<5 ; bits ; bits >>= 1, e++)
+				if ((bits & 1) && e < sv.num_edicts)
+					SV_ThinkClassify (e, current);
+		}
+		think_anydirty = false;
+	}
+
+	if (think_rebuild)
+		SV_ThinkRebuild (current);
+}
+
+/*
+============
+SV_ThinkBeginFrame
+
+Called by SV_Physics after StartFrame.  Moves the edicts whose nextthink
+has come up from the heap into this frame.
+============
+*/
+void SV_ThinkBeginFrame (void)
+{
+	thinkentry_t	top;
+	edict_t			*ed;
+
+	if (!sv_thinkqueue.value)
+	{
+		think_rebuild = true;
+		return;
+	}
+
+	SV_ThinkFlush (-1);
+
+	while (think_heapsize && SV_ThinkIsDue (think_heap[0].time))
+	{
+		top = think_heap[0];
+		SV_ThinkPop ();
+		if (top.num >= sv.num_edicts)
+			continue;
+		ed = EDICT_NUM(top.num);
+		if (ed->free || ed->v.nextthink != top.time || !SV_ThinkWaits (ed, top.num))
+			continue;
+		think_due[top.num>>5] |= 1<<(top.num&31);
+	}
+}
+
+/*
+============
+SV_ThinkNext
+
+The next edict after i for SV_Physics to run, sv.num_edicts when there
+are no more
+============
+*/
+int SV_ThinkNext (int i)
+{
+	int			e, w;
+	unsigned	bits;
+
+	if (!sv_thinkqueue.value)
+		return i+1;
+
+	if (i >= 0)
+		think_due[i>>5] &= ~(1<<(i&31));
+	SV_ThinkFlush (i);
+
+	if (pr_global_struct->force_retouch)
+		return i+1;
+
+	for (e = i+1 ; e < sv.num_edicts ; e = (w+1)<<5)
+	{
+		w = e>>5;
+		bits = (think_active[w] | think_due[w]) >> (e&31);
+		if (!bits)
+			continue;
+		while (!(bits & 1))
+		{
+			bits >>= 1;
+			e++;
+		}
+		return e < sv.num_edicts ? e : sv.num_edicts;
+	}
+	return sv.num_edicts;
+}
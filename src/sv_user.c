@@ -569,6 +569,8 @@ nextmsg:
 					ret = 1;
 				else if (Q_strncasecmp(s, "ban", 3) == 0)
 					ret = 1;
+				else if (Q_strncasecmp(s, "deltaentities", 13) == 0)
+					ret = 1;
 				if (ret == 2)
 					Cbuf_InsertText (s);
 				else if (ret == 1)
@@ -584,6 +586,10 @@ nextmsg:
 			case clc_move:
 				SV_ReadClientMove (&host_client->cmd);
 				break;
+
+			case clc_deltaack:
+				host_client->deltaack = MSG_ReadLong ();
+				break;
 			}
 		}
 	} while (ret == 1);
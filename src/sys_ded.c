@@ -0,0 +1,586 @@
+/*
+Copyright (C) 1996-1997 Id Software, Inc.
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// sys_ded.c -- headless system driver for the dedicated server
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#include <fcntl.h>
+#include <conio.h>
+#define mkdir(path, mode) _mkdir(path)
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#endif
+
+#include "quakedef.h"
+
+qboolean isDedicated = true;
+
+static int nostdout = 0;
+
+static char *basedir = ".";
+
+// =======================================================================
+// General routines
+// =======================================================================
+
+void Sys_DebugNumber(int y, int val)
+{
+}
+
+void Sys_Printf(char *fmt, ...)
+{
+    va_list argptr;
+    char text[1024];
+
+    va_start(argptr, fmt);
+    vsnprintf(text, sizeof(text), fmt, argptr);
+    va_end(argptr);
+
+    if (nostdout)
+        return;
+
+    printf("%s", text);
+    fflush(stdout);
+}
+
+void Sys_Quit(void)
+{
+    Host_Shutdown();
+    exit(0);
+}
+
+void Sys_Init(void)
+{
+}
+
+void Sys_Error(char *error, ...)
+{
+    va_list argptr;
+    char string[1024];
+
+    va_start(argptr, error);
+    vsnprintf(string, sizeof(string), error, argptr);
+    va_end(argptr);
+
+    fprintf(stderr, "Error: %s\n", string);
+
+    Host_Shutdown();
+    exit(1);
+}
+
+void Sys_Warn(char *warning, ...)
+{
+    va_list argptr;
+    char string[1024];
+
+    va_start(argptr, warning);
+    vsnprintf(string, sizeof(string), warning, argptr);
+    va_end(argptr);
+
+    fprintf(stderr, "Warning: %s", string);
+}
+
+/*
+============
+Sys_FileTime
+
+returns -1 if not present
+============
+*/
+int Sys_FileTime(char *path)
+{
+    struct stat buf;
+
+    if (stat(path, &buf) == -1)
+        return -1;
+
+    return buf.st_mtime;
+}
+
+void Sys_mkdir(char *path)
+{
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0777);
+#endif
+}
+
+int Sys_FileOpenRead(char *path, int *handle)
+{
+    int h;
+
+#ifdef _WIN32
+    struct _stat fileinfo;
+    h = _open(path, _O_RDONLY | _O_BINARY);
+#else
+    struct stat fileinfo;
+    h = open(path, O_RDONLY);
+#endif
+    *handle = h;
+    if (h == -1)
+        return -1;
+
+#ifdef _WIN32
+    if (_fstat(h, &fileinfo) == -1)
+#else
+    if (fstat(h, &fileinfo) == -1)
+#endif
+        Sys_Error("Error fstating %s", path);
+
+    return fileinfo.st_size;
+}
+
+int Sys_FileOpenWrite(char *path)
+{
+    int handle;
+
+#ifdef _WIN32
+    handle = _open(path, _O_RDWR | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+    umask(0);
+    handle = open(path, O_RDWR | O_CREAT | O_TRUNC, 0666);
+#endif
+
+    if (handle == -1)
+        Sys_Error("Error opening %s: %s", path, strerror(errno));
+
+    return handle;
+}
+
+int Sys_FileWrite(int handle, void *src, int count)
+{
+#ifdef _WIN32
+    return _write(handle, src, count);
+#else
+    return write(handle, src, count);
+#endif
+}
+
+void Sys_FileClose(int handle)
+{
+#ifdef _WIN32
+    _close(handle);
+#else
+    close(handle);
+#endif
+}
+
+void Sys_FileSeek(int handle, int position)
+{
+#ifdef _WIN32
+    _lseek(handle, position, SEEK_SET);
+#else
+    lseek(handle, position, SEEK_SET);
+#endif
+}
+
+int Sys_FileRead(int handle, void *dest, int count)
+{
+#ifdef _WIN32
+    return _read(handle, dest, count);
+#else
+    return read(handle, dest, count);
+#endif
+}
+
+void *Sys_FileMap(int handle, int length)
+{
+#ifdef _WIN32
+    return NULL;
+#else
+    void *base;
+
+    if (length <= 0)
+        return NULL;
+    base = mmap(NULL, length, PROT_READ, MAP_SHARED, handle, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    return base;
+#endif
+}
+
+void Sys_DebugLog(char *file, char *fmt, ...)
+{
+    va_list argptr;
+    static char data[1024];
+    int fd;
+
+    va_start(argptr, fmt);
+    vsnprintf(data, sizeof(data), fmt, argptr);
+    va_end(argptr);
+
+#ifdef _WIN32
+    fd = _open(file, _O_WRONLY | _O_CREAT | _O_APPEND, _S_IREAD | _S_IWRITE);
+    if (fd != -1) {
+        _write(fd, data, strlen(data));
+        _close(fd);
+    }
+#else
+    fd = open(file, O_WRONLY | O_CREAT | O_APPEND, 0666);
+    if (fd != -1) {
+        write(fd, data, strlen(data));
+        close(fd);
+    }
+#endif
+}
+
+/*
+================
+Sys_FloatTime
+================
+*/
+double Sys_FloatTime(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq, base;
+    LARGE_INTEGER now;
+
+    if (freq.QuadPart == 0) {
+        QueryPerformanceFrequency(&freq);
+        QueryPerformanceCounter(&base);
+    }
+
+    QueryPerformanceCounter(&now);
+    return (double)(now.QuadPart - base.QuadPart) / (double)freq.QuadPart;
+#else
+    static struct timespec base;
+    struct timespec now;
+
+    if (base.tv_sec == 0 && base.tv_nsec == 0)
+        clock_gettime(CLOCK_MONOTONIC, &base);
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - base.tv_sec) + (now.tv_nsec - base.tv_nsec) * 1e-9;
+#endif
+}
+
+/*
+================
+Sys_ConsoleInput
+
+Returns a complete line typed on stdin, or NULL if nothing is pending.
+================
+*/
+char *Sys_ConsoleInput(void)
+{
+    static char text[256];
+    static int len;
+#ifdef _WIN32
+    int c;
+
+    while (_kbhit()) {
+        c = _getch();
+        if (c == '\r' || c == '\n') {
+            putchar('\n');
+            text[len] = 0;
+            len = 0;
+            return text;
+        }
+        if (c == '\b') {
+            if (len) {
+                len--;
+                fputs("\b \b", stdout);
+            }
+            continue;
+        }
+        if (len < (int)sizeof(text) - 1) {
+            putchar(c);
+            text[len++] = c;
+        }
+    }
+    return NULL;
+#else
+    fd_set fdset;
+    struct timeval timeout;
+    int n;
+
+    FD_ZERO(&fdset);
+    FD_SET(0, &fdset);
+    timeout.tv_sec = 0;
+    timeout.tv_usec = 0;
+    if (select(1, &fdset, NULL, NULL, &timeout) <= 0 || !FD_ISSET(0, &fdset))
+        return NULL;
+
+    n = read(0, text + len, sizeof(text) - 1 - len);
+    if (n <= 0)
+        return NULL;        // closed or not a terminal
+    len += n;
+    text[len] = 0;
+
+    if (text[len - 1] != '\n' && len < (int)sizeof(text) - 1)
+        return NULL;        // wait for the rest of the line
+
+    text[len - 1] = 0;      // rip off the \n and terminate
+    len = 0;
+    return text;
+#endif
+}
+
+void Sys_HighFPPrecision(void)
+{
+}
+
+void Sys_LowFPPrecision(void)
+{
+}
+
+void Sys_SetFPCW(void)
+{
+}
+
+void Sys_Sleep(void)
+{
+#ifdef _WIN32
+    Sleep(1);
+#else
+    usleep(1000);
+#endif
+}
+
+void Sys_SendKeyEvents(void)
+{
+}
+
+// =======================================================================
+// Worker threads
+// =======================================================================
+
+#ifdef _WIN32
+
+int Sys_NumProcessors(void)
+{
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors;
+}
+
+/*
+================
+Sys_RunJobs
+
+The headless Windows build has no worker pool; jobs run in order.
+================
+*/
+void Sys_RunJobs(sys_jobfunc_t func, void *data, int count, int numthreads)
+{
+    int i;
+
+    for (i = 0; i < count; i++)
+        func(data, i);
+}
+
+#else
+
+#define MAX_WORKERS 16
+
+static pthread_t workers[MAX_WORKERS];
+static int numworkers;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t job_start = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t job_done = PTHREAD_COND_INITIALIZER;
+static int job_generation;
+static int job_helpers;
+static int job_finished;
+static int job_next;
+static sys_jobfunc_t job_func;
+static void *job_data;
+static int job_count;
+static qboolean job_active;
+
+int Sys_NumProcessors(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (int)n : 1;
+}
+
+static void Sys_DoJobs(void)
+{
+    int i;
+
+    while ((i = __sync_fetch_and_add(&job_next, 1)) < job_count)
+        job_func(job_data, i);
+}
+
+static void *Sys_WorkerThread(void *arg)
+{
+    int index = (int)(intptr_t)arg;
+    int seen = 0;
+
+    while (1) {
+        pthread_mutex_lock(&job_lock);
+        while (job_generation == seen || index >= job_helpers)
+        {
+            seen = job_generation;
+            pthread_cond_wait(&job_start, &job_lock);
+        }
+        seen = job_generation;
+        pthread_mutex_unlock(&job_lock);
+
+        Sys_DoJobs();
+
+        pthread_mutex_lock(&job_lock);
+        if (++job_finished == job_helpers)
+            pthread_cond_signal(&job_done);
+        pthread_mutex_unlock(&job_lock);
+    }
+    return NULL;
+}
+
+/*
+================
+Sys_RunJobs
+
+Same contract as the SDL driver: the pool is grown on demand and kept for
+the life of the process, and nested calls run serially.
+================
+*/
+void Sys_RunJobs(sys_jobfunc_t func, void *data, int count, int numthreads)
+{
+    int i, helpers;
+
+    if (numthreads > count)
+        numthreads = count;
+    helpers = numthreads - 1;
+    if (helpers > MAX_WORKERS)
+        helpers = MAX_WORKERS;
+
+    while (numworkers < helpers && !job_active) {
+        if (pthread_create(&workers[numworkers], NULL, Sys_WorkerThread, (void *)(intptr_t)numworkers))
+            break;
+        numworkers++;
+    }
+    if (helpers > numworkers)
+        helpers = numworkers;
+
+    if (helpers <= 0 || job_active) {
+        for (i = 0; i < count; i++)
+            func(data, i);
+        return;
+    }
+
+    job_active = true;
+    job_func = func;
+    job_data = data;
+    job_count = count;
+    job_next = 0;
+
+    pthread_mutex_lock(&job_lock);
+    job_helpers = helpers;
+    job_finished = 0;
+    job_generation++;
+    pthread_cond_broadcast(&job_start);
+    pthread_mutex_unlock(&job_lock);
+
+    Sys_DoJobs();
+
+    pthread_mutex_lock(&job_lock);
+    while (job_finished < job_helpers)
+        pthread_cond_wait(&job_done, &job_lock);
+    pthread_mutex_unlock(&job_lock);
+
+    job_active = false;
+}
+
+#endif
+
+void Sys_MakeCodeWriteable(unsigned long startaddr, unsigned long length)
+{
+}
+
+/*
+================
+main
+================
+*/
+int main(int argc, char *argv[])
+{
+    double time, oldtime, newtime;
+    quakeparms_t parms;
+    int j;
+
+    memset(&parms, 0, sizeof(parms));
+
+    COM_InitArgv(argc, argv);
+    parms.argc = com_argc;
+    parms.argv = com_argv;
+
+    parms.memsize = 16 * 1024 * 1024;
+
+    j = COM_CheckParm("-mem");
+    if (j)
+        parms.memsize = (int)(Q_atof(com_argv[j + 1]) * 1024 * 1024);
+
+    parms.membase = malloc(parms.memsize);
+    if (!parms.membase)
+        Sys_Error("Not enough memory for heap");
+
+    parms.basedir = basedir;
+
+    if (COM_CheckParm("-nostdout"))
+        nostdout = 1;
+
+    Host_Init(&parms);
+    Sys_Init();
+
+    if (!nostdout)
+        printf("Quake dedicated server -- Version %0.3f\n", VERSION);
+
+    oldtime = Sys_FloatTime() - 0.1;
+
+    while (1) {
+        newtime = Sys_FloatTime();
+        time = newtime - oldtime;
+
+        // don't spin faster than the tic rate
+        if (time < sys_ticrate.value) {
+            Sys_Sleep();
+            continue;
+        }
+
+        if (time > 0.2)
+            time = 0.2;
+
+        oldtime = newtime;
+
+        Host_Frame(time);
+    }
+
+    return 0;
+}
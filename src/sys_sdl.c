@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #else
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #endif
 
 #include "quakedef.h"
@@ -218,6 +219,22 @@ int Sys_FileRead(int handle, void *dest, int count)
 #endif
 }
 
+void *Sys_FileMap(int handle, int length)
+{
+#ifdef _WIN32
+    return NULL;
+#else
+    void *base;
+
+    if (length <= 0)
+        return NULL;
+    base = mmap(NULL, length, PROT_READ, MAP_SHARED, handle, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    return base;
+#endif
+}
+
 void Sys_DebugLog(char *file, char *fmt, ...)
 {
     va_list argptr;
@@ -328,6 +345,98 @@ void Sys_SendKeyEvents(void)
     }
 }
 
+// =======================================================================
+// Worker threads
+// =======================================================================
+
+#define MAX_WORKERS 16
+
+static SDL_Thread *workers[MAX_WORKERS];
+static int numworkers;
+static SDL_sem *job_start;
+static SDL_sem *job_done;
+static SDL_atomic_t job_next;
+static sys_jobfunc_t job_func;
+static void *job_data;
+static int job_count;
+static qboolean job_active;
+
+int Sys_NumProcessors(void)
+{
+    return SDL_GetCPUCount();
+}
+
+static void Sys_DoJobs(void)
+{
+    int i;
+
+    while ((i = SDL_AtomicAdd(&job_next, 1)) < job_count)
+        job_func(job_data, i);
+}
+
+static int Sys_WorkerThread(void *unused)
+{
+    while (1) {
+        SDL_SemWait(job_start);
+        Sys_DoJobs();
+        SDL_SemPost(job_done);
+    }
+    return 0;
+}
+
+/*
+================
+Sys_RunJobs
+
+The pool is grown on demand and the threads are kept for the life of the
+process.  Nested calls (a job starting more jobs) run serially.
+================
+*/
+void Sys_RunJobs(sys_jobfunc_t func, void *data, int count, int numthreads)
+{
+    int i, helpers;
+
+    if (numthreads > count)
+        numthreads = count;
+    helpers = numthreads - 1;
+    if (helpers > MAX_WORKERS)
+        helpers = MAX_WORKERS;
+
+    if (!job_start) {
+        job_start = SDL_CreateSemaphore(0);
+        job_done = SDL_CreateSemaphore(0);
+    }
+
+    while (numworkers < helpers && job_start && job_done && !job_active) {
+        workers[numworkers] = SDL_CreateThread(Sys_WorkerThread, "worker", NULL);
+        if (!workers[numworkers])
+            break;
+        numworkers++;
+    }
+    if (helpers > numworkers)
+        helpers = numworkers;
+
+    if (helpers <= 0 || job_active) {
+        for (i = 0; i < count; i++)
+            func(data, i);
+        return;
+    }
+
+    job_active = true;
+    job_func = func;
+    job_data = data;
+    job_count = count;
+    SDL_AtomicSet(&job_next, 0);
+
+    for (i = 0; i < helpers; i++)
+        SDL_SemPost(job_start);
+    Sys_DoJobs();
+    for (i = 0; i < helpers; i++)
+        SDL_SemWait(job_done);
+
+    job_active = false;
+}
+
 void Sys_MakeCodeWriteable(unsigned long startaddr, unsigned long length)
 {
     // Not needed for SDL build - no assembly
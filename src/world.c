@@ -39,6 +39,7 @@ typedef struct
 	trace_t		trace;
 	int			type;
 	edict_t		*passedict;
+	int			tests, clips;	// added to c_areatests and c_areaclips
 } moveclip_t;
 
 
@@ -56,6 +57,16 @@ HULL BOXES
 static	hull_t		box_hull;
 static	dclipnode_t	box_clipnodes[6];
 static	mplane_t	box_planes[6];
+static	mclipnode_t	box_packednodes[6];
+
+// the sized copy of the box hull for one clip.  it lives on the caller's
+// stack so traces can run on several threads at once, and only the packed
+// nodes carry the size
+typedef struct
+{
+	hull_t		hull;
+	mclipnode_t	nodes[6];
+} boxhull_t;
 
 /*
 ===================
@@ -74,6 +85,7 @@ void SV_InitBoxHull (void)
 	box_hull.planes = box_planes;
 	box_hull.firstclipnode = 0;
 	box_hull.lastclipnode = 5;
+	box_hull.packednodes = box_packednodes;
 
 	for (i=0 ; i<6 ; i++)
 	{
@@ -89,6 +101,11 @@ void SV_InitBoxHull (void)
 		
 		box_planes[i].type = i>>1;
 		box_planes[i].normal[i>>1] = 1;
+
+		box_packednodes[i].type = i>>1;
+		box_packednodes[i].normal[i>>1] = 1;
+		box_packednodes[i].children[0] = box_clipnodes[i].children[0];
+		box_packednodes[i].children[1] = box_clipnodes[i].children[1];
 	}
 	
 }
@@ -102,16 +119,20 @@ To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 ===================
 */
-hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs, boxhull_t *box)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
-
-	return &box_hull;
+	box->hull = box_hull;
+	box->hull.packednodes = box->nodes;
+	memcpy (box->nodes, box_packednodes, sizeof(box->nodes));
+
+	box->nodes[0].dist = maxs[0];
+	box->nodes[1].dist = mins[0];
+	box->nodes[2].dist = maxs[1];
+	box->nodes[3].dist = mins[1];
+	box->nodes[4].dist = maxs[2];
+	box->nodes[5].dist = mins[2];
+
+	return &box->hull;
 }
 
 
@@ -126,7 +147,7 @@ Offset is filled in to contain the adjustment that must be added to the
 testing object's origin to get a point to use with the returned hull.
 ================
 */
-hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, boxhull_t *box)
 {
 	model_t		*model;
 	vec3_t		size;
@@ -161,7 +182,7 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = SV_HullForBox (hullmins, hullmaxs, box);
 		
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -193,6 +214,38 @@ typedef struct areanode_s
 static	areanode_t	sv_areanodes[AREA_NODES];
 static	int			sv_numareanodes;
 
+/*
+The alternative to the fixed areanode tree is a loose grid over the world's
+x/y extent.  An entity is linked into the cell holding the center of its
+box if it is no wider than a cell, so it reaches at most half a cell past
+that cell and a query only has to widen its box by half a cell to find
+everything it touches.  Bigger entities go in a single oversize list that
+every query walks.  Cells are plain leaf
+areanodes, so the touch and clip walks are shared with the tree.
+
+There is nothing to rebalance: a moving entity simply relinks into the
+cell it has moved to.  The mode is latched from sv_area at SV_ClearWorld.
+*/
+#define	AREA_TREE		0
+#define	AREA_GRID		1
+
+#define	AREA_GRIDCELLS	64		// max cells along each axis
+#define	AREA_CELLSIZE	128		// min cell size
+
+cvar_t	sv_area = {"sv_area", "0"};		// 0 = areanode tree, 1 = loose grid
+
+static	int			sv_areamode;
+static	areanode_t	sv_areacells[AREA_GRIDCELLS*AREA_GRIDCELLS];
+static	areanode_t	sv_arealarge;			// too big for any cell
+static	vec3_t		sv_gridmins;
+static	float		sv_gridcell;
+static	int			sv_gridwide, sv_gridhigh;
+
+// counted for sv_areabench
+int		c_areamoves, c_areatests, c_areaclips;
+
+int		sv_worldchanges;
+
 /*
 ===============
 SV_CreateAreaNode
@@ -238,6 +291,128 @@ areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
 	return anode;
 }
 
+/*
+===============
+SV_CreateAreaGrid
+
+===============
+*/
+void SV_CreateAreaGrid (vec3_t mins, vec3_t maxs)
+{
+	int		i;
+	float	size;
+
+	size = maxs[0] - mins[0];
+	if (maxs[1] - mins[1] > size)
+		size = maxs[1] - mins[1];
+	sv_gridcell = size / AREA_GRIDCELLS;
+	if (sv_gridcell < AREA_CELLSIZE)
+		sv_gridcell = AREA_CELLSIZE;
+
+	VectorCopy (mins, sv_gridmins);
+	sv_gridwide = (int)((maxs[0] - mins[0]) / sv_gridcell) + 1;
+	sv_gridhigh = (int)((maxs[1] - mins[1]) / sv_gridcell) + 1;
+	if (sv_gridwide > AREA_GRIDCELLS)
+		sv_gridwide = AREA_GRIDCELLS;
+	if (sv_gridhigh > AREA_GRIDCELLS)
+		sv_gridhigh = AREA_GRIDCELLS;
+
+	for (i=0 ; i<sv_gridwide*sv_gridhigh ; i++)
+	{
+		sv_areacells[i].axis = -1;
+		ClearLink (&sv_areacells[i].trigger_edicts);
+		ClearLink (&sv_areacells[i].solid_edicts);
+	}
+
+	sv_arealarge.axis = -1;
+	ClearLink (&sv_arealarge.trigger_edicts);
+	ClearLink (&sv_arealarge.solid_edicts);
+}
+
+/*
+===============
+SV_GridCell
+
+Column or row of the cell holding v, clamped into the grid like the
+cells SV_GridNodeForBox links entities outside the grid into
+===============
+*/
+static int SV_GridCell (float v, float min, int count)
+{
+	v = floor ((v - min) / sv_gridcell);
+	if (v < 0)
+		return 0;
+	if (v > count-1)
+		return count-1;
+	return (int)v;
+}
+
+/*
+===============
+SV_GridRange
+
+Cells that can hold an entity touching the box
+===============
+*/
+void SV_GridRange (vec3_t mins, vec3_t maxs, int *x0, int *y0, int *x1, int *y1)
+{
+	float	margin;
+
+	margin = sv_gridcell * 0.5;
+
+	*x0 = SV_GridCell (mins[0] - margin, sv_gridmins[0], sv_gridwide);
+	*y0 = SV_GridCell (mins[1] - margin, sv_gridmins[1], sv_gridhigh);
+	*x1 = SV_GridCell (maxs[0] + margin, sv_gridmins[0], sv_gridwide);
+	*y1 = SV_GridCell (maxs[1] + margin, sv_gridmins[1], sv_gridhigh);
+}
+
+/*
+===============
+SV_GridNodeForBox
+
+===============
+*/
+areanode_t *SV_GridNodeForBox (vec3_t mins, vec3_t maxs)
+{
+	int		x, y;
+
+	if (maxs[0] - mins[0] > sv_gridcell || maxs[1] - mins[1] > sv_gridcell)
+		return &sv_arealarge;
+
+	x = (int)floor ((0.5*(mins[0] + maxs[0]) - sv_gridmins[0]) / sv_gridcell);
+	y = (int)floor ((0.5*(mins[1] + maxs[1]) - sv_gridmins[1]) / sv_gridcell);
+	if (x < 0)
+		x = 0;
+	else if (x > sv_gridwide-1)
+		x = sv_gridwide-1;
+	if (y < 0)
+		y = 0;
+	else if (y > sv_gridhigh-1)
+		y = sv_gridhigh-1;
+
+	return &sv_areacells[y*sv_gridwide + x];
+}
+
+/*
+===============
+SV_ClearArea
+
+===============
+*/
+void SV_ClearArea (int mode)
+{
+	memset (sv_areanodes, 0, sizeof(sv_areanodes));
+	sv_numareanodes = 0;
+
+	sv_areamode = mode;
+	if (sv_areamode == AREA_GRID)
+		SV_CreateAreaGrid (sv.worldmodel->mins, sv.worldmodel->maxs);
+	else
+		SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+}
+
+static void SV_ClearTraceMemo (void);
+
 /*
 ===============
 SV_ClearWorld
@@ -247,10 +422,8 @@ SV_ClearWorld
 void SV_ClearWorld (void)
 {
 	SV_InitBoxHull ();
-	
-	memset (sv_areanodes, 0, sizeof(sv_areanodes));
-	sv_numareanodes = 0;
-	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+	SV_ClearTraceMemo ();
+	SV_ClearArea (sv_area.value ? AREA_GRID : AREA_TREE);
 }
 
 
@@ -262,6 +435,7 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
+	sv_worldchanges++;
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->area);
@@ -373,6 +547,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
 
+	sv_statlinks++;
+
 	if (ent->area.prev)
 		SV_UnlinkEdict (ent);	// unlink from old position
 		
@@ -382,6 +558,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	if (ent->free)
 		return;
 
+	sv_worldchanges++;
+
 // set the abs box
 
 #ifdef QUAKE2
@@ -441,21 +619,28 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	if (ent->v.modelindex)
 		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
 
+	SV_HotLink (ent);
+
 	if (ent->v.solid == SOLID_NOT)
 		return;
 
 // find the first node that the ent's box crosses
-	node = sv_areanodes;
-	while (1)
+	if (sv_areamode == AREA_GRID)
+		node = SV_GridNodeForBox (ent->v.absmin, ent->v.absmax);
+	else
 	{
-		if (node->axis == -1)
-			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
-			break;		// crosses the node
+		node = sv_areanodes;
+		while (1)
+		{
+			if (node->axis == -1)
+				break;
+			if (ent->v.absmin[node->axis] > node->dist)
+				node = node->children[0];
+			else if (ent->v.absmax[node->axis] < node->dist)
+				node = node->children[1];
+			else
+				break;		// crosses the node
+		}
 	}
 	
 // link it in	
@@ -467,9 +652,141 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	
 // if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
+		SV_TouchTriggers (ent);
+}
+
+/*
+===============
+SV_TouchTriggers
+
+Runs the touch functions of the triggers a linked entity is in
+===============
+*/
+void SV_TouchTriggers (edict_t *ent)
+{
+	if (!ent->area.prev)
+		return;		// not linked in anywhere
+
+	if (sv_areamode == AREA_GRID)
+	{
+		int		x, y, x0, y0, x1, y1;
+
+		SV_TouchLinks ( ent, &sv_arealarge );
+		SV_GridRange (ent->v.absmin, ent->v.absmax, &x0, &y0, &x1, &y1);
+		for (y=y0 ; y<=y1 ; y++)
+			for (x=x0 ; x<=x1 ; x++)
+				SV_TouchLinks ( ent, &sv_areacells[y*sv_gridwide + x] );
+	}
+	else
 		SV_TouchLinks ( ent, sv_areanodes );
 }
 
+/*
+===============
+SV_RelinkWorld
+
+Rebuilds the area structure in the given mode and relinks everything
+===============
+*/
+void SV_RelinkWorld (int mode)
+{
+	int		e;
+	edict_t	*ent;
+	byte	linked[MAX_EDICTS];
+
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+	{
+		linked[e] = ent->area.prev != NULL;
+		SV_UnlinkEdict (ent);
+	}
+
+	SV_ClearArea (mode);
+
+	ent = NEXT_EDICT(sv.edicts);
+	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+		if (linked[e])
+			SV_LinkEdict (ent, false);
+}
+
+
+
+/*
+====================
+SV_AreaLinks
+====================
+*/
+static void SV_AreaLinks (link_t *head, vec3_t mins, vec3_t maxs, edict_t **list, int *count)
+{
+	link_t		*l;
+	edict_t		*touch;
+	qboolean	hot;
+
+	hot = sv_hotfields.value != 0;
+	for (l = head->next ; l != head ; l = l->next)
+	{
+		touch = EDICT_FROM_AREA(l);
+		if (hot)
+		{
+			if (SV_HOTOUTSIDE(SV_HOTNUM(touch), mins, maxs))
+				continue;
+		}
+		else if (mins[0] > touch->v.absmax[0]
+		|| mins[1] > touch->v.absmax[1]
+		|| mins[2] > touch->v.absmax[2]
+		|| maxs[0] < touch->v.absmin[0]
+		|| maxs[1] < touch->v.absmin[1]
+		|| maxs[2] < touch->v.absmin[2] )
+			continue;
+		list[(*count)++] = touch;
+	}
+}
+
+static void SV_AreaNodeEdicts (areanode_t *node, vec3_t mins, vec3_t maxs, edict_t **list, int *count)
+{
+	SV_AreaLinks (&node->solid_edicts, mins, maxs, list, count);
+	SV_AreaLinks (&node->trigger_edicts, mins, maxs, list, count);
+
+	if (node->axis == -1)
+		return;
+
+	if ( maxs[node->axis] > node->dist )
+		SV_AreaNodeEdicts ( node->children[0], mins, maxs, list, count );
+	if ( mins[node->axis] < node->dist )
+		SV_AreaNodeEdicts ( node->children[1], mins, maxs, list, count );
+}
+
+/*
+====================
+SV_AreaEdicts
+
+Collects the linked entities, solid or trigger, whose abs box touches the
+box, in no particular order.  list must hold MAX_EDICTS.
+====================
+*/
+int SV_AreaEdicts (vec3_t mins, vec3_t maxs, edict_t **list)
+{
+	int		count;
+
+	if (sv_hotfields.value)
+		SV_HotSync ();
+
+	count = 0;
+	if (sv_areamode == AREA_GRID)
+	{
+		int		x, y, x0, y0, x1, y1;
+
+		SV_AreaNodeEdicts ( &sv_arealarge, mins, maxs, list, &count );
+		SV_GridRange (mins, maxs, &x0, &y0, &x1, &y1);
+		for (y=y0 ; y<=y1 ; y++)
+			for (x=x0 ; x<=x1 ; x++)
+				SV_AreaNodeEdicts ( &sv_areacells[y*sv_gridwide + x], mins, maxs, list, &count );
+	}
+	else
+		SV_AreaNodeEdicts ( sv_areanodes, mins, maxs, list, &count );
+
+	return count;
+}
 
 
 /*
@@ -491,21 +808,19 @@ SV_HullPointContents
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p)
 {
 	float		d;
-	dclipnode_t	*node;
-	mplane_t	*plane;
+	mclipnode_t	*node;
 
 	while (num >= 0)
 	{
 		if (num < hull->firstclipnode || num > hull->lastclipnode)
 			Sys_Error ("SV_HullPointContents: bad node number");
 	
-		node = hull->clipnodes + num;
-		plane = hull->planes + node->planenum;
+		node = hull->packednodes + num;
 		
-		if (plane->type < 3)
-			d = p[plane->type] - plane->dist;
+		if (node->type < 3)
+			d = p[node->type] - node->dist;
 		else
-			d = DotProduct (plane->normal, p) - plane->dist;
+			d = DotProduct (node->normal, p) - node->dist;
 		if (d < 0)
 			num = node->children[1];
 		else
@@ -576,22 +891,105 @@ LINE TESTING IN HULLS
 ==================
 SV_RecursiveHullCheck
 
+Walks the clipnodes with an explicit stack instead of recursing.  Each node
+the segment crosses is pushed when the walk goes down its near side, and
+popped when that side comes back empty, to either go on down the far side
+or stop at the impact.  The arithmetic is the same as the recursive version
+step for step, so the traces are too.
 ==================
 */
+#define	MAX_HULLSTACK	512
+
+typedef struct
+{
+	int			num;			// the node crossed
+	int			side;			// near side
+	float		frac;
+	float		p1f, midf, p2f;
+	vec3_t		p1, mid, p2;
+} hullstack_t;
+
 qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
 {
-	dclipnode_t	*node;
-	mplane_t	*plane;
+	hullstack_t	stack[MAX_HULLSTACK], *top;
+	mclipnode_t	*node;
 	float		t1, t2;
 	float		frac;
 	int			i;
-	vec3_t		mid;
+	vec3_t		start, end, mid;
 	int			side;
 	float		midf;
+	int			depth;
 
-// check for empty
-	if (num < 0)
+	VectorCopy (p1, start);
+	VectorCopy (p2, end);
+	depth = 0;
+
+	while (1)
 	{
+		while (num >= 0)
+		{
+			if (num < hull->firstclipnode || num > hull->lastclipnode)
+				Sys_Error ("SV_RecursiveHullCheck: bad node number");
+
+		//
+		// find the point distances
+		//
+			node = hull->packednodes + num;
+
+			if (node->type < 3)
+			{
+				t1 = start[node->type] - node->dist;
+				t2 = end[node->type] - node->dist;
+			}
+			else
+			{
+				t1 = DotProduct (node->normal, start) - node->dist;
+				t2 = DotProduct (node->normal, end) - node->dist;
+			}
+
+			if (t1 >= 0 && t2 >= 0)
+			{
+				num = node->children[0];
+				continue;
+			}
+			if (t1 < 0 && t2 < 0)
+			{
+				num = node->children[1];
+				continue;
+			}
+
+		// put the crosspoint DIST_EPSILON pixels on the near side
+			if (t1 < 0)
+				frac = (t1 + DIST_EPSILON)/(t1-t2);
+			else
+				frac = (t1 - DIST_EPSILON)/(t1-t2);
+			if (frac < 0)
+				frac = 0;
+			if (frac > 1)
+				frac = 1;
+
+			if (depth == MAX_HULLSTACK)
+				Sys_Error ("SV_RecursiveHullCheck: stack overflow");
+			top = &stack[depth++];
+			top->num = num;
+			top->side = side = (t1 < 0);
+			top->frac = frac;
+			top->p1f = p1f;
+			top->p2f = p2f;
+			top->midf = p1f + (p2f - p1f)*frac;
+			for (i=0 ; i<3 ; i++)
+				top->mid[i] = start[i] + frac*(end[i] - start[i]);
+			VectorCopy (start, top->p1);
+			VectorCopy (end, top->p2);
+
+		// move up to the node
+			num = node->children[side];
+			p2f = top->midf;
+			VectorCopy (top->mid, end);
+		}
+
+	// check for empty
 		if (num != CONTENTS_SOLID)
 		{
 			trace->allsolid = false;
@@ -602,92 +1000,49 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 		}
 		else
 			trace->startsolid = true;
-		return true;		// empty
-	}
 
-	if (num < hull->firstclipnode || num > hull->lastclipnode)
-		Sys_Error ("SV_RecursiveHullCheck: bad node number");
+		if (!depth)
+			return true;		// empty
+
+	// the near side of the last node crossed was empty
+		top = &stack[--depth];
+		node = hull->packednodes + top->num;
+		side = top->side;
+
+		if (SV_HullPointContents (hull, node->children[side^1], top->mid)
+		!= CONTENTS_SOLID)
+		{	// go past the node
+			num = node->children[side^1];
+			p1f = top->midf;
+			p2f = top->p2f;
+			VectorCopy (top->mid, start);
+			VectorCopy (top->p2, end);
+			continue;
+		}
 
-//
-// find the point distances
-//
-	node = hull->clipnodes + num;
-	plane = hull->planes + node->planenum;
+		if (trace->allsolid)
+			return false;		// never got out of the solid area
 
-	if (plane->type < 3)
-	{
-		t1 = p1[plane->type] - plane->dist;
-		t2 = p2[plane->type] - plane->dist;
-	}
-	else
-	{
-		t1 = DotProduct (plane->normal, p1) - plane->dist;
-		t2 = DotProduct (plane->normal, p2) - plane->dist;
+		break;
 	}
-	
-#if 1
-	if (t1 >= 0 && t2 >= 0)
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if (t1 < 0 && t2 < 0)
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#else
-	if ( (t1 >= DIST_EPSILON && t2 >= DIST_EPSILON) || (t2 > t1 && t1 >= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
-	if ( (t1 <= -DIST_EPSILON && t2 <= -DIST_EPSILON) || (t2 < t1 && t1 <= 0) )
-		return SV_RecursiveHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
-#endif
-
-// put the crosspoint DIST_EPSILON pixels on the near side
-	if (t1 < 0)
-		frac = (t1 + DIST_EPSILON)/(t1-t2);
-	else
-		frac = (t1 - DIST_EPSILON)/(t1-t2);
-	if (frac < 0)
-		frac = 0;
-	if (frac > 1)
-		frac = 1;
-		
-	midf = p1f + (p2f - p1f)*frac;
-	for (i=0 ; i<3 ; i++)
-		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
-
-	side = (t1 < 0);
-
-// move up to the node
-	if (!SV_RecursiveHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
-		return false;
 
-#ifdef PARANOID
-	if (SV_HullPointContents (sv_hullmodel, mid, node->children[side])
-	== CONTENTS_SOLID)
-	{
-		Con_Printf ("mid PointInHullSolid\n");
-		return false;
-	}
-#endif
-	
-	if (SV_HullPointContents (hull, node->children[side^1], mid)
-	!= CONTENTS_SOLID)
-// go past the node
-		return SV_RecursiveHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
-	
-	if (trace->allsolid)
-		return false;		// never got out of the solid area
-		
 //==================
 // the other side of the node is solid, this is the impact point
 //==================
 	if (!side)
 	{
-		VectorCopy (plane->normal, trace->plane.normal);
-		trace->plane.dist = plane->dist;
+		VectorCopy (node->normal, trace->plane.normal);
+		trace->plane.dist = node->dist;
 	}
 	else
 	{
-		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
-		trace->plane.dist = -plane->dist;
+		VectorSubtract (vec3_origin, node->normal, trace->plane.normal);
+		trace->plane.dist = -node->dist;
 	}
 
+	frac = top->frac;
+	midf = top->midf;
+	VectorCopy (top->mid, mid);
 	while (SV_HullPointContents (hull, hull->firstclipnode, mid)
 	== CONTENTS_SOLID)
 	{ // shouldn't really happen, but does occasionally
@@ -696,12 +1051,13 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 		{
 			trace->fraction = midf;
 			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
+			if (!sv_parallelmoves)		// no printing from the workers
+				Con_DPrintf ("backup past 0\n");
 			return false;
 		}
-		midf = p1f + (p2f - p1f)*frac;
+		midf = top->p1f + (top->p2f - top->p1f)*frac;
 		for (i=0 ; i<3 ; i++)
-			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+			mid[i] = top->p1[i] + frac*(top->p2[i] - top->p1[i]);
 	}
 
 	trace->fraction = midf;
@@ -725,6 +1081,7 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	vec3_t		offset;
 	vec3_t		start_l, end_l;
 	hull_t		*hull;
+	boxhull_t	box;
 
 // fill in a default trace
 	memset (&trace, 0, sizeof(trace_t));
@@ -733,7 +1090,7 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	VectorCopy (end, trace.endpos);
 
 // get the clipping hull
-	hull = SV_HullForEntity (ent, mins, maxs, offset);
+	hull = SV_HullForEntity (ent, mins, maxs, offset, &box);
 
 	VectorSubtract (start, offset, start_l);
 	VectorSubtract (end, offset, end_l);
@@ -802,76 +1159,199 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	return trace;
 }
 
-//===========================================================================
-
 /*
-====================
-SV_ClipToLinks
+===============================================================================
 
-Mins and maxs enclose the entire area swept by the move
-====================
+WORLD TRACE MEMO
+
+AI code traces the same lines against the world many times in a tick (the
+same monster checking its enemy from several think functions, SV_CheckBottom
+after SV_movestep, and so on).  With sv_tracememo set, world clips are
+remembered for the rest of the tick by their exact start, end and size.  The
+world never moves, so a remembered trace is the one SV_ClipMoveToEntity
+would compute again.
+
+===============================================================================
 */
-void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
-{
-	link_t		*l, *next;
-	edict_t		*touch;
-	trace_t		trace;
 
-// touch linked edicts
-	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
-	{
-		next = l->next;
-		touch = EDICT_FROM_AREA(l);
-		if (touch->v.solid == SOLID_NOT)
-			continue;
-		if (touch == clip->passedict)
-			continue;
-		if (touch->v.solid == SOLID_TRIGGER)
-			Sys_Error ("Trigger in clipping list");
+cvar_t	sv_tracememo = {"sv_tracememo", "0"};
 
-		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
-			continue;
+qboolean	sv_parallelmoves;	// SV_Move is running on several threads
 
-		if (clip->boxmins[0] > touch->v.absmax[0]
-		|| clip->boxmins[1] > touch->v.absmax[1]
-		|| clip->boxmins[2] > touch->v.absmax[2]
-		|| clip->boxmaxs[0] < touch->v.absmin[0]
-		|| clip->boxmaxs[1] < touch->v.absmin[1]
-		|| clip->boxmaxs[2] < touch->v.absmin[2] )
-			continue;
+#define	TRACEMEMO_SIZE	1024		// power of 2
+
+typedef struct
+{
+	double		time;			// sv.time it was made, 0 = empty
+	vec3_t		start, mins, maxs, end;
+	trace_t		trace;
+} tracememo_t;
 
-		if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
-			continue;	// points never interact
+static tracememo_t	sv_tracememos[TRACEMEMO_SIZE];
 
-	// might intersect, so do an exact clip
-		if (clip->trace.allsolid)
-			return;
-		if (clip->passedict)
+/*
+==================
+SV_ClearTraceMemo
+==================
+*/
+static void SV_ClearTraceMemo (void)
+{
+	memset (sv_tracememos, 0, sizeof(sv_tracememos));
+}
+
+/*
+==================
+SV_TraceMemoHash
+==================
+*/
+static unsigned SV_TraceMemoHash (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	unsigned	bits[12];
+	unsigned	hash;
+	int			i;
+
+	memcpy (bits, start, sizeof(vec3_t));
+	memcpy (bits+3, mins, sizeof(vec3_t));
+	memcpy (bits+6, maxs, sizeof(vec3_t));
+	memcpy (bits+9, end, sizeof(vec3_t));
+
+	hash = 2166136261u;
+	for (i=0 ; i<12 ; i++)
+		hash = (hash ^ bits[i]) * 16777619u;
+
+	return (hash ^ (hash >> 15)) & (TRACEMEMO_SIZE-1);
+}
+
+/*
+==================
+SV_ClipMoveToWorld
+==================
+*/
+static trace_t SV_ClipMoveToWorld (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	tracememo_t	*memo;
+
+	if (!sv_tracememo.value || sv_parallelmoves)
+		return SV_ClipMoveToEntity (sv.edicts, start, mins, maxs, end);
+
+	memo = &sv_tracememos[SV_TraceMemoHash (start, mins, maxs, end)];
+	if (memo->time == sv.time
+	&& !memcmp (memo->start, start, sizeof(vec3_t))
+	&& !memcmp (memo->end, end, sizeof(vec3_t))
+	&& !memcmp (memo->mins, mins, sizeof(vec3_t))
+	&& !memcmp (memo->maxs, maxs, sizeof(vec3_t)) )
+		return memo->trace;
+
+	memo->time = sv.time;
+	VectorCopy (start, memo->start);
+	VectorCopy (end, memo->end);
+	VectorCopy (mins, memo->mins);
+	VectorCopy (maxs, memo->maxs);
+	memo->trace = SV_ClipMoveToEntity (sv.edicts, start, mins, maxs, end);
+
+	return memo->trace;
+}
+
+//===========================================================================
+
+/*
+====================
+SV_ClipMoveToTouch
+
+Clips the move against one entity from the area links.  Returns false once
+the move is allsolid, after which nothing can change it.
+====================
+*/
+static qboolean SV_ClipMoveToTouch (moveclip_t *clip, edict_t *touch)
+{
+	trace_t		trace;
+
+	if (touch == clip->passedict)
+		return true;
+	if (touch->v.solid == SOLID_TRIGGER)
+		Sys_Error ("Trigger in clipping list");
+
+	if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
+		return true;
+
+	if (clip->boxmins[0] > touch->v.absmax[0]
+	|| clip->boxmins[1] > touch->v.absmax[1]
+	|| clip->boxmins[2] > touch->v.absmax[2]
+	|| clip->boxmaxs[0] < touch->v.absmin[0]
+	|| clip->boxmaxs[1] < touch->v.absmin[1]
+	|| clip->boxmaxs[2] < touch->v.absmin[2] )
+		return true;
+
+	if (clip->passedict && clip->passedict->v.size[0] && !touch->v.size[0])
+		return true;	// points never interact
+
+// might intersect, so do an exact clip
+	if (clip->trace.allsolid)
+		return false;
+	if (clip->passedict)
+	{
+	 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
+			return true;	// don't clip against own missiles
+		if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
+			return true;	// don't clip against owner
+	}
+
+	clip->clips++;
+	if ((int)touch->v.flags & FL_MONSTER)
+		trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+	else
+		trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end);
+	if (trace.allsolid || trace.startsolid ||
+	trace.fraction < clip->trace.fraction)
+	{
+		trace.ent = touch;
+	 	if (clip->trace.startsolid)
 		{
-		 	if (PROG_TO_EDICT(touch->v.owner) == clip->passedict)
-				continue;	// don't clip against own missiles
-			if (PROG_TO_EDICT(clip->passedict->v.owner) == touch)
-				continue;	// don't clip against owner
+			clip->trace = trace;
+			clip->trace.startsolid = true;
 		}
-
-		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end);
 		else
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end);
-		if (trace.allsolid || trace.startsolid ||
-		trace.fraction < clip->trace.fraction)
-		{
-			trace.ent = touch;
-		 	if (clip->trace.startsolid)
-			{
-				clip->trace = trace;
-				clip->trace.startsolid = true;
-			}
-			else
-				clip->trace = trace;
+			clip->trace = trace;
+	}
+	else if (trace.startsolid)
+		clip->trace.startsolid = true;
+
+	return true;
+}
+
+/*
+====================
+SV_ClipToLinks
+
+Mins and maxs enclose the entire area swept by the move
+====================
+*/
+void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
+{
+	link_t		*l, *next;
+	edict_t		*touch;
+	int			e;
+	qboolean	hot;
+
+// touch linked edicts
+	hot = sv_hotfields.value != 0;
+	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = next)
+	{
+		next = l->next;
+		touch = EDICT_FROM_AREA(l);
+		clip->tests++;
+		if (hot)
+		{	// leave out what SV_ClipMoveToTouch would, without reading the edict
+			e = SV_HOTNUM(touch);
+			if (sv_hot.solid[e] == SOLID_NOT)
+				continue;
+			if (sv_hot.solid[e] != SOLID_TRIGGER && SV_HOTOUTSIDE(e, clip->boxmins, clip->boxmaxs))
+				continue;
 		}
-		else if (trace.startsolid)
-			clip->trace.startsolid = true;
+		else if (touch->v.solid == SOLID_NOT)
+			continue;
+		if (!SV_ClipMoveToTouch (clip, touch))
+			return;
 	}
 	
 // recurse down both sides
@@ -917,46 +1397,756 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 
 /*
 ==================
-SV_Move
+SV_SetupMoveClip
+
+Clips the move to the world and sets up the entity clipping
 ==================
 */
-trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static void SV_SetupMoveClip (moveclip_t *clip, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
-	moveclip_t	clip;
 	int			i;
 
-	memset ( &clip, 0, sizeof ( moveclip_t ) );
+	memset ( clip, 0, sizeof ( moveclip_t ) );
 
 // clip to world
-	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end );
+	clip->trace = SV_ClipMoveToWorld ( start, mins, maxs, end );
 
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.type = type;
-	clip.passedict = passedict;
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
 
 	if (type == MOVE_MISSILE)
 	{
 		for (i=0 ; i<3 ; i++)
 		{
-			clip.mins2[i] = -15;
-			clip.maxs2[i] = 15;
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
 		}
 	}
 	else
 	{
-		VectorCopy (mins, clip.mins2);
-		VectorCopy (maxs, clip.maxs2);
+		VectorCopy (mins, clip->mins2);
+		VectorCopy (maxs, clip->maxs2);
 	}
 	
 // create the bounding box of the entire move
-	SV_MoveBounds ( start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs );
+	SV_MoveBounds ( start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs );
+}
+
+/*
+==================
+SV_Move
+==================
+*/
+trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t	clip;
+
+	SV_SetupMoveClip (&clip, start, mins, maxs, end, type, passedict);
+
+	if (!sv_parallelmoves)
+	{
+		sv_stattraces++;
+		if (sv_hotfields.value)
+			SV_HotSync ();
+	}
 
 // clip to entities
-	SV_ClipToLinks ( sv_areanodes, &clip );
+	if (sv_areamode == AREA_GRID)
+	{
+		int		x, y, x0, y0, x1, y1;
+
+		SV_ClipToLinks ( &sv_arealarge, &clip );
+		SV_GridRange (clip.boxmins, clip.boxmaxs, &x0, &y0, &x1, &y1);
+		for (y=y0 ; y<=y1 ; y++)
+			for (x=x0 ; x<=x1 ; x++)
+				SV_ClipToLinks ( &sv_areacells[y*sv_gridwide + x], &clip );
+	}
+	else
+		SV_ClipToLinks ( sv_areanodes, &clip );
+
+	if (!sv_parallelmoves)
+	{	// the counters are not shared with the workers
+		c_areamoves++;
+		c_areatests += clip.tests;
+		c_areaclips += clip.clips;
+	}
 
 	return clip.trace;
 }
 
+/*
+===============================================================================
+
+BATCHED MOVES
+
+SV_MoveBatch walks the area structure once for the combined bounds of a
+group of moves, then clips every move against the gathered candidates.
+Candidates are gathered in the order SV_ClipToLinks would visit them, so
+each trace comes out exactly as SV_Move would have returned it.  It pays
+off for groups of short, nearby traces that do not depend on each other.
+
+===============================================================================
+*/
+
+#define	MAX_BATCHMOVES	16
+
+/*
+====================
+SV_GatherLinks
+
+Collects the solid entities whose bounds touch the box
+====================
+*/
+static void SV_GatherLinks (areanode_t *node, vec3_t boxmins, vec3_t boxmaxs, edict_t **list, int *count)
+{
+	link_t		*l;
+	edict_t		*touch;
+	int			e;
+	qboolean	hot;
+
+	hot = sv_hotfields.value != 0;
+	for (l = node->solid_edicts.next ; l != &node->solid_edicts ; l = l->next)
+	{
+		touch = EDICT_FROM_AREA(l);
+		c_areatests++;
+		if (hot)
+		{
+			e = SV_HOTNUM(touch);
+			if (sv_hot.solid[e] == SOLID_NOT)
+				continue;
+			if (SV_HOTOUTSIDE(e, boxmins, boxmaxs))
+				continue;
+			list[(*count)++] = touch;
+			continue;
+		}
+		if (touch->v.solid == SOLID_NOT)
+			continue;
+		if (boxmins[0] > touch->v.absmax[0]
+		|| boxmins[1] > touch->v.absmax[1]
+		|| boxmins[2] > touch->v.absmax[2]
+		|| boxmaxs[0] < touch->v.absmin[0]
+		|| boxmaxs[1] < touch->v.absmin[1]
+		|| boxmaxs[2] < touch->v.absmin[2] )
+			continue;
+		list[(*count)++] = touch;
+	}
+
+	if (node->axis == -1)
+		return;
+
+	if ( boxmaxs[node->axis] > node->dist )
+		SV_GatherLinks ( node->children[0], boxmins, boxmaxs, list, count );
+	if ( boxmins[node->axis] < node->dist )
+		SV_GatherLinks ( node->children[1], boxmins, boxmaxs, list, count );
+}
+
+/*
+==================
+SV_MoveBatch
+
+Fills in moves[i].trace for each move
+==================
+*/
+void SV_MoveBatch (batchmove_t *moves, int nummoves)
+{
+	moveclip_t	clips[MAX_BATCHMOVES];
+	qboolean	done[MAX_BATCHMOVES];
+	edict_t		*touchlist[MAX_EDICTS];
+	vec3_t		boxmins, boxmaxs;
+	int			i, j, numtouch;
+
+	for ( ; nummoves > MAX_BATCHMOVES ; moves += MAX_BATCHMOVES, nummoves -= MAX_BATCHMOVES)
+		SV_MoveBatch (moves, MAX_BATCHMOVES);
+	if (nummoves <= 0)
+		return;
+	sv_stattraces += nummoves;
+	if (sv_hotfields.value)
+		SV_HotSync ();
+
+	for (i=0 ; i<nummoves ; i++)
+	{
+		SV_SetupMoveClip (&clips[i], moves[i].start, moves[i].mins, moves[i].maxs,
+			moves[i].end, moves[i].type, moves[i].passedict);
+		done[i] = false;
+		if (!i)
+		{
+			VectorCopy (clips[i].boxmins, boxmins);
+			VectorCopy (clips[i].boxmaxs, boxmaxs);
+			continue;
+		}
+		for (j=0 ; j<3 ; j++)
+		{
+			if (clips[i].boxmins[j] < boxmins[j])
+				boxmins[j] = clips[i].boxmins[j];
+			if (clips[i].boxmaxs[j] > boxmaxs[j])
+				boxmaxs[j] = clips[i].boxmaxs[j];
+		}
+	}
+
+// one broadphase walk for the whole group
+	c_areamoves += nummoves;
+	numtouch = 0;
+	if (sv_areamode == AREA_GRID)
+	{
+		int		x, y, x0, y0, x1, y1;
+
+		SV_GatherLinks ( &sv_arealarge, boxmins, boxmaxs, touchlist, &numtouch );
+		SV_GridRange (boxmins, boxmaxs, &x0, &y0, &x1, &y1);
+		for (y=y0 ; y<=y1 ; y++)
+			for (x=x0 ; x<=x1 ; x++)
+				SV_GatherLinks ( &sv_areacells[y*sv_gridwide + x], boxmins, boxmaxs, touchlist, &numtouch );
+	}
+	else
+		SV_GatherLinks ( sv_areanodes, boxmins, boxmaxs, touchlist, &numtouch );
+
+	for (j=0 ; j<numtouch ; j++)
+		for (i=0 ; i<nummoves ; i++)
+			if (!done[i] && !SV_ClipMoveToTouch (&clips[i], touchlist[j]))
+				done[i] = true;
+
+	for (i=0 ; i<nummoves ; i++)
+	{
+		moves[i].trace = clips[i].trace;
+		c_areaclips += clips[i].clips;
+	}
+}
+
+/*
+===============================================================================
+
+BENCHMARK FIXTURE
+
+The console benches and tests share one random sequence, so a seed gives
+the same points every run, and one way to scatter stand-in entities over
+the map and take them away again.
+
+===============================================================================
+*/
+
+static unsigned	bench_seed;
+static int		bench_numedicts;
+
+/*
+==================
+SV_BenchSeed
+==================
+*/
+void SV_BenchSeed (unsigned seed)
+{
+	bench_seed = seed;
+}
+
+/*
+==================
+SV_BenchRandom
+==================
+*/
+float SV_BenchRandom (float lo, float hi)
+{
+	bench_seed = bench_seed * 1103515245 + 12345;
+	return lo + (hi - lo) * ((bench_seed >> 8) & 0xffff) / 65535.0;
+}
+
+/*
+==================
+SV_BenchPoint
+
+A random point inside the world model's bounds
+==================
+*/
+void SV_BenchPoint (vec3_t p)
+{
+	int		i;
+
+	for (i=0 ; i<3 ; i++)
+		p[i] = SV_BenchRandom (sv.worldmodel->mins[i], sv.worldmodel->maxs[i]);
+}
+
+/*
+==================
+SV_BenchSpawn
+
+Links up to count solid boxes at random points, as many as there are
+edicts left for.  Returns how many were spawned.
+==================
+*/
+int SV_BenchSpawn (edict_t **spawned, int count, vec3_t mins, vec3_t maxs)
+{
+	int		i;
+	edict_t	*ent;
+
+	bench_numedicts = sv.num_edicts;
+	if (count > sv.max_edicts - sv.num_edicts)
+		count = sv.max_edicts - sv.num_edicts;
+	if (count < 0)
+		count = 0;
+
+	for (i=0 ; i<count ; i++)
+	{
+		ent = spawned[i] = ED_Alloc ();
+		ent->v.solid = SOLID_BBOX;
+		ent->v.movetype = MOVETYPE_NONE;
+		VectorCopy (mins, ent->v.mins);
+		VectorCopy (maxs, ent->v.maxs);
+		VectorSubtract (maxs, mins, ent->v.size);
+		SV_BenchPoint (ent->v.origin);
+		SV_LinkEdict (ent, false);
+	}
+
+	return count;
+}
+
+/*
+==================
+SV_BenchRemove
+
+Frees what SV_BenchSpawn spawned and gives back the edicts it added to
+the end of the list
+==================
+*/
+void SV_BenchRemove (edict_t **spawned, int count)
+{
+	int		i;
+
+	for (i=0 ; i<count ; i++)
+		ED_Free (spawned[i]);
+	sv.num_edicts = bench_numedicts;	// ED_Alloc drops the queued ones past it
+}
+
+/*
+===============================================================================
+
+BROADPHASE BENCHMARK
+
+===============================================================================
+*/
+
+/*
+==================
+SV_AreaBench_f
+
+sv_areabench [extra entities] [traces]
+
+Runs the same set of random player-sized traces through each area
+structure and reports the candidates tested per SV_Move.  The extra
+entities are scattered bounding boxes that stand in for a busy map and are
+removed afterwards.
+==================
+*/
+void SV_AreaBench_f (void)
+{
+	int		i, mode, numents, numtraces, oldmode;
+	edict_t	*spawned[MAX_EDICTS];
+	vec3_t	start, end;
+	double	time;
+	static	vec3_t	mins = {-16, -16, -24}, maxs = {16, 16, 32};
+	static	char	*names[2] = {"tree", "grid"};
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_areabench: no server running\n");
+		return;
+	}
+
+	numents = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : 0;
+	numtraces = Cmd_Argc() > 2 ? Q_atoi (Cmd_Argv(2)) : 10000;
+
+	SV_BenchSeed (1);
+	numents = SV_BenchSpawn (spawned, numents, mins, maxs);
+
+	oldmode = sv_areamode;
+	Con_Printf ("%i edicts, %i traces\n", sv.num_edicts, numtraces);
+
+	for (mode=AREA_TREE ; mode<=AREA_GRID ; mode++)
+	{
+		SV_RelinkWorld (mode);
+
+		c_areamoves = c_areatests = c_areaclips = 0;
+		SV_BenchSeed (2);
+		time = Sys_FloatTime ();
+		for (i=0 ; i<numtraces ; i++)
+		{
+			SV_BenchPoint (start);
+			end[0] = start[0] + SV_BenchRandom (-256, 256);
+			end[1] = start[1] + SV_BenchRandom (-256, 256);
+			end[2] = start[2] + SV_BenchRandom (-64, 64);
+			SV_Move (start, mins, maxs, end, MOVE_NORMAL, NULL);
+		}
+		time = Sys_FloatTime () - time;
+
+		if (c_areamoves)
+			Con_Printf ("%s: %5.1f candidates %5.2f clips per move, %5.3f ms\n",
+				names[mode], (float)c_areatests / c_areamoves,
+				(float)c_areaclips / c_areamoves, time * 1000);
+	}
+
+	SV_BenchRemove (spawned, numents);
+
+	SV_RelinkWorld (oldmode);
+}
+
+
+/*
+==================
+SV_BenchCluster
+
+A group of short point traces straight down around a random spot, the way
+SV_CheckBottom probes under a monster
+==================
+*/
+static void SV_BenchCluster (batchmove_t *moves, int size)
+{
+	int		i;
+	vec3_t	center;
+
+	SV_BenchPoint (center);
+
+	for (i=0 ; i<size ; i++)
+	{
+		moves[i].start[0] = center[0] + SV_BenchRandom (-16, 16);
+		moves[i].start[1] = center[1] + SV_BenchRandom (-16, 16);
+		moves[i].start[2] = center[2];
+		VectorCopy (moves[i].start, moves[i].end);
+		moves[i].end[2] -= 36;
+		VectorCopy (vec3_origin, moves[i].mins);
+		VectorCopy (vec3_origin, moves[i].maxs);
+		moves[i].type = MOVE_NORMAL;
+		moves[i].passedict = NULL;
+	}
+}
+
+/*
+==================
+SV_MoveBench_f
+
+sv_movebench [clusters] [traces per cluster]
+
+Times the same clusters of traces through SV_Move one at a time and through
+SV_MoveBatch, and checks that both give the same traces.
+==================
+*/
+void SV_MoveBench_f (void)
+{
+	int		i, j, numclusters, size, mismatches;
+	batchmove_t	moves[MAX_BATCHMOVES];
+	trace_t	trace;
+	double	time, scalartime, batchtime;
+	int		scalartests, batchtests;
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_movebench: no server running\n");
+		return;
+	}
+
+	numclusters = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : 10000;
+	size = Cmd_Argc() > 2 ? Q_atoi (Cmd_Argv(2)) : 5;
+	if (size < 1)
+		size = 1;
+	if (size > MAX_BATCHMOVES)
+		size = MAX_BATCHMOVES;
+
+// one at a time
+	c_areamoves = c_areatests = c_areaclips = 0;
+	SV_BenchSeed (3);
+	time = Sys_FloatTime ();
+	for (i=0 ; i<numclusters ; i++)
+	{
+		SV_BenchCluster (moves, size);
+		for (j=0 ; j<size ; j++)
+			moves[j].trace = SV_Move (moves[j].start, moves[j].mins, moves[j].maxs,
+				moves[j].end, moves[j].type, moves[j].passedict);
+	}
+	scalartime = Sys_FloatTime () - time;
+	scalartests = c_areatests;
+
+// batched
+	c_areamoves = c_areatests = c_areaclips = 0;
+	SV_BenchSeed (3);
+	time = Sys_FloatTime ();
+	for (i=0 ; i<numclusters ; i++)
+	{
+		SV_BenchCluster (moves, size);
+		SV_MoveBatch (moves, size);
+	}
+	batchtime = Sys_FloatTime () - time;
+	batchtests = c_areatests;
+
+// same answers
+	mismatches = 0;
+	SV_BenchSeed (3);
+	for (i=0 ; i<numclusters ; i++)
+	{
+		SV_BenchCluster (moves, size);
+		SV_MoveBatch (moves, size);
+		for (j=0 ; j<size ; j++)
+		{
+			trace = SV_Move (moves[j].start, moves[j].mins, moves[j].maxs,
+				moves[j].end, moves[j].type, moves[j].passedict);
+			if (memcmp (&trace, &moves[j].trace, sizeof(trace)))
+				mismatches++;
+		}
+	}
+
+	Con_Printf ("%i clusters of %i traces\n", numclusters, size);
+	Con_Printf ("SV_Move:      %8i candidates, %7.3f ms\n", scalartests, scalartime * 1000);
+	Con_Printf ("SV_MoveBatch: %8i candidates, %7.3f ms\n", batchtests, batchtime * 1000);
+	if (mismatches)
+		Con_Printf ("%i traces differ\n", mismatches);
+}
+
+/*
+===============================================================================
+
+HULL TRACE CHECK
+
+The recursive hull trace as it was before SV_RecursiveHullCheck walked the
+packed clipnodes with its own stack.  It is only built with PARANOID, for
+sv_tracetest to check the new code against.
+
+===============================================================================
+*/
+
+#ifdef PARANOID
+
+static int SV_RefHullPointContents (hull_t *hull, int num, vec3_t p)
+{
+	float		d;
+	dclipnode_t	*node;
+	mplane_t	*plane;
+
+	while (num >= 0)
+	{
+		node = hull->clipnodes + num;
+		plane = hull->planes + node->planenum;
+		
+		if (plane->type < 3)
+			d = p[plane->type] - plane->dist;
+		else
+			d = DotProduct (plane->normal, p) - plane->dist;
+		if (d < 0)
+			num = node->children[1];
+		else
+			num = node->children[0];
+	}
+	
+	return num;
+}
+
+static qboolean SV_RefHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace)
+{
+	dclipnode_t	*node;
+	mplane_t	*plane;
+	float		t1, t2;
+	float		frac;
+	int			i;
+	vec3_t		mid;
+	int			side;
+	float		midf;
+
+	if (num < 0)
+	{
+		if (num != CONTENTS_SOLID)
+		{
+			trace->allsolid = false;
+			if (num == CONTENTS_EMPTY)
+				trace->inopen = true;
+			else
+				trace->inwater = true;
+		}
+		else
+			trace->startsolid = true;
+		return true;
+	}
+
+	node = hull->clipnodes + num;
+	plane = hull->planes + node->planenum;
+
+	if (plane->type < 3)
+	{
+		t1 = p1[plane->type] - plane->dist;
+		t2 = p2[plane->type] - plane->dist;
+	}
+	else
+	{
+		t1 = DotProduct (plane->normal, p1) - plane->dist;
+		t2 = DotProduct (plane->normal, p2) - plane->dist;
+	}
+	
+	if (t1 >= 0 && t2 >= 0)
+		return SV_RefHullCheck (hull, node->children[0], p1f, p2f, p1, p2, trace);
+	if (t1 < 0 && t2 < 0)
+		return SV_RefHullCheck (hull, node->children[1], p1f, p2f, p1, p2, trace);
+
+	if (t1 < 0)
+		frac = (t1 + DIST_EPSILON)/(t1-t2);
+	else
+		frac = (t1 - DIST_EPSILON)/(t1-t2);
+	if (frac < 0)
+		frac = 0;
+	if (frac > 1)
+		frac = 1;
+		
+	midf = p1f + (p2f - p1f)*frac;
+	for (i=0 ; i<3 ; i++)
+		mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+
+	side = (t1 < 0);
+
+	if (!SV_RefHullCheck (hull, node->children[side], p1f, midf, p1, mid, trace) )
+		return false;
+
+	if (SV_RefHullPointContents (hull, node->children[side^1], mid)
+	!= CONTENTS_SOLID)
+		return SV_RefHullCheck (hull, node->children[side^1], midf, p2f, mid, p2, trace);
+	
+	if (trace->allsolid)
+		return false;
+
+	if (!side)
+	{
+		VectorCopy (plane->normal, trace->plane.normal);
+		trace->plane.dist = plane->dist;
+	}
+	else
+	{
+		VectorSubtract (vec3_origin, plane->normal, trace->plane.normal);
+		trace->plane.dist = -plane->dist;
+	}
+
+	while (SV_RefHullPointContents (hull, hull->firstclipnode, mid)
+	== CONTENTS_SOLID)
+	{
+		frac -= 0.1;
+		if (frac < 0)
+		{
+			trace->fraction = midf;
+			VectorCopy (mid, trace->endpos);
+			return false;
+		}
+		midf = p1f + (p2f - p1f)*frac;
+		for (i=0 ; i<3 ; i++)
+			mid[i] = p1[i] + frac*(p2[i] - p1[i]);
+	}
+
+	trace->fraction = midf;
+	VectorCopy (mid, trace->endpos);
+
+	return false;
+}
+
+#endif	// PARANOID
+
+/*
+==================
+SV_TraceTest_f
+
+sv_tracetest [traces]
+
+Runs random traces through the world trace memo, and with PARANOID
+through every hull of the current map and every brush model in it with
+both the old and the new hull trace, and counts the traces that differ in
+any bit.
+==================
+*/
+void SV_TraceTest_f (void)
+{
+	int		i, j, h, numtraces, memomismatches;
+	float	oldmemo;
+	vec3_t	start, end, *wmins, *wmaxs;
+	trace_t	trace, ref;
+#ifdef PARANOID
+	int		m, tested, mismatches;
+	qboolean	ret, refret;
+	hull_t	*hull;
+	model_t	*model;
+#endif
+	static	vec3_t	sizes[3][2] = {
+		{{0, 0, 0}, {0, 0, 0}},
+		{{-16, -16, -24}, {16, 16, 32}},
+		{{-32, -32, -24}, {32, 32, 64}}};
+
+	if (!sv.active)
+	{
+		Con_Printf ("sv_tracetest: no server running\n");
+		return;
+	}
+
+	numtraces = Cmd_Argc() > 1 ? Q_atoi (Cmd_Argv(1)) : 100000;
+
+	wmins = &sv.worldmodel->mins;
+	wmaxs = &sv.worldmodel->maxs;
+
+	SV_BenchSeed (4);
+#ifdef PARANOID
+	tested = mismatches = 0;
+	for (m=1 ; m<MAX_MODELS && sv.models[m] ; m++)
+	{
+		model = sv.models[m];
+		if (model->type != mod_brush)
+			continue;
+
+		for (h=0 ; h<3 ; h++)
+		{
+			hull = &model->hulls[h];
+			for (i=0 ; i<numtraces ; i++)
+			{
+				for (j=0 ; j<3 ; j++)
+				{
+					start[j] = SV_BenchRandom ((*wmins)[j] - 64, (*wmaxs)[j] + 64);
+					if (i & 1)	// short moves like most physics traces
+						end[j] = start[j] + SV_BenchRandom (-32, 32);
+					else
+						end[j] = SV_BenchRandom ((*wmins)[j] - 64, (*wmaxs)[j] + 64);
+				}
+				if (i % 16 == 0)
+					VectorCopy (start, end);	// position tests
+
+				memset (&ref, 0, sizeof(ref));
+				ref.fraction = 1;
+				ref.allsolid = true;
+				VectorCopy (end, ref.endpos);
+				trace = ref;
+
+				refret = SV_RefHullCheck (hull, hull->firstclipnode, 0, 1, start, end, &ref);
+				ret = SV_RecursiveHullCheck (hull, hull->firstclipnode, 0, 1, start, end, &trace);
+				if (ret != refret || memcmp (&trace, &ref, sizeof(trace)))
+					mismatches++;
+				tested++;
+			}
+		}
+	}
+	Con_Printf ("%i hull traces, %i differ\n", tested, mismatches);
+#endif
+
+// the memo has to hand back exactly what it was given
+	oldmemo = sv_tracememo.value;
+	memomismatches = 0;
+	for (i=0 ; i<numtraces ; i++)
+	{
+		h = i % 3;
+		for (j=0 ; j<3 ; j++)
+		{
+			start[j] = SV_BenchRandom ((*wmins)[j], (*wmaxs)[j]);
+			end[j] = start[j] + SV_BenchRandom (-64, 64);
+		}
+
+		sv_tracememo.value = 0;
+		ref = SV_ClipMoveToWorld (start, sizes[h][0], sizes[h][1], end);
+		sv_tracememo.value = 1;
+		for (j=0 ; j<2 ; j++)
+		{
+			trace = SV_ClipMoveToWorld (start, sizes[h][0], sizes[h][1], end);
+			if (memcmp (&trace, &ref, sizeof(trace)))
+				memomismatches++;
+		}
+	}
+	sv_tracememo.value = oldmemo;
+	SV_ClearTraceMemo ();
+
+	Con_Printf ("%i memo traces, %i differ\n", numtraces*2, memomismatches);
+}